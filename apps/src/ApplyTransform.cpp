@@ -4,13 +4,41 @@
 
 #include "rt/ImageTransformResampler.hpp"
 #include "rt/filesystem.hpp"
+#include "rt/io/DeformationFieldIO.hpp"
+#include "rt/io/FileExtensionFilter.hpp"
 #include "rt/io/ImageIO.hpp"
+#include "rt/io/TIFFIO.hpp"
 #include "rt/types/Transforms.hpp"
 #include "rt/util/ImageConversion.hpp"
 
 namespace po = boost::program_options;
 namespace fs = rt::filesystem;
 
+// Load the baked deformation field stored next to a transform file. Bakes and
+// stores a new field if there isn't one, or if it's stale.
+static auto CachedDeformationField(const fs::path& tfmPath, const cv::Size& s)
+    -> rt::DeformationField::Pointer
+{
+    auto fieldPath = tfmPath;
+    fieldPath.replace_extension(".dfield");
+    if (fs::exists(fieldPath) and
+        fs::last_write_time(fieldPath) >= fs::last_write_time(tfmPath)) {
+        auto field = rt::ReadDeformationField(fieldPath);
+        auto size = field->GetLargestPossibleRegion().GetSize();
+        if (static_cast<int>(size[0]) == s.width and
+            static_cast<int>(size[1]) == s.height) {
+            std::cout << "Loaded deformation field: " << fieldPath.string();
+            std::cout << std::endl;
+            return field;
+        }
+    }
+
+    std::cout << "Baking deformation field..." << std::endl;
+    auto field = rt::BakeDeformationField(rt::ReadTransform(tfmPath), s);
+    rt::WriteDeformationField(fieldPath, field);
+    return field;
+}
+
 int main(int argc, char* argv[])
 {
     ///// Parse the command line options /////
@@ -25,7 +53,16 @@ int main(int argc, char* argv[])
             ("output-file,o", po::value<std::string>()->required(),
                 "Output file path for the registered moving image")
             ("enable-alpha", "If enabled, an alpha layer will be "
-                "added to the moving image if it does not already have one.");
+                "added to the moving image if it does not already have one.")
+            ("cache-field", "Bake the transform into a deformation field "
+                "stored next to the transform file (.dfield) and reuse it on "
+                "later runs with a fixed image of the same size. Speeds up "
+                "applying one transform to many images.")
+            ("tiled", "Resample tile by tile, streaming from the moving image "
+                "to a tiled output TIFF. Neither image is loaded in full. "
+                "Requires TIFF moving and output images.")
+            ("tile-size", po::value<int>()->default_value(512),
+                "Output tile size for --tiled. Must be a multiple of 16.");
 
     po::options_description all("Usage");
     all.add(required);
@@ -53,23 +90,59 @@ int main(int argc, char* argv[])
     fs::path movingPath = parsed["moving"].as<std::string>();
     fs::path tfmPath = parsed["transform"].as<std::string>();
     fs::path outputPath = parsed["output-file"].as<std::string>();
+    auto forceAlpha = parsed.count("enable-alpha") > 0;
+
+    // Streaming resample
+    if (parsed.count("tiled") > 0) {
+        if (parsed.count("cache-field") > 0) {
+            std::cerr << "ERROR: --cache-field cannot be used with --tiled";
+            std::cerr << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (not rt::FileExtensionFilter(movingPath, {"tif", "tiff"}) or
+            not rt::FileExtensionFilter(outputPath, {"tif", "tiff"})) {
+            std::cerr << "ERROR: --tiled requires TIFF moving and output ";
+            std::cerr << "images" << std::endl;
+            return EXIT_FAILURE;
+        }
 
-    // Read transform
-    auto transform = rt::ReadTransform(tfmPath);
+        // Only read the fixed image header if possible
+        cv::Size fixedSize;
+        if (rt::FileExtensionFilter(fixedPath, {"tif", "tiff"})) {
+            fixedSize = rt::io::ReadTIFFHeader(fixedPath).size;
+        } else {
+            fixedSize = rt::ReadImage(fixedPath).size();
+        }
+
+        auto transform = rt::ReadTransform(tfmPath);
+        auto tile = parsed["tile-size"].as<int>();
+        std::cout << "Transforming image..." << std::endl;
+        rt::TiledImageTransformResampler(
+            movingPath, outputPath, fixedSize, transform, forceAlpha,
+            {tile, tile});
+        return EXIT_SUCCESS;
+    }
 
     // Load the fixed image and moving image (at full depth)
     auto fixed = rt::ReadImage(fixedPath);
     auto moving = rt::ReadImage(movingPath);
 
     // Add alpha channel if requested and needed
-    if (parsed.count("enable-alpha") > 0 and
-        (moving.channels() == 1 or moving.channels() == 3)) {
+    if (forceAlpha and (moving.channels() == 1 or moving.channels() == 3)) {
         moving = rt::ColorConvertImage(moving, moving.channels() + 1);
     }
 
     // Transform image
-    std::cout << "Transforming image..." << std::endl;
-    auto final = rt::ImageTransformResampler(moving, fixed.size(), transform);
+    cv::Mat final;
+    if (parsed.count("cache-field") > 0) {
+        auto field = CachedDeformationField(tfmPath, fixed.size());
+        std::cout << "Transforming image..." << std::endl;
+        final = rt::ImageTransformResampler(moving, field);
+    } else {
+        auto transform = rt::ReadTransform(tfmPath);
+        std::cout << "Transforming image..." << std::endl;
+        final = rt::ImageTransformResampler(moving, fixed.size(), transform);
+    }
 
     // Write out the file
     std::cout << "Writing transformed image..." << std::endl;
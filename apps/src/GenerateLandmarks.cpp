@@ -1,4 +1,6 @@
 #include <iostream>
+#include <string>
+#include <unordered_map>
 
 #include "rt/LandmarkDetector.hpp"
 #include "rt/filesystem.hpp"
@@ -7,12 +9,21 @@
 
 namespace fs = rt::filesystem;
 
+using MatcherType = rt::LandmarkDetector::MatcherType;
+std::unordered_map<std::string, MatcherType> StrToMatcherType{
+    {"brute-force", MatcherType::BruteForce},
+    {"lsh", MatcherType::LSH},
+    {"hierarchical-clustering", MatcherType::HierarchicalClustering},
+};
+
 int main(int argc, const char* argv[])
 {
     // Check arg count
     if (argc < 4) {
         std::cerr << "Usage: " << argv[0]
-                  << " [fixed] [moving] [output] {[conf]}" << std::endl;
+                  << " [fixed] [moving] [output] {[conf] "
+                     "[brute-force|lsh|hierarchical-clustering]}"
+                  << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -24,6 +35,14 @@ int main(int argc, const char* argv[])
     if (argc > 4) {
         confidence = std::stof(argv[4]);
     }
+    auto matcher = MatcherType::BruteForce;
+    if (argc > 5) {
+        if (StrToMatcherType.count(argv[5]) == 0) {
+            std::cerr << "Unknown matcher: " << argv[5] << std::endl;
+            return EXIT_FAILURE;
+        }
+        matcher = StrToMatcherType.at(argv[5]);
+    }
 
     // Load images
     auto fixedImg = rt::ReadImage(fixedPath);
@@ -41,8 +60,10 @@ int main(int argc, const char* argv[])
     detector.setFixedImage(fixedImg);
     detector.setMovingImage(movingImg);
     detector.setMatchRatio(confidence);
+    detector.setMatcherType(matcher);
     auto matchedPairs = detector.compute().size();
     std::cout << "Generated matches: " << matchedPairs << std::endl;
+    std::cout << detector.matchReport() << std::endl;
 
     // Write the output
     std::cout << "Writing landmarks file..." << std::endl;
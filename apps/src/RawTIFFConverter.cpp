@@ -1,25 +1,227 @@
+#include <algorithm>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
 
 #include "rt/filesystem.hpp"
+#include "rt/io/FileExtensionFilter.hpp"
 #include "rt/io/ImageIO.hpp"
 #include "rt/io/TIFFIO.hpp"
 
+using namespace rt;
+
 namespace fs = rt::filesystem;
+namespace po = boost::program_options;
+
+static const auto IsFormat = rt::FileExtensionFilter;
+
+std::unordered_map<std::string, io::TIFFCompression> StrToCompression{
+    {"none", io::TIFFCompression::None},
+    {"lzw", io::TIFFCompression::LZW},
+    {"deflate", io::TIFFCompression::Deflate},
+    {"zstd", io::TIFFCompression::ZSTD},
+};
+
+// Add an input path. Directories are expanded to the TIFFs they contain.
+static void AddInput(const fs::path& path, std::vector<fs::path>& inputs)
+{
+    if (not fs::is_directory(path)) {
+        inputs.push_back(path);
+        return;
+    }
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(path)) {
+        if (fs::is_regular_file(entry.path()) and
+            IsFormat(entry.path(), {"tif", "tiff"})) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    inputs.insert(inputs.end(), files.begin(), files.end());
+}
 
-int main(int argc, char* argv[])
+// ReadRawTIFF() returns samples in file order, but WriteImage() expects
+// OpenCV's BGR order
+static auto ToBGR(const cv::Mat& img) -> cv::Mat
 {
+    cv::Mat result;
+    switch (img.channels()) {
+        case 3:
+            cv::cvtColor(img, result, cv::COLOR_RGB2BGR);
+            return result;
+        case 4:
+            cv::cvtColor(img, result, cv::COLOR_RGBA2BGRA);
+            return result;
+        default:
+            return img;
+    }
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    ///// Parse the command line options /////
+    // clang-format off
+    po::options_description required("General Options");
+    required.add_options()
+        ("help,h", "Show this message")
+        ("input,i", po::value<std::vector<std::string>>()->multitoken(),
+            "Input raw TIFF files or directories of raw TIFF files")
+        ("input-list", po::value<std::string>(),
+            "Text file listing input files, one per line")
+        ("output,o", po::value<std::string>()->required(),
+            "Output file. If converting more than one file, an output "
+            "directory.")
+        ("offset", po::value<int>()->default_value(10),
+            "Shift every strip offset by this number of bytes")
+        ("compression", po::value<std::string>()->default_value("lzw"),
+            "Output TIFF compression: none, lzw, deflate, zstd");
+
+    po::positional_options_description positional;
+    positional.add("input", 1).add("output", 1);
+
+    po::options_description all("Usage");
+    all.add(required);
+    // clang-format on
+
+    // Parse the cmd line
+    po::variables_map parsed;
+    po::store(
+        po::command_line_parser(argc, argv)
+            .options(all)
+            .positional(positional)
+            .run(),
+        parsed);
+
+    // Show the help message
+    if (parsed.count("help") > 0) {
+        std::cerr << all << std::endl;
+        return EXIT_SUCCESS;
+    }
     if (argc < 3) {
-        std::cerr << argv[0] << "Usage: input.tif output.tif" << std::endl;
+        std::cerr << all << std::endl;
         return EXIT_FAILURE;
     }
 
-    // Get inputs
-    fs::path input = argv[1];
-    fs::path output = argv[2];
+    // Warn of missing options
+    try {
+        po::notify(parsed);
+    } catch (po::error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto offset = parsed["offset"].as<int>();
+    auto compressionStr = parsed["compression"].as<std::string>();
+    if (StrToCompression.count(compressionStr) == 0) {
+        std::cerr << "ERROR: Unknown TIFF compression: " << compressionStr;
+        std::cerr << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto compression = StrToCompression.at(compressionStr);
 
-    // Load image
-    auto img = rt::io::ReadRawTIFF(input, 10);
+    // Collect the inputs
+    std::vector<fs::path> inputs;
+    bool batch{false};
+    if (parsed.count("input") > 0) {
+        for (const auto& i : parsed["input"].as<std::vector<std::string>>()) {
+            batch |= fs::is_directory(i);
+            AddInput(i, inputs);
+        }
+    }
+    if (parsed.count("input-list") > 0) {
+        batch = true;
+        std::ifstream list(parsed["input-list"].as<std::string>());
+        if (not list.is_open()) {
+            std::cerr << "ERROR: Failed to open input list" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::string line;
+        while (std::getline(list, line)) {
+            if (not line.empty()) {
+                AddInput(line, inputs);
+            }
+        }
+    }
+    if (inputs.empty()) {
+        std::cerr << "ERROR: No input files" << std::endl;
+        return EXIT_FAILURE;
+    }
+    batch |= inputs.size() > 1;
 
-    // Save image
-    rt::WriteImage(output, img);
+    // Match each input to an output
+    fs::path output = parsed["output"].as<std::string>();
+    std::vector<fs::path> outputs;
+    if (batch) {
+        fs::create_directories(output);
+        for (const auto& i : inputs) {
+            outputs.push_back(output / i.filename().replace_extension(".tif"));
+        }
+    } else {
+        outputs.push_back(output);
+    }
+
+    // Conversions run in parallel, so two inputs writing the same file, or
+    // an input overwriting itself, would corrupt the results
+    std::set<fs::path> seen;
+    for (std::size_t i = 0; i < inputs.size(); i++) {
+        auto normal = fs::absolute(outputs[i]).lexically_normal();
+        if (not seen.insert(normal).second) {
+            std::cerr << "ERROR: More than one input converts to ";
+            std::cerr << outputs[i].string() << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (fs::exists(inputs[i]) and fs::exists(outputs[i]) and
+            fs::equivalent(inputs[i], outputs[i])) {
+            std::cerr << "ERROR: Output is the same file as input ";
+            std::cerr << inputs[i].string() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Convert the files in parallel. TIFF outputs stream each strip to the
+    // encoder; other formats go through the full image.
+    std::vector<std::exception_ptr> errors(inputs.size());
+    auto range = cv::Range(0, static_cast<int>(inputs.size()));
+    cv::parallel_for_(range, [&](const cv::Range& r) {
+        for (auto i = r.start; i < r.end; i++) {
+            try {
+                if (IsFormat(outputs[i], {"tif", "tiff"})) {
+                    io::ConvertRawTIFF(
+                        inputs[i], outputs[i], offset, compression);
+                } else {
+                    auto img = io::ReadRawTIFF(inputs[i], offset);
+                    WriteImage(outputs[i], ToBGR(img));
+                }
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    });
+
+    // Report failures
+    std::size_t failed{0};
+    for (std::size_t i = 0; i < inputs.size(); i++) {
+        if (not errors[i]) {
+            continue;
+        }
+        failed++;
+        try {
+            std::rethrow_exception(errors[i]);
+        } catch (const std::exception& e) {
+            std::cerr << "ERROR: " << inputs[i].string() << ": " << e.what();
+            std::cerr << std::endl;
+        }
+    }
+    if (failed > 0) {
+        std::cerr << "Failed to convert " << failed << " of ";
+        std::cerr << inputs.size() << " files" << std::endl;
+        return EXIT_FAILURE;
+    }
 }
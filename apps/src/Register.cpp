@@ -1,5 +1,6 @@
 #include <iostream>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/program_options.hpp>
 #include <smgl/Graph.hpp>
@@ -18,6 +19,47 @@ namespace po = boost::program_options;
 
 static const auto IsFormat = rt::FileExtensionFilter;
 
+using DetectionMode = LandmarkDetector::DetectionMode;
+std::unordered_map<std::string, DetectionMode> StrToDetectionMode{
+    {"full", DetectionMode::Full},
+    {"tiled", DetectionMode::Tiled},
+    {"coarse-to-fine", DetectionMode::CoarseToFine},
+};
+
+using MatcherType = LandmarkDetector::MatcherType;
+std::unordered_map<std::string, MatcherType> StrToMatcherType{
+    {"brute-force", MatcherType::BruteForce},
+    {"lsh", MatcherType::LSH},
+    {"hierarchical-clustering", MatcherType::HierarchicalClustering},
+};
+
+using GeometricModel = LandmarkDetector::GeometricModel;
+std::unordered_map<std::string, GeometricModel> StrToGeometricModel{
+    {"none", GeometricModel::None},
+    {"affine", GeometricModel::Affine},
+    {"homography", GeometricModel::Homography},
+};
+
+using RobustEstimator = LandmarkDetector::RobustEstimator;
+std::unordered_map<std::string, RobustEstimator> StrToRobustEstimator{
+    {"ransac", RobustEstimator::RANSAC},
+    {"prosac", RobustEstimator::PROSAC},
+    {"magsac", RobustEstimator::MAGSAC},
+};
+
+std::unordered_map<std::string, io::TIFFCompression> StrToCompression{
+    {"none", io::TIFFCompression::None},
+    {"lzw", io::TIFFCompression::LZW},
+    {"deflate", io::TIFFCompression::Deflate},
+    {"zstd", io::TIFFCompression::ZSTD},
+};
+
+std::unordered_map<std::string, io::TIFFPredictor> StrToPredictor{
+    {"none", io::TIFFPredictor::None},
+    {"horizontal", io::TIFFPredictor::Horizontal},
+    {"float", io::TIFFPredictor::FloatingPoint},
+};
+
 auto main(int argc, char* argv[]) -> int
 {
     ///// Parse the command line options /////
@@ -40,7 +82,27 @@ auto main(int argc, char* argv[]) -> int
     po::options_description graphOptions("Render Graph Options");
     graphOptions.add_options()
         ("output-graph,g", po::value<std::string>(), "Render graph JSON file")
-        ("output-dot", po::value<std::string>(), "Render graph Dot file");
+        ("output-dot", po::value<std::string>(), "Render graph Dot file")
+        ("max-concurrency", po::value<std::size_t>()->default_value(1),
+            "Maximum number of independent graph nodes to run at once. If "
+            "0, use the number of hardware threads.");
+
+    po::options_description tiffOptions("TIFF Output Options");
+    tiffOptions.add_options()
+        ("output-tiled", "Write a tiled TIFF. Tiles are compressed in "
+            "parallel.")
+        ("output-tile-size", po::value<int>()->default_value(512),
+            "Tile size in pixels for --output-tiled. Must be a multiple of "
+            "16.")
+        ("output-compression", po::value<std::string>()->default_value("lzw"),
+            "TIFF compression: none, lzw, deflate, zstd")
+        ("output-predictor", po::value<std::string>()->default_value("none"),
+            "TIFF compression predictor: none, horizontal, float. "
+            "'horizontal' is for integer images and 'float' is for "
+            "floating-point images.")
+        ("output-pyramid-levels", po::value<int>()->default_value(0),
+            "Number of reduced-resolution pyramid levels to add to the output "
+            "TIFF. Implies --output-tiled.");
 
     po::options_description ldmOptions("Landmark Registration Options");
     ldmOptions.add_options()
@@ -51,7 +113,41 @@ auto main(int argc, char* argv[]) -> int
             "are automatically detected from the input images.")
         ("landmark-match-ratio", po::value<float>()->default_value(0.3F),
             "Matching ratio for automatically detected features. Smaller "
-            "values represent closer matches.");
+            "values represent closer matches.")
+        ("landmark-feature-cache", po::value<std::string>(),
+            "Directory in which to cache detected image features. Features "
+            "for unchanged images are reused by later runs.")
+        ("landmark-detection-mode", po::value<std::string>()->default_value("full"),
+            "Feature detection mode: full, tiled, coarse-to-fine. 'tiled' "
+            "detects features in overlapping tiles in parallel. "
+            "'coarse-to-fine' matches features detected in downsampled images "
+            "and refines the matches at full resolution. Use 'tiled' or "
+            "'coarse-to-fine' for very large images.")
+        ("landmark-tile-size", po::value<int>()->default_value(
+            LandmarkDetector::DEFAULT_TILE_SIZE),
+            "Tile size in pixels for tiled and coarse feature detection")
+        ("landmark-coarse-scale", po::value<double>()->default_value(
+            LandmarkDetector::DEFAULT_COARSE_SCALE),
+            "Image scale factor for coarse feature detection")
+        ("landmark-matcher", po::value<std::string>()->default_value("brute-force"),
+            "Feature matcher: brute-force, lsh, hierarchical-clustering. "
+            "'brute-force' is an exhaustive search. 'lsh' (locality-sensitive "
+            "hashing) and 'hierarchical-clustering' are faster, approximate "
+            "searches.")
+        ("landmark-search-radius", po::value<float>()->default_value(0),
+            "If greater than zero, only match features within this many "
+            "pixels of the position predicted by a coarse affine estimate")
+        ("landmark-verify", po::value<std::string>()->default_value("none"),
+            "Remove feature matches which are inconsistent with a robustly "
+            "estimated model: none, affine, homography")
+        ("landmark-estimator", po::value<std::string>()->default_value("ransac"),
+            "Robust estimator for --landmark-verify: ransac, prosac, magsac")
+        ("landmark-inlier-threshold", po::value<double>()->default_value(
+            LandmarkDetector::DEFAULT_INLIER_THRESHOLD),
+            "Inlier threshold in pixels for --landmark-verify")
+        ("landmark-max-count", po::value<std::size_t>()->default_value(0),
+            "If greater than zero, keep at most this many landmarks, evenly "
+            "distributed over the fixed image");
 
     po::options_description deformOptions("Deformable Registration Options");
     deformOptions.add_options()
@@ -61,10 +157,27 @@ auto main(int argc, char* argv[]) -> int
         ("deformable-mesh-size", po::value<unsigned>()->default_value(12),
             "The deformable mesh fill size")
         ("deformable-tolerance", po::value<double>()->default_value(.0001),
-            "The deformable gradient magnitude tolerance");
+            "The deformable gradient magnitude tolerance")
+        ("deformable-levels", po::value<std::size_t>()->default_value(1),
+            "Number of multi-resolution pyramid levels. Each level is half "
+            "the resolution of the next and uses half the mesh size.")
+        ("deformable-iteration-schedule",
+            po::value<std::vector<std::size_t>>()->multitoken(),
+            "Per-level iteration limits, coarsest level first. Levels "
+            "without a value use --deformable-iterations.")
+        ("deformable-sampling-schedule",
+            po::value<std::vector<double>>()->multitoken(),
+            "Per-level fraction of fixed image pixels used to sample the "
+            "metric, coarsest level first.")
+        ("deformable-multithreaded", "Use the multithreaded ITKv4 "
+            "registration framework for deformable registration")
+        ("deformable-threads", po::value<unsigned>()->default_value(0),
+            "Number of threads used by --deformable-multithreaded. If 0, "
+            "use all available cores.");
 
     po::options_description all("Usage");
-    all.add(required).add(graphOptions).add(ldmOptions).add(deformOptions);
+    all.add(required).add(graphOptions).add(tiffOptions).add(ldmOptions)
+        .add(deformOptions);
     // clang-format on
 
     // Parse the cmd line
@@ -89,6 +202,27 @@ auto main(int argc, char* argv[]) -> int
     fs::path movingPath = parsed["moving"].as<std::string>();
     fs::path outputPath = parsed["output-file"].as<std::string>();
 
+    // TIFF output options
+    io::TIFFWriteOptions tiffOpts;
+    tiffOpts.tiled = parsed.count("output-tiled") > 0;
+    auto tileSize = parsed["output-tile-size"].as<int>();
+    tiffOpts.tileSize = {tileSize, tileSize};
+    auto compression = parsed["output-compression"].as<std::string>();
+    if (StrToCompression.count(compression) == 0) {
+        std::cerr << "ERROR: Unknown TIFF compression: " << compression;
+        std::cerr << std::endl;
+        return EXIT_FAILURE;
+    }
+    tiffOpts.compression = StrToCompression.at(compression);
+    auto predictor = parsed["output-predictor"].as<std::string>();
+    if (StrToPredictor.count(predictor) == 0) {
+        std::cerr << "ERROR: Unknown TIFF predictor: " << predictor;
+        std::cerr << std::endl;
+        return EXIT_FAILURE;
+    }
+    tiffOpts.predictor = StrToPredictor.at(predictor);
+    tiffOpts.pyramidLevels = parsed["output-pyramid-levels"].as<int>();
+
     ///// Start render graph /////
     rt::graph::RegisterNodes();
     smgl::Graph graph;
@@ -149,6 +283,46 @@ auto main(int argc, char* argv[]) -> int
             genLdm->fixedImage = *results["fixedImage"];
             genLdm->movingImage = moving->image;
             genLdm->matchRatio = parsed["landmark-match-ratio"].as<float>();
+            if (parsed.count("landmark-feature-cache") > 0) {
+                genLdm->featureCacheDir =
+                    parsed["landmark-feature-cache"].as<std::string>();
+            }
+            auto mode = parsed["landmark-detection-mode"].as<std::string>();
+            if (StrToDetectionMode.count(mode) == 0) {
+                std::cerr << "ERROR: Unknown landmark detection mode: ";
+                std::cerr << mode << std::endl;
+                return EXIT_FAILURE;
+            }
+            genLdm->detectionMode = StrToDetectionMode.at(mode);
+            genLdm->tileSize = parsed["landmark-tile-size"].as<int>();
+            genLdm->coarseScale = parsed["landmark-coarse-scale"].as<double>();
+            auto matcher = parsed["landmark-matcher"].as<std::string>();
+            if (StrToMatcherType.count(matcher) == 0) {
+                std::cerr << "ERROR: Unknown landmark matcher: ";
+                std::cerr << matcher << std::endl;
+                return EXIT_FAILURE;
+            }
+            genLdm->matcherType = StrToMatcherType.at(matcher);
+            genLdm->searchRadius =
+                parsed["landmark-search-radius"].as<float>();
+            auto model = parsed["landmark-verify"].as<std::string>();
+            if (StrToGeometricModel.count(model) == 0) {
+                std::cerr << "ERROR: Unknown landmark verification model: ";
+                std::cerr << model << std::endl;
+                return EXIT_FAILURE;
+            }
+            genLdm->geometricModel = StrToGeometricModel.at(model);
+            auto est = parsed["landmark-estimator"].as<std::string>();
+            if (StrToRobustEstimator.count(est) == 0) {
+                std::cerr << "ERROR: Unknown landmark estimator: ";
+                std::cerr << est << std::endl;
+                return EXIT_FAILURE;
+            }
+            genLdm->robustEstimator = StrToRobustEstimator.at(est);
+            genLdm->inlierThreshold =
+                parsed["landmark-inlier-threshold"].as<double>();
+            genLdm->maxLandmarks =
+                parsed["landmark-max-count"].as<std::size_t>();
             ldmNode = genLdm;
 
             // Optionally write generated landmarks to file
@@ -206,6 +380,21 @@ auto main(int argc, char* argv[]) -> int
         deformable->fixedImage = *results["fixedImage"];
         deformable->movingImage = resample1->resampledImage;
         deformable->reportMetrics = parsed.count("report-metrics") > 0;
+        deformable->levels = parsed["deformable-levels"].as<std::size_t>();
+        if (parsed.count("deformable-iteration-schedule") > 0) {
+            deformable->iterationSchedule =
+                parsed["deformable-iteration-schedule"]
+                    .as<std::vector<std::size_t>>();
+        }
+        if (parsed.count("deformable-sampling-schedule") > 0) {
+            deformable->samplingSchedule =
+                parsed["deformable-sampling-schedule"]
+                    .as<std::vector<double>>();
+        }
+        if (parsed.count("deformable-multithreaded") > 0) {
+            deformable->framework = DeformableRegistration::Framework::ITKv4;
+            deformable->threads = parsed["deformable-threads"].as<unsigned>();
+        }
 
         // Add transform to final composite
         compositeTfms->second = deformable->transform;
@@ -241,6 +430,7 @@ auto main(int argc, char* argv[]) -> int
         auto writer = graph.insertNode<ImageWriteNode>();
         writer->path = outputPath;
         writer->image = resample2->resampledImage;
+        writer->tiffOptions = tiffOpts;
     }
 
     ///// Write the final transformations /////
@@ -251,7 +441,7 @@ auto main(int argc, char* argv[]) -> int
     }
 
     // Compute result
-    graph.update();
+    UpdateGraph(graph, parsed["max-concurrency"].as<std::size_t>());
 
     // Write Dot file
     if (parsed.count("output-dot") > 0) {
@@ -32,6 +32,12 @@ std::unordered_map<std::string, SamplingMode> StrToMode{
     {"auto", SamplingMode::AutoUV},
 };
 
+using SamplingEngine = ReorderUnorganizedTexture::SamplingEngine;
+std::unordered_map<std::string, SamplingEngine> StrToEngine{
+    {"ray-cast", SamplingEngine::RayCast},
+    {"rasterize", SamplingEngine::Rasterize},
+};
+
 auto main(int argc, char* argv[]) -> int
 {
     ///// Parse the command line options /////
@@ -58,6 +64,11 @@ auto main(int argc, char* argv[]) -> int
         ("sampling-dim,d", po::value<std::size_t>()->default_value(800),
              "If --sampling-mode is 'width' or 'height', the length of the "
              "corresponding output dimension in pixels")
+        ("sampling-engine", po::value<std::string>()->default_value("ray-cast"),
+             "Engines: ray-cast, rasterize. 'rasterize' projects the mesh into "
+             "the sampling plane with a depth buffer instead of casting a ray "
+             "per pixel. It does not build a BVH and is usually faster for "
+             "dense sampling rates.")
         ("use-first-intersection,f", "This program assumes that "
              "the projection origin is behind the base plane of the sampled "
              "mesh. Thus, the last mesh intersection point will lie on the "
@@ -68,7 +79,10 @@ auto main(int argc, char* argv[]) -> int
     po::options_description graphOptions("Render Graph Options");
     graphOptions.add_options()
     ("output-graph,g", po::value<std::string>(), "Render graph JSON file")
-    ("output-dot", po::value<std::string>(), "Render graph Dot file");
+    ("output-dot", po::value<std::string>(), "Render graph Dot file")
+    ("max-concurrency", po::value<std::size_t>()->default_value(1),
+        "Maximum number of independent graph nodes to run at once. If 0, "
+        "use the number of hardware threads.");
 
     po::options_description all("Usage");
     all.add(required).add(graphOptions);
@@ -100,6 +114,8 @@ auto main(int argc, char* argv[]) -> int
     auto samplingOrigin = StrToOrigin.at(originStr);
     auto modeStr = to_lower_copy(parsed["sampling-mode"].as<std::string>());
     auto sampleMode = StrToMode.at(modeStr);
+    auto engineStr = to_lower_copy(parsed["sampling-engine"].as<std::string>());
+    auto sampleEngine = StrToEngine.at(engineStr);
     auto sampleRate = parsed["sampling-rate"].as<double>();
     auto sampleDim = parsed["sampling-dim"].as<std::size_t>();
     auto useFirstIntersection = parsed.count("use-first-intersection") > 0;
@@ -134,6 +150,7 @@ auto main(int argc, char* argv[]) -> int
     reorder->imageIn = convert->imageOut;
     reorder->samplingOrigin = samplingOrigin;
     reorder->samplingMode = sampleMode;
+    reorder->samplingEngine = sampleEngine;
     reorder->sampleRate = sampleRate;
     reorder->sampleDim = sampleDim;
     reorder->useFirstIntersection = useFirstIntersection;
@@ -153,7 +170,7 @@ auto main(int argc, char* argv[]) -> int
     }
 
     // Compute result
-    graph.update();
+    UpdateGraph(graph, parsed["max-concurrency"].as<std::size_t>());
 
     // Write Dot file
     if (parsed.count("output-dot") > 0) {
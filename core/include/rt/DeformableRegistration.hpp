@@ -2,9 +2,13 @@
 
 /** @file */
 
+#include <vector>
+
 #include <itkBSplineTransform.h>
 #include <opencv2/core.hpp>
 
+#include "rt/ITKImageTypes.hpp"
+
 namespace rt
 {
 
@@ -17,7 +21,16 @@ namespace rt
  * some sort of landmark registration algorithm.
  *
  * This class is a simplified wrapper around ITK's ImageRegistrationMethod. If
- * you want fine-grained control, you should probably use that instead.
+ * you want fine-grained control, you should probably use that instead. The
+ * ITKv4 registration framework (ImageRegistrationMethodv4) can be selected
+ * with setFramework(). Its metric and gradient evaluation are multithreaded.
+ *
+ * Registration can optionally be run coarse-to-fine over a multi-resolution
+ * image pyramid (see setNumberOfLevels()). Each level registers downsampled
+ * copies of the input images using a coarser B-Spline mesh, and the result is
+ * refined and used to initialize the next level. Because most of the
+ * optimization happens on small images, this is significantly faster than
+ * single-level registration on large inputs.
  *
  */
 class DeformableRegistration
@@ -31,9 +44,23 @@ public:
     static constexpr double DEFAULT_GRAD_MAG_TOLERANCE = 0.0001;
     /** Default mesh fill size */
     static constexpr uint32_t DEFAULT_MESH_FILL_SIZE = 12;
+    /** Default number of multi-resolution levels */
+    static constexpr size_t DEFAULT_LEVELS = 1;
+    /** Maximum number of multi-resolution levels */
+    static constexpr size_t MAX_LEVELS = 16;
+    /** Default fraction of fixed image pixels used to sample the metric */
+    static constexpr double DEFAULT_SAMPLE_FACTOR = 1.0 / 80.0;
     /** BSpline transform type */
     using Transform = itk::BSplineTransform<double, 2, 3>;
 
+    /** @brief ITK registration framework */
+    enum class Framework {
+        /** ImageRegistrationMethod with single-threaded metric */
+        ITKv3,
+        /** ImageRegistrationMethodv4 with multithreaded metric */
+        ITKv4
+    };
+
     /**@{*/
     /** @brief Set the fixed (target) image for registration */
     void setFixedImage(const cv::Mat& i);
@@ -51,6 +78,43 @@ public:
     void setGradientMagnitudeTolerance(double i);
     /** @brief Report error metrics to the console while processing */
     void setReportMetrics(bool i);
+    /**
+     * @brief Set the number of multi-resolution pyramid levels
+     *
+     * Each level is half the resolution of the level after it and uses half
+     * the mesh fill size. The final level is always run on the full
+     * resolution images using the mesh fill size set by setMeshFillSize().
+     * When set to 1 (default), registration is only run at full resolution.
+     *
+     * If the coarsest level would be smaller than 2 pixels in either
+     * dimension, compute() uses fewer levels.
+     *
+     * @throws std::invalid_argument if i is greater than MAX_LEVELS
+     */
+    void setNumberOfLevels(size_t i);
+    /**
+     * @brief Set the optimizer iteration limit for each pyramid level
+     *
+     * Schedule is ordered from coarsest to finest level. Levels without an
+     * entry in the schedule use the value set by setNumberOfIterations().
+     */
+    void setIterationSchedule(const std::vector<size_t>& s);
+    /**
+     * @brief Set the metric sampling rate for each pyramid level
+     *
+     * Each value is the fraction of fixed image pixels used to estimate the
+     * metric at that level. Schedule is ordered from coarsest to finest level.
+     * Levels without an entry in the schedule use DEFAULT_SAMPLE_FACTOR.
+     */
+    void setSamplingSchedule(const std::vector<double>& s);
+    /** @brief Set the ITK registration framework (default: ITKv3) */
+    void setFramework(Framework f);
+    /**
+     * @brief Set the number of threads used by the ITKv4 framework
+     *
+     * If 0 (default), ITK's global default number of threads is used.
+     */
+    void setNumberOfThreads(unsigned i);
     /**@}*/
 
     /**@{*/
@@ -60,6 +124,16 @@ public:
     [[nodiscard]] auto getGradientMagnitudeTolerance() const -> double;
     /** @copydoc setReportMetrics(bool) */
     [[nodiscard]] auto getReportMetrics() const -> bool;
+    /** @copydoc setNumberOfLevels(size_t) */
+    [[nodiscard]] auto getNumberOfLevels() const -> size_t;
+    /** @copydoc setIterationSchedule() */
+    [[nodiscard]] auto getIterationSchedule() const -> std::vector<size_t>;
+    /** @copydoc setSamplingSchedule() */
+    [[nodiscard]] auto getSamplingSchedule() const -> std::vector<double>;
+    /** @copydoc setFramework(Framework) */
+    [[nodiscard]] auto getFramework() const -> Framework;
+    /** @copydoc setNumberOfThreads(unsigned) */
+    [[nodiscard]] auto getNumberOfThreads() const -> unsigned;
     /**@}*/
 
     /**@{*/
@@ -73,6 +147,21 @@ public:
     /**@}*/
 
 private:
+    /** Run the optimizer for a single pyramid level */
+    void compute_level_(
+        const Image8UC1::Pointer& fixed,
+        const Image8UC1::Pointer& moving,
+        size_t iterations,
+        double sampleFactor,
+        double regionWidth);
+    /** Run the ITKv4 optimizer for a single pyramid level */
+    void compute_level_v4_(
+        const Image8UC1::Pointer& fixed,
+        const Image8UC1::Pointer& moving,
+        size_t iterations,
+        double sampleFactor,
+        double regionWidth);
+
     /** Fixed input image */
     cv::Mat fixedImage_;
     /** Moving input image */
@@ -91,5 +180,15 @@ private:
     double gradMagTol_{DEFAULT_GRAD_MAG_TOLERANCE};
     /** Report error metrics during processing */
     bool reportMetrics_{false};
+    /** Number of pyramid levels */
+    size_t levels_{DEFAULT_LEVELS};
+    /** Per-level iteration limits */
+    std::vector<size_t> iterSchedule_;
+    /** Per-level metric sampling rates */
+    std::vector<double> sampleSchedule_;
+    /** Registration framework */
+    Framework framework_{Framework::ITKv3};
+    /** Number of ITKv4 threads */
+    unsigned threads_{0};
 };
 }  // namespace rt
@@ -0,0 +1,109 @@
+#pragma once
+
+/** @file */
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "rt/filesystem.hpp"
+
+namespace rt
+{
+
+/** @brief Key points and descriptors detected in an image */
+struct ImageFeatures {
+    /** Detected key points */
+    std::vector<cv::KeyPoint> keypoints;
+    /** One descriptor row per key point */
+    cv::Mat descriptors;
+};
+
+/**
+ * @class FeatureCache
+ * @brief Cache of detected image features
+ *
+ * Features are keyed by a hash of the image content, the detection mask, and
+ * a string describing the detector parameters (see Key()). Entries are kept
+ * in memory and, if a cache directory is set, persisted to disk so that
+ * later runs can reuse them. Each entry also records the size and type of
+ * its image, which get() checks to guard against hash collisions.
+ *
+ * All members may be called concurrently from multiple threads.
+ */
+class FeatureCache
+{
+public:
+    /** Shared pointer type */
+    using Pointer = std::shared_ptr<FeatureCache>;
+
+    /** @brief In-memory cache */
+    FeatureCache() = default;
+
+    /**
+     * @brief Cache persisted to a directory
+     *
+     * The directory is created if it does not exist.
+     */
+    explicit FeatureCache(filesystem::path dir);
+
+    /** @copydoc FeatureCache() */
+    static auto New() -> Pointer;
+
+    /** @copydoc FeatureCache(filesystem::path) */
+    static auto New(filesystem::path dir) -> Pointer;
+
+    /**
+     * @brief Compute the cache key for an image, mask, and parameter string
+     *
+     * The key is a byte-wise 64-bit FNV-1a hash of the image and mask
+     * dimensions, types, and pixel values, and of the parameter string. It
+     * is not a cryptographic hash, so distinct images can collide.
+     */
+    static auto Key(
+        const cv::Mat& img, const cv::Mat& mask, const std::string& params)
+        -> std::string;
+
+    /** @brief Directory the cache is persisted to. Empty if in-memory. */
+    [[nodiscard]] auto directory() const -> filesystem::path;
+
+    /**
+     * @brief Get the features for a key and the image it was computed from
+     *
+     * Checks memory, then the cache directory. Entries stored for an image
+     * of a different size or type are treated as missing.
+     */
+    auto get(const std::string& key, const cv::Mat& img)
+        -> std::optional<ImageFeatures>;
+
+    /** @brief Store the features detected in an image under a key */
+    void put(
+        const std::string& key,
+        const cv::Mat& img,
+        const ImageFeatures& features);
+
+private:
+    /** Cached features and the properties of their image */
+    struct Entry {
+        /** Image size */
+        cv::Size size;
+        /** Image type */
+        int type{-1};
+        /** Detected features */
+        ImageFeatures features;
+    };
+
+    /** Cache directory */
+    filesystem::path dir_;
+    /** Guards entries_ */
+    std::mutex mutex_;
+    /** In-memory entries */
+    std::unordered_map<std::string, Entry> entries_;
+};
+
+}  // namespace rt
@@ -4,6 +4,8 @@
 
 #include <opencv2/core.hpp>
 
+#include "rt/ITKImageTypes.hpp"
+#include "rt/filesystem.hpp"
 #include "rt/types/Transforms.hpp"
 
 namespace rt
@@ -17,4 +19,69 @@ namespace rt
 auto ImageTransformResampler(
     const cv::Mat& m, const cv::Size& s, const Transform::Pointer& transform)
     -> cv::Mat;
-}  // namespace rt
\ No newline at end of file
+
+/**
+ * @brief Resample a moving image using a baked deformation field. Output image
+ * is the size of the field.
+ *
+ * Uses nearest neighbor interpolation and supports any 1-4 channel image.
+ * Output matches ImageTransformResampler() called with the transform that
+ * generated the field, except where a mapped point falls within
+ * floating-point rounding of a pixel boundary.
+ *
+ * @see BakeDeformationField
+ */
+auto ImageTransformResampler(
+    const cv::Mat& m, const DeformationField::Pointer& field) -> cv::Mat;
+
+/**
+ * @brief Evaluate a transform at every pixel of an output image of size s
+ *
+ * Each pixel of the returned field holds the displacement \f$T(p) - p\f$
+ * from the output pixel to its position in the moving image. Baking a
+ * transform once and resampling many images from the field avoids
+ * re-evaluating the transform for each image.
+ */
+auto BakeDeformationField(
+    const Transform::Pointer& transform, const cv::Size& s)
+    -> DeformationField::Pointer;
+
+/**
+ * @brief Resample a moving TIFF into a tiled output TIFF, one tile at a time
+ *
+ * Neither image is ever held in memory in full. For each output tile, the
+ * tile is mapped through the transform, and only the bounding box of the
+ * moving pixels it samples is read from disk. The resampled tile is then
+ * written straight to the output. Output tiles are processed one row of
+ * tiles at a time, and each moving strip or tile is decoded at most once per
+ * row. Peak memory is bounded by the moving strips or tiles sampled by one
+ * row of output tiles, rather than the image size. Tiles are resampled,
+ * compressed, and written in parallel.
+ *
+ * This bound only holds if the moving image is tiled or split into many
+ * strips. A single-strip TIFF, which is what WriteTIFF() writes by default,
+ * is decoded in full once per row of output tiles.
+ *
+ * If TransformMapper evaluates the transform natively, output matches
+ * ImageTransformResampler(). Other transforms are evaluated one point at a
+ * time with Transform::TransformPoint(), whereas ITK's ResampleImageFilter
+ * steps linear transforms incrementally along each row. The two can differ
+ * by a pixel where a sample lands within rounding error of a pixel boundary.
+ * Samples which land exactly halfway are rounded up by both.
+ *
+ * @param moving Moving image path (.tif, .tiff)
+ * @param output Output image path (.tif, .tiff)
+ * @param s Output image size
+ * @param transform Transform from the output space to the moving space
+ * @param forceAlpha If true and the moving image does not have an alpha
+ * channel, add one before resampling
+ * @param tileSize Output tile size. Each dimension must be a multiple of 16.
+ */
+void TiledImageTransformResampler(
+    const filesystem::path& moving,
+    const filesystem::path& output,
+    const cv::Size& s,
+    const Transform::Pointer& transform,
+    bool forceAlpha = false,
+    const cv::Size& tileSize = {512, 512});
+}  // namespace rt
@@ -2,10 +2,13 @@
 
 /** @file */
 
+#include <cstddef>
+#include <iostream>
 #include <vector>
 
 #include <opencv2/core.hpp>
 
+#include "rt/FeatureCache.hpp"
 #include "rt/LandmarkRegistrationBase.hpp"
 
 namespace rt
@@ -26,10 +29,121 @@ using LandmarkPair = std::pair<cv::Point2f, cv::Point2f>;
  * between two images. To create key points bounded by a region of interest,
  * set the mask for either the static or moving image.
  *
+ * Detected features can be reused across calls and runs by providing a
+ * FeatureCache. To match one fixed image against many moving images, use
+ * computeBatch().
+ *
+ * AKAZE builds a nonlinear scale space over the entire input, so detection on
+ * very large images is slow and memory intensive. For such images, use the
+ * Tiled or CoarseToFine detection modes (see setDetectionMode()).
+ *
+ * Descriptors are matched with an exhaustive search by default. For large
+ * numbers of key points, select an approximate nearest-neighbor index with
+ * setMatcherType() and/or constrain the search to a radius around the
+ * position predicted by a coarse affine transform with setSearchRadius().
+ * The effect of these settings can be checked with matchReport().
+ *
+ * Matches which pass the ratio test can optionally be verified against a
+ * robustly estimated affine or homography model (setGeometricModel()) and
+ * capped to a spatially well-distributed subset (setMaxLandmarks()). Fewer,
+ * better landmarks make downstream landmark and deformable registration
+ * faster and more reliable.
  */
 class LandmarkDetector
 {
 public:
+    /** @brief Feature detection strategy */
+    enum class DetectionMode {
+        Full,        /** Detect features over the whole image at once */
+        Tiled,       /**
+                      * Detect features in overlapping tiles, in parallel.
+                      * Tile size and overlap are set with setTileSize() and
+                      * setTileOverlap().
+                      */
+        CoarseToFine /**
+                      * Match features detected in images downsampled by
+                      * coarseScale(), then refine each match by matching
+                      * features detected in full-resolution windows of
+                      * radius refineRadius() around the coarse positions.
+                      */
+    };
+
+    /** @brief Descriptor matching backend */
+    enum class MatcherType {
+        BruteForce,            /** Exhaustive Hamming distance search */
+        LSH,                   /**
+                                * Approximate search using a
+                                * locality-sensitive hashing index
+                                */
+        HierarchicalClustering /**
+                                * Approximate search using a hierarchical
+                                * clustering index
+                                */
+    };
+
+    /** @brief Model used for geometric verification of matches */
+    enum class GeometricModel {
+        None,      /** Do not verify matches */
+        Affine,    /** Keep matches consistent with an affine transform */
+        Homography /** Keep matches consistent with a homography */
+    };
+
+    /** @brief Robust estimator used for geometric verification */
+    enum class RobustEstimator {
+        RANSAC, /** RANSAC */
+        PROSAC, /**
+                 * PROSAC. Samples the strongest matches first. Requires
+                 * OpenCV 4.5.1 or newer, otherwise RANSAC is used.
+                 */
+        MAGSAC  /**
+                 * MAGSAC++. Less sensitive to the inlier threshold. Requires
+                 * OpenCV 4.5.1 or newer, otherwise RANSAC is used.
+                 */
+    };
+
+    /** @brief Statistics for the last call to compute() */
+    struct MatchReport {
+        /** Number of key points detected in the fixed image */
+        std::size_t fixedKeypoints{0};
+        /** Number of key points detected in the moving image */
+        std::size_t movingKeypoints{0};
+        /** Number of matches which passed the ratio test */
+        std::size_t matches{0};
+        /** Whether the matches were geometrically verified */
+        bool verified{false};
+        /**
+         * Number of matches consistent with the geometric verification
+         * model. Always 0 if verification is disabled, since no model is fit.
+         */
+        std::size_t inliers{0};
+        /** Number of matches removed by geometric verification */
+        std::size_t outliersRejected{0};
+        /** Number of landmark pairs returned */
+        std::size_t landmarks{0};
+        /** Whether matching was constrained around predicted positions */
+        bool spatiallyConstrained{false};
+        /** Time spent detecting features, in seconds */
+        double detectSeconds{0};
+        /** Time spent matching features, in seconds */
+        double matchSeconds{0};
+        /** Time spent verifying and capping matches, in seconds */
+        double filterSeconds{0};
+
+        /** @brief Fraction of matches which are inliers */
+        [[nodiscard]] auto inlierRatio() const -> double;
+    };
+
+    /** Default tile size, in pixels */
+    static constexpr int DEFAULT_TILE_SIZE{2048};
+    /** Default tile overlap, in pixels */
+    static constexpr int DEFAULT_TILE_OVERLAP{128};
+    /** Default coarse image scale */
+    static constexpr double DEFAULT_COARSE_SCALE{0.25};
+    /** Default refinement window radius, in full resolution pixels */
+    static constexpr int DEFAULT_REFINE_RADIUS{64};
+    /** Default geometric verification inlier threshold, in pixels */
+    static constexpr double DEFAULT_INLIER_THRESHOLD{3};
+
     /** @brief Set the fixed image */
     void setFixedImage(const cv::Mat& img);
     /** @brief Set the fixed image mask */
@@ -42,6 +156,98 @@ public:
     void setMatchRatio(float r);
     /** @copydoc setMatchRatio(float) */
     [[nodiscard]] auto matchRatio() const -> float;
+    /**
+     * @brief Set the cache used to store detected features
+     *
+     * If not set, features are detected on every call to compute().
+     */
+    void setFeatureCache(FeatureCache::Pointer cache);
+    /** @copydoc setFeatureCache(FeatureCache::Pointer) */
+    [[nodiscard]] auto featureCache() const -> FeatureCache::Pointer;
+    /** @brief Set the feature detection mode */
+    void setDetectionMode(DetectionMode mode);
+    /** @copydoc setDetectionMode(DetectionMode) */
+    [[nodiscard]] auto detectionMode() const -> DetectionMode;
+    /**
+     * @brief Set the width and height of detection tiles
+     *
+     * Used by the Tiled mode. Also used for coarse detection in the
+     * CoarseToFine mode.
+     */
+    void setTileSize(int size);
+    /** @copydoc setTileSize(int) */
+    [[nodiscard]] auto tileSize() const -> int;
+    /**
+     * @brief Set the number of pixels by which each tile is extended on each
+     * side
+     *
+     * Key points are only kept by the tile which contains them before
+     * extension, so the overlap should be at least as large as the feature
+     * support region to avoid losing key points at tile borders.
+     */
+    void setTileOverlap(int overlap);
+    /** @copydoc setTileOverlap(int) */
+    [[nodiscard]] auto tileOverlap() const -> int;
+    /** @brief Set the image scale used for coarse detection. Range: (0, 1] */
+    void setCoarseScale(double scale);
+    /** @copydoc setCoarseScale(double) */
+    [[nodiscard]] auto coarseScale() const -> double;
+    /** @brief Set the radius of the full resolution refinement windows */
+    void setRefineRadius(int radius);
+    /** @copydoc setRefineRadius(int) */
+    [[nodiscard]] auto refineRadius() const -> int;
+    /** @brief Set the descriptor matching backend */
+    void setMatcherType(MatcherType type);
+    /** @copydoc setMatcherType(MatcherType) */
+    [[nodiscard]] auto matcherType() const -> MatcherType;
+    /**
+     * @brief Set the spatial search radius, in moving image pixels
+     *
+     * If greater than zero, each fixed key point is only compared against
+     * moving key points within this radius of its predicted position in the
+     * moving image. Positions are predicted using the transform set by
+     * setPredictedTransform(). If no transform is set, one is estimated from
+     * the strongest key points in each image. If this estimate fails,
+     * matching falls back to an unconstrained search. Default: 0 (disabled)
+     */
+    void setSearchRadius(float radius);
+    /** @copydoc setSearchRadius(float) */
+    [[nodiscard]] auto searchRadius() const -> float;
+    /**
+     * @brief Set the 2x3 affine transform which maps fixed image positions
+     * to predicted moving image positions
+     *
+     * Only used if the search radius is greater than zero. Set an empty
+     * matrix to estimate the transform automatically.
+     */
+    void setPredictedTransform(const cv::Mat& tfm);
+    /** @copydoc setPredictedTransform(const cv::Mat&) */
+    [[nodiscard]] auto predictedTransform() const -> cv::Mat;
+    /** @brief Set the geometric verification model. Default: None */
+    void setGeometricModel(GeometricModel model);
+    /** @copydoc setGeometricModel(GeometricModel) */
+    [[nodiscard]] auto geometricModel() const -> GeometricModel;
+    /** @brief Set the geometric verification estimator. Default: RANSAC */
+    void setRobustEstimator(RobustEstimator estimator);
+    /** @copydoc setRobustEstimator(RobustEstimator) */
+    [[nodiscard]] auto robustEstimator() const -> RobustEstimator;
+    /**
+     * @brief Set the maximum distance, in moving image pixels, between a
+     * matched position and its position predicted by the verification model
+     */
+    void setInlierThreshold(double t);
+    /** @copydoc setInlierThreshold(double) */
+    [[nodiscard]] auto inlierThreshold() const -> double;
+    /**
+     * @brief Set the maximum number of landmark pairs to return
+     *
+     * If more matches are found, a subset which is evenly distributed over
+     * the fixed image is returned, preferring the strongest matches.
+     * Default: 0 (unlimited)
+     */
+    void setMaxLandmarks(std::size_t n);
+    /** @copydoc setMaxLandmarks(std::size_t) */
+    [[nodiscard]] auto maxLandmarks() const -> std::size_t;
 
     /** @brief Compute key point matches between the fixed and moving images
      *
@@ -50,6 +256,21 @@ public:
      */
     auto compute() -> std::vector<LandmarkPair>;
 
+    /**
+     * @brief Compute key point matches between the fixed image and each of
+     * a list of moving images
+     *
+     * Features for the fixed image are detected once. The moving images are
+     * processed in parallel. If provided, movingMasks must have one entry per
+     * moving image, though individual entries may be empty. The result has
+     * one list of matches per moving image, in the same order. Does not
+     * change the results returned by getLandmarkPairs().
+     */
+    auto computeBatch(
+        const std::vector<cv::Mat>& movingImgs,
+        const std::vector<cv::Mat>& movingMasks = {})
+        -> std::vector<std::vector<LandmarkPair>>;
+
     /**
      * @brief Get the computed matches
      *
@@ -58,12 +279,55 @@ public:
      */
     auto getLandmarkPairs() -> std::vector<LandmarkPair>;
 
+    /** @brief Get the statistics for the last call to compute() */
+    [[nodiscard]] auto matchReport() const -> MatchReport;
+
     /** @brief Get the detected landmarks for the fixed image */
     [[nodiscard]] auto getFixedLandmarks() const -> LandmarkContainer;
     /** @brief Get the detected landmarks for the moving image */
     [[nodiscard]] auto getMovingLandmarks() const -> LandmarkContainer;
 
 private:
+    /**
+     * Detect features in an image according to the detection mode, using the
+     * cache if available. Key point positions are always in full resolution
+     * image coordinates.
+     */
+    auto detect_(const cv::Mat& img, const cv::Mat& mask) const
+        -> ImageFeatures;
+    /**
+     * Match fixed features to moving features. If spatial is true and the
+     * search radius is set, constrain the search around predicted positions.
+     * Sets constrained to whether the search was constrained.
+     */
+    auto match_(
+        const ImageFeatures& fixed,
+        const ImageFeatures& moving,
+        bool spatial = false,
+        bool* constrained = nullptr) const -> std::vector<LandmarkPair>;
+    /**
+     * Remove matches inconsistent with the geometric model. If numInliers is
+     * set, it receives the number of matches consistent with the model, or 0
+     * if there is no model.
+     */
+    auto verify_(
+        const std::vector<LandmarkPair>& matches,
+        std::size_t* numInliers = nullptr) const -> std::vector<LandmarkPair>;
+    /** Get the predicted fixed to moving transform. Empty on failure. */
+    auto predict_(const ImageFeatures& fixed, const ImageFeatures& moving)
+        const -> cv::Mat;
+    /** Match fixed and moving images using precomputed fixed features */
+    auto matchImages_(
+        const ImageFeatures& fixed,
+        const cv::Mat& movingImg,
+        const cv::Mat& movingMask,
+        MatchReport* report = nullptr) const -> std::vector<LandmarkPair>;
+    /** Refine coarse matches in full resolution windows */
+    auto refine_(
+        const std::vector<LandmarkPair>& coarse,
+        const cv::Mat& movingImg,
+        const cv::Mat& movingMask) const -> std::vector<LandmarkPair>;
+
     /** Fixed image */
     cv::Mat fixedImg_;
     /** Fixed image mask */
@@ -76,5 +340,37 @@ private:
     std::vector<LandmarkPair> output_;
     /** Nearest-neighbor matching ratio */
     float nnMatchRatio_{0.3F};
+    /** Feature cache */
+    FeatureCache::Pointer cache_;
+    /** Detection mode */
+    DetectionMode mode_{DetectionMode::Full};
+    /** Tile size */
+    int tileSize_{DEFAULT_TILE_SIZE};
+    /** Tile overlap */
+    int tileOverlap_{DEFAULT_TILE_OVERLAP};
+    /** Coarse detection scale */
+    double coarseScale_{DEFAULT_COARSE_SCALE};
+    /** Refinement window radius */
+    int refineRadius_{DEFAULT_REFINE_RADIUS};
+    /** Matching backend */
+    MatcherType matcherType_{MatcherType::BruteForce};
+    /** Spatial search radius */
+    float searchRadius_{0};
+    /** Predicted fixed to moving transform */
+    cv::Mat predictedTfm_;
+    /** Geometric verification model */
+    GeometricModel model_{GeometricModel::None};
+    /** Geometric verification estimator */
+    RobustEstimator estimator_{RobustEstimator::RANSAC};
+    /** Geometric verification inlier threshold */
+    double inlierThreshold_{DEFAULT_INLIER_THRESHOLD};
+    /** Maximum number of landmark pairs */
+    std::size_t maxLandmarks_{0};
+    /** Statistics for the last call to compute() */
+    MatchReport report_;
 };
+
+/** @brief Print a LandmarkDetector::MatchReport */
+auto operator<<(std::ostream& os, const LandmarkDetector::MatchReport& r)
+    -> std::ostream&;
 }  // namespace rt
@@ -0,0 +1,125 @@
+#pragma once
+
+/** @file */
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "rt/ParallelRayCaster.hpp"
+#include "rt/types/ITKMesh.hpp"
+#include "rt/types/UVMap.hpp"
+
+namespace rt
+{
+/**
+ * @class MeshAccelerator
+ * @brief Reusable, precomputed data for sampling a UV-mapped mesh
+ *
+ * Holds flat vertex, face, and per-face UV arrays for a mesh and its UV map.
+ * Derived structures are built the first time they are requested and then
+ * cached: the oriented bounding box, the average UV pixel density for a
+ * given texture size, and a BVH ray caster per ray direction. The ray
+ * casters for different directions share a single BVH.
+ *
+ * Attach one accelerator to many ReorderUnorganizedTexture runs over the
+ * same mesh (e.g. a sweep over sample rates or sampling origins) to avoid
+ * recomputing any of these.
+ *
+ * All const members may be called concurrently from multiple threads.
+ */
+class MeshAccelerator
+{
+public:
+    /** Shared pointer type */
+    using Pointer = std::shared_ptr<MeshAccelerator>;
+
+    /** Triangle vertex indices */
+    using Face = ParallelRayCaster::Face;
+
+    /** @brief Oriented bounding box, as computed by vtkOBBTree */
+    struct OBB {
+        /** Corner of the box */
+        cv::Vec3d origin;
+        /** Longest axis. Length is the box size along this axis. */
+        cv::Vec3d xAxis;
+        /** Middle axis. Length is the box size along this axis. */
+        cv::Vec3d yAxis;
+        /** Shortest axis. Length is the box size along this axis. */
+        cv::Vec3d zAxis;
+    };
+
+    /**
+     * @brief Flatten a mesh and its UV map
+     *
+     * Face indices are in cell iteration order.
+     *
+     * @throws std::invalid_argument if mesh is null
+     */
+    MeshAccelerator(const ITKMesh::Pointer& mesh, const UVMap& uv);
+
+    /** @copydoc MeshAccelerator(const ITKMesh::Pointer&, const UVMap&) */
+    static auto New(const ITKMesh::Pointer& mesh, const UVMap& uv) -> Pointer;
+
+    /** @brief Source mesh */
+    [[nodiscard]] auto mesh() const -> ITKMesh::Pointer;
+
+    /** @brief Source UV map */
+    [[nodiscard]] auto uvMap() const -> const UVMap&;
+
+    /** @brief Vertex positions */
+    [[nodiscard]] auto vertices() const -> const std::vector<cv::Vec3d>&;
+
+    /** @brief Triangle faces */
+    [[nodiscard]] auto faces() const -> const std::vector<Face>&;
+
+    /** @brief UV coordinates of each face's vertices, 3 per face */
+    [[nodiscard]] auto faceUVs() const -> const std::vector<cv::Vec2d>&;
+
+    /** @brief Oriented bounding box of the mesh */
+    [[nodiscard]] auto obb() const -> OBB;
+
+    /**
+     * @brief Average ratio of 3D edge length to 2D edge length (in pixels)
+     *
+     * The 2D edge length is measured in a texture image of size s.
+     */
+    [[nodiscard]] auto uvDensity(const cv::Size& s) const -> double;
+
+    /**
+     * @brief Ray caster for rays with the given direction
+     *
+     * The returned reference is valid for the lifetime of the accelerator.
+     */
+    [[nodiscard]] auto rayCaster(const cv::Vec3d& direction) const
+        -> const ParallelRayCaster&;
+
+private:
+    /** Source mesh */
+    ITKMesh::Pointer mesh_;
+    /** Source UV map */
+    UVMap uv_;
+    /** Vertex positions */
+    std::vector<cv::Vec3d> vertices_;
+    /** Triangle faces */
+    std::vector<Face> faces_;
+    /** Per-face vertex UVs */
+    std::vector<cv::Vec2d> faceUVs_;
+
+    /** Guards the cached values */
+    mutable std::mutex mutex_;
+    /** Cached bounding box */
+    mutable std::optional<OBB> obb_;
+    /** Cached UV densities by texture size */
+    mutable std::map<std::pair<int, int>, double> density_;
+    /** Cached ray casters by direction */
+    mutable std::vector<
+        std::pair<cv::Vec3d, std::unique_ptr<ParallelRayCaster>>>
+        casters_;
+};
+}  // namespace rt
@@ -0,0 +1,123 @@
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "rt/types/ITKMesh.hpp"
+
+namespace rt
+{
+/**
+ * @class ParallelRayCaster
+ * @brief Intersect a triangle mesh with a grid of parallel rays
+ *
+ * Rays are cast in square packets of up to PacketDim x PacketDim rays which
+ * share a direction. A packet traverses the BVH together: a node is visited
+ * if any ray in the packet hits its bounds. Ray/triangle intersection then
+ * runs over every ray in the packet at once. Because the direction is fixed,
+ * the direction-dependent part of each triangle test is precomputed when the
+ * caster is constructed. The inner loops are over structure-of-arrays ray
+ * data in single precision, so the compiler can vectorize them.
+ *
+ * Triangles are stored in single precision relative to the center of the
+ * mesh bounds to preserve precision for meshes far from the origin.
+ *
+ * The returned barycentric coordinates (u, v) follow bvh::Triangle: a hit
+ * point on face (a, b, c) is at (1 - u - v) * a + u * b + v * c.
+ *
+ * The BVH does not depend on the ray direction. withDirection() returns a
+ * caster for a new direction which shares it.
+ *
+ * cast() is const and may be called concurrently from multiple threads.
+ */
+class ParallelRayCaster
+{
+public:
+    /** @brief Width and height of a ray packet */
+    static constexpr int PacketDim{8};
+
+    /** @brief Triangle vertex indices */
+    using Face = cv::Vec<std::size_t, 3>;
+
+    /** @brief Face index of a ray which does not hit the mesh */
+    static constexpr std::size_t NoHit{std::numeric_limits<std::size_t>::max()};
+
+    /** @brief Closest intersection of a ray with the mesh */
+    struct Hit {
+        /** Index of the intersected face, or NoHit */
+        std::size_t face{NoHit};
+        /** Distance along the ray */
+        float distance{0};
+        /** Barycentric coordinate of the 2nd face vertex */
+        float u{0};
+        /** Barycentric coordinate of the 3rd face vertex */
+        float v{0};
+    };
+
+    /**
+     * @brief Build the acceleration structure for a triangle mesh
+     *
+     * @param mesh Triangle mesh. Face indices are cell iteration order.
+     * @param direction Direction shared by all rays. Must be unit length.
+     * @throws std::invalid_argument if mesh is null
+     */
+    ParallelRayCaster(const ITKMesh::Pointer& mesh, const cv::Vec3d& direction);
+
+    /**
+     * @brief Build the acceleration structure for flat mesh arrays
+     *
+     * Face indices are positions in faces.
+     *
+     * @throws std::invalid_argument if faces is empty
+     * @throws std::out_of_range if a face references a missing vertex
+     */
+    ParallelRayCaster(
+        const std::vector<cv::Vec3d>& vertices,
+        const std::vector<Face>& faces,
+        const cv::Vec3d& direction);
+
+    /** @brief Move constructor */
+    ParallelRayCaster(ParallelRayCaster&& other) noexcept;
+
+    /** @brief Move assignment */
+    auto operator=(ParallelRayCaster&& other) noexcept -> ParallelRayCaster&;
+
+    /** @brief Default destructor */
+    ~ParallelRayCaster();
+
+    /** @brief Get a caster for another direction which shares this BVH */
+    [[nodiscard]] auto withDirection(const cv::Vec3d& direction) const
+        -> ParallelRayCaster;
+
+    /**
+     * @brief Cast a packet of nu x nv rays
+     *
+     * Ray (i, j) starts at origin + i * du + j * dv and is intersected in the
+     * range (0, tMax). Its hit is written to hits[j * PacketDim + i].
+     * nu and nv must be in [1, PacketDim].
+     */
+    void cast(
+        const cv::Vec3d& origin,
+        const cv::Vec3d& du,
+        const cv::Vec3d& dv,
+        int nu,
+        int nv,
+        double tMax,
+        Hit* hits) const;
+
+private:
+    /** Empty caster, for withDirection() */
+    ParallelRayCaster();
+
+    /** BVH and packed triangles */
+    struct Impl;
+    /** Implementation */
+    std::unique_ptr<Impl> impl_;
+};
+}  // namespace rt
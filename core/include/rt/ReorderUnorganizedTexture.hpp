@@ -4,6 +4,7 @@
 
 #include <opencv2/core.hpp>
 
+#include "rt/MeshAccelerator.hpp"
 #include "rt/types/ITKMesh.hpp"
 #include "rt/types/UVMap.hpp"
 
@@ -29,6 +30,10 @@ namespace rt
  * and placed into the pixel. A UV map is also generated that maps the original
  * input mesh to the new texture image.
  *
+ * Because every ray is parallel, the same result can be produced by
+ * rasterizing the mesh into the XY plane with a depth buffer. This is
+ * selected with setSamplingEngine(). Rasterization does not need a BVH and
+ * its cost is proportional to the number of faces plus covered pixels.
  */
 class ReorderUnorganizedTexture
 {
@@ -64,6 +69,12 @@ public:
                        */
     };
 
+    /** @brief Method used to find the mesh point behind each pixel */
+    enum class SamplingEngine {
+        RayCast,  /** Cast a ray through each pixel against a BVH */
+        Rasterize /** Rasterize the mesh faces into a depth buffer */
+    };
+
     /**
      * Default distance (in mesh units) at which to sample the XY plane into
      * image
@@ -77,6 +88,22 @@ public:
     /** @brief Set the input, unorganized texture image */
     void setTextureMat(const cv::Mat& img);
 
+    /**
+     * @brief Set the input mesh and UV map from a shared accelerator
+     *
+     * The accelerator caches the mesh's flattened arrays, BVH, bounding box,
+     * and UV density. Reuse one accelerator for many sampling configurations
+     * of the same mesh. If not set, compute() builds one, which is reused by
+     * later calls to compute() until setMesh() or setUVMap() is called. Both
+     * always discard the cached accelerator, even when passed the same mesh,
+     * since the mesh may have been modified in place. This function is the
+     * only way to share an accelerator between calls or instances.
+     */
+    void setMeshAccelerator(const MeshAccelerator::Pointer& accel);
+
+    /** @brief Get the current mesh accelerator. May be null. */
+    [[nodiscard]] auto meshAccelerator() const -> MeshAccelerator::Pointer;
+
     /** @copydoc samplingOrigin() */
     void setSamplingOrigin(SamplingOrigin o);
 
@@ -112,6 +139,12 @@ public:
     /** @copydoc setSampleDim() */
     [[nodiscard]] auto sampleDim() const -> std::size_t;
 
+    /** @copydoc samplingEngine() */
+    void setSamplingEngine(SamplingEngine e);
+
+    /** @brief Method used to sample the mesh */
+    [[nodiscard]] auto samplingEngine() const -> SamplingEngine;
+
     /** @brief Whether to use the first mesh intersection point */
     void setUseFirstIntersection(bool b);
 
@@ -137,6 +170,27 @@ public:
 private:
     /** Resample the input image into the organized texture */
     void create_texture_();
+    /**
+     * Sample the mesh by ray casting. Calls shade(v, u, face, bu, bv) for
+     * every output pixel which hits the mesh.
+     */
+    template <typename ShadeFn>
+    void sample_ray_cast_(
+        const cv::Vec3d& start,
+        const cv::Vec3d& du,
+        const cv::Vec3d& dv,
+        const cv::Vec3d& dir,
+        double tMax,
+        const ShadeFn& shade);
+    /** Sample the mesh by rasterization. @see sample_ray_cast_() */
+    template <typename ShadeFn>
+    void sample_rasterize_(
+        const cv::Vec3d& start,
+        const cv::Vec3d& du,
+        const cv::Vec3d& dv,
+        const cv::Vec3d& dir,
+        double tMax,
+        const ShadeFn& shade);
     /**
      * Generate a new UV map relating the input mesh to the organized texture
      */
@@ -148,11 +202,15 @@ private:
     UVMap inputUV_;
     /** Input texture image */
     cv::Mat inputTexture_;
+    /** Mesh acceleration structures */
+    MeshAccelerator::Pointer accel_;
 
     /** Sample origin */
     SamplingOrigin sampleOrigin_{SamplingOrigin::TopLeft};
     /** Sample mode */
     SamplingMode sampleMode_{SamplingMode::Rate};
+    /** Sampling engine */
+    SamplingEngine sampleEngine_{SamplingEngine::RayCast};
     /** XY plane sample rate (in mesh units) */
     double sampleRate_{DEFAULT_SAMPLE_RATE};
     /** Length of the predefined sampling dimension */
@@ -0,0 +1,72 @@
+#pragma once
+
+/** @file */
+
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "rt/types/Transforms.hpp"
+
+namespace rt
+{
+/**
+ * @class TransformMapper
+ * @brief Map the pixel grid of an output image through a Transform
+ *
+ * For every output pixel (x, y), this computes the physical point in the
+ * moving image that ITK's ResampleImageFilter would sample, assuming unit
+ * spacing, zero origin, and identity direction for both images (the defaults
+ * used by CVMatToITKImage()).
+ *
+ * If the transform is a (possibly nested) CompositeTransform made up only of
+ * affine-like transforms (itk::MatrixOffsetTransformBase), identity
+ * transforms, and cubic itk::BSplineTransform, and it contains at least one
+ * B-spline, it is evaluated natively. The native evaluator uses the same
+ * formulas and summation order as ITK. When the first B-spline in the chain
+ * sees the regular output grid, its basis weights are separable. So they are
+ * precomputed once per output row and column rather than once per pixel. All
+ * other transforms, including chains without a B-spline, fall back to
+ * Transform::TransformPoint().
+ *
+ * mapRow() is const and may be called concurrently from multiple threads.
+ */
+class TransformMapper
+{
+public:
+    /**
+     * @brief Construct a mapper for an output image of size s
+     *
+     * @throws std::invalid_argument if transform is null
+     */
+    TransformMapper(const Transform::Pointer& transform, const cv::Size& s);
+
+    /** @brief Default destructor */
+    ~TransformMapper();
+
+    /** @brief Output image size */
+    [[nodiscard]] auto size() const -> cv::Size;
+
+    /** @brief Whether the transform is evaluated by the native engine */
+    [[nodiscard]] auto isNative() const -> bool;
+
+    /**
+     * @brief Map pixels [x0, x0 + n) of output row y
+     *
+     * The moving image coordinates of each pixel are written to xs and ys,
+     * which must have room for n values.
+     */
+    void mapRow(int y, int x0, int n, double* xs, double* ys) const;
+
+private:
+    /** Native evaluation stages */
+    struct Impl;
+    /** Native implementation. Null if falling back to TransformPoint */
+    std::unique_ptr<Impl> impl_;
+    /** Source transform */
+    Transform::Pointer transform_;
+    /** Output size */
+    cv::Size size_;
+};
+}  // namespace rt
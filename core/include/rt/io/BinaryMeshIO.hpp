@@ -0,0 +1,62 @@
+#pragma once
+
+/** @file */
+
+#include "rt/filesystem.hpp"
+#include "rt/types/ITKMesh.hpp"
+#include "rt/types/UVMap.hpp"
+
+namespace rt::io
+{
+
+/** @brief File extension for binary mesh files */
+constexpr auto BINARY_MESH_EXTENSION = ".rtmesh";
+
+/** @brief Contents of a binary mesh file */
+struct BinaryMesh {
+    /** Triangle mesh. Vertex normals are stored as point data. */
+    ITKMesh::Pointer mesh;
+    /** Per-face UV map. Empty if the file has no UVs. */
+    UVMap uvMap;
+    /**
+     * Texture image path. Relative paths are resolved against the mesh
+     * file's directory. Empty if the file has no texture reference.
+     */
+    filesystem::path texturePath;
+};
+
+/**
+ * @brief Write a mesh to a binary mesh file (.rtmesh)
+ *
+ * The file is a fixed-size header followed by the texture path, vertex
+ * positions, vertex normals (if every vertex has one), triangle faces, UV
+ * coordinates, and UV faces. Every array starts on an 8-byte boundary so the
+ * file can be used directly from a single memory mapping. Values are stored
+ * in native byte order.
+ *
+ * @param path Output file path
+ * @param mesh Triangle mesh
+ * @param uvMap Per-face UV map. May be empty.
+ * @param texturePath Texture image path. Stored as given; relative paths
+ * should be relative to the output file's directory.
+ *
+ * @throws rt::IOException if the file cannot be written or the mesh has
+ * non-triangular faces
+ */
+void WriteBinaryMesh(
+    const filesystem::path& path,
+    const ITKMesh::Pointer& mesh,
+    const UVMap& uvMap = UVMap(),
+    const filesystem::path& texturePath = filesystem::path());
+
+/**
+ * @brief Read a binary mesh file (.rtmesh)
+ *
+ * The file is memory mapped and the mesh is built from it in parallel.
+ *
+ * @throws rt::IOException if the file cannot be read or is not a valid
+ * binary mesh file
+ */
+auto ReadBinaryMesh(const filesystem::path& path) -> BinaryMesh;
+
+}  // namespace rt::io
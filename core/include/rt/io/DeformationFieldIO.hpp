@@ -0,0 +1,19 @@
+#pragma once
+
+/** @file */
+
+#include "rt/ITKImageTypes.hpp"
+#include "rt/filesystem.hpp"
+
+namespace rt
+{
+
+/** @brief Write a DeformationField to a file (.dfield) */
+void WriteDeformationField(
+    const filesystem::path& path, const DeformationField::Pointer& field);
+
+/** @brief Read a DeformationField from a file (.dfield) */
+auto ReadDeformationField(const filesystem::path& path)
+    -> DeformationField::Pointer;
+
+}  // namespace rt
@@ -5,6 +5,7 @@
 #include <opencv2/core.hpp>
 
 #include "rt/filesystem.hpp"
+#include "rt/io/TIFFIO.hpp"
 
 namespace rt
 {
@@ -25,7 +26,11 @@ auto ReadImage(const filesystem::path& path) -> cv::Mat;
  *
  * Use rt::WriteTIFF for all tiff images, which includes support for
  * transparency and floating-point images. Otherwise, uses cv::imwrite.
+ * The TIFF options are ignored for other formats.
  */
-void WriteImage(const filesystem::path& path, const cv::Mat& img);
+void WriteImage(
+    const filesystem::path& path,
+    const cv::Mat& img,
+    const io::TIFFWriteOptions& tiffOptions = {});
 
 }  // namespace rt
\ No newline at end of file
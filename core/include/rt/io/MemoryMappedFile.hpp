@@ -0,0 +1,66 @@
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "rt/filesystem.hpp"
+
+namespace rt::io
+{
+
+/**
+ * @class MemoryMappedFile
+ * @brief Read-only view of a file's contents
+ *
+ * Maps the file into memory where the platform supports it. Elsewhere, the
+ * file is read into an internal buffer. In both cases the contents are
+ * available through data() and size() until the object is destroyed.
+ *
+ * Throws rt::IOException if the file cannot be opened or mapped.
+ */
+class MemoryMappedFile
+{
+public:
+    /** @brief Map the file at the given path */
+    explicit MemoryMappedFile(const filesystem::path& path);
+
+    /** @brief Unmap the file */
+    ~MemoryMappedFile();
+
+    /** @brief Not copyable */
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    /** @brief Not copyable */
+    auto operator=(const MemoryMappedFile&) -> MemoryMappedFile& = delete;
+
+    /** @brief Move constructor */
+    MemoryMappedFile(MemoryMappedFile&& other) noexcept;
+    /** @brief Move assignment */
+    auto operator=(MemoryMappedFile&& other) noexcept -> MemoryMappedFile&;
+
+    /** @brief Pointer to the first byte. nullptr if the file is empty. */
+    [[nodiscard]] auto data() const -> const char*;
+
+    /** @brief Number of bytes in the file */
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /** @brief File contents as a string_view */
+    [[nodiscard]] auto view() const -> std::string_view;
+
+private:
+    /** Release the mapping or buffer */
+    void release_();
+
+    /** Start of the file contents */
+    const char* data_{nullptr};
+    /** Size of the file contents */
+    std::size_t size_{0};
+    /** Whether data_ is a memory mapping */
+    bool mapped_{false};
+    /** Contents when the file could not be mapped */
+    std::vector<char> buffer_;
+};
+
+}  // namespace rt::io
@@ -2,7 +2,9 @@
 
 /** @file */
 
-#include <fstream>
+#include <array>
+#include <string>
+#include <vector>
 
 #include <opencv2/core.hpp>
 
@@ -24,6 +26,9 @@ namespace rt::io
  * include. Other material properties are currently ignored. Throws
  * rt::IOException on error.
  *
+ * The OBJ file is memory mapped and split into chunks at line boundaries.
+ * Chunks are parsed in parallel and then merged in file order, so element
+ * indices match a sequential read.
  */
 class OBJReader
 {
@@ -52,6 +57,13 @@ public:
      */
     auto getTextureMat() -> cv::Mat;
 
+    /**
+     * @brief Return the texture image path parsed from the MTL file
+     *
+     * Empty if the OBJ does not reference a texture image.
+     */
+    auto getTexturePath() const -> filesystem::path;
+
 private:
     /**
      * 3-Tuple linking a vertex to its position, UV, and normal elements
@@ -64,25 +76,16 @@ private:
      */
     using VertexRefs = cv::Vec<std::size_t, 3>;
 
-    /** A list of at least three OBJReader::VertexRefs comprise a face */
-    using Face = std::vector<VertexRefs>;
+    /** Three OBJReader::VertexRefs comprise a triangular face */
+    using Face = std::array<VertexRefs, 3>;
 
     /** Clear all temporary data structures */
     void reset_();
 
     /** Parse the mesh */
     void parse_();
-    /** Handle parsed vertex lines */
-    void parse_vertex_(const std::vector<std::string>& strs);
-    /** Handle parsed vertex normal lines */
-    void parse_normal_(const std::vector<std::string>& strs);
-    /** Handle parsed vertex UV coordinate lines */
-    void parse_tcoord_(const std::vector<std::string>& strs);
-    /** Handle parsed face lines */
-    void parse_face_(const std::vector<std::string>& strs);
-    /** Handle parsed mtllib lines */
-    void parse_mtllib_(const std::vector<std::string>& strs);
-    /** Classify a OBJReader::VertexRefs as an OBJReader::RefType */
+    /** Handle an mtllib include */
+    void parse_mtllib_(const std::string& mtlFile);
 
     /** Construct a mesh from the parsed information */
     void build_mesh_();
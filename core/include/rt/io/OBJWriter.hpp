@@ -3,8 +3,8 @@
 /** @file */
 
 #include <fstream>
-#include <map>
 #include <string>
+#include <vector>
 
 #include <opencv2/core.hpp>
 
@@ -24,6 +24,9 @@ namespace rt::io
  * Writes both textured and untextured meshes in ASCII OBJ format. Texture
  * information is automatically written if a UV map is set and is not empty.
  *
+ * Vertices, UVs, and faces are formatted in parallel into large buffers.
+ * Real numbers are written in their shortest round-trip form, so a written
+ * mesh reads back with the same values.
  */
 class OBJWriter
 {
@@ -91,8 +94,8 @@ private:
      */
     using PointLink = cv::Vec<std::size_t, 3>;
 
-    /** [ Point Index, {v, vt, vn} ] */
-    std::map<std::size_t, PointLink> pointLinks_;
+    /** {v, vt, vn} for each point, indexed by point ID */
+    std::vector<PointLink> pointLinks_;
 
     /** Input mesh */
     ITKMesh::Pointer mesh_;
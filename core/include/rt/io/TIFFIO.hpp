@@ -2,6 +2,15 @@
 
 /** @file */
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include <opencv2/core.hpp>
 
 #include "rt/filesystem.hpp"
@@ -16,21 +25,312 @@ namespace rt::io
  * other libraries have failed. It was created to handle a set of custom
  * TIFFs that had invalid Compression tags and incorrect StripOffsets.
  * This function assumes that the other important header information
- * (width, height, bit-depth, etc.) is accurate and attempts to read the first
- * TIFF strip as uncompressed binary data.
- *
+ * (width, height, bit-depth, etc.) is accurate and attempts to read every
+ * TIFF strip as uncompressed binary data. Pixels not covered by a strip are
+ * set to zero. Samples are returned in file order (e.g. RGB, not BGR).
  *
  * @param path Path to TIFF file
- * @param offset Shift the encoded strip offset by a number of bytes
+ * @param offset Shift every encoded strip offset by a number of bytes
  */
 auto ReadRawTIFF(const filesystem::path& path, int offset = 0) -> cv::Mat;
 
+/** @brief TIFF compression scheme */
+enum class TIFFCompression {
+    None,    /** No compression */
+    LZW,     /** Lempel-Ziv-Welch */
+    Deflate, /** Deflate (zlib) */
+    ZSTD     /** Zstandard. Requires libtiff built with ZSTD support. */
+};
+
+/** @brief TIFF predictor applied before compression */
+enum class TIFFPredictor {
+    None,         /** No predictor */
+    Horizontal,   /** Horizontal differencing. Integer images only. */
+    FloatingPoint /** Floating point predictor. Floating point images only. */
+};
+
+/** @brief Options for writing TIFF images */
+struct TIFFWriteOptions {
+    /**
+     * Write the image in tiles rather than strips. Tiles are compressed in
+     * parallel.
+     */
+    bool tiled{false};
+    /** Tile size. Each dimension must be a multiple of 16. */
+    cv::Size tileSize{512, 512};
+    /** Compression scheme */
+    TIFFCompression compression{TIFFCompression::LZW};
+    /** Predictor. Ignored if compression is None. */
+    TIFFPredictor predictor{TIFFPredictor::None};
+    /**
+     * Number of reduced-resolution images to write as subIFDs. Each level is
+     * half the size of the previous one. If greater than zero, the image is
+     * written tiled regardless of the tiled option.
+     */
+    int pyramidLevels{0};
+};
+
 /**
  * @brief Write a TIFF image to file
  *
  * Supports writing floating point and signed integer TIFFs, in addition to
  * unsigned 8 & 16 bit integer types. Also supports 1-4 channel images. Unless
  * you only need TIFF support, use rt::WriteImage instead.
+ *
+ * By default, writes a single LZW compressed strip. See TIFFWriteOptions for
+ * tiled output and other compression schemes. Files which may exceed 4GB
+ * are written as BigTIFF.
+ *
+ * Pyramid levels are generated in the same pass which writes the image: as
+ * each tile is encoded, it is also area-averaged into the next level, so the
+ * image is only traversed once per level.
+ */
+void WriteTIFF(
+    const filesystem::path& path,
+    const cv::Mat& img,
+    const TIFFWriteOptions& options = {});
+
+/**
+ * @brief Convert a TIFF read as uncompressed binary data to a valid TIFF
+ *
+ * Reads the input like ReadRawTIFF(), but streams each strip straight to the
+ * output encoder, so only one strip is held in memory. The output has the
+ * same strip layout as the input. Files which may exceed 4GB are written as
+ * BigTIFF.
+ *
+ * @param input Path to the raw TIFF file
+ * @param output Output path (.tif, .tiff)
+ * @param offset Shift every encoded strip offset by a number of bytes
+ * @param compression Output compression scheme
+ * @param predictor Output predictor. Ignored if compression is None.
+ */
+void ConvertRawTIFF(
+    const filesystem::path& input,
+    const filesystem::path& output,
+    int offset = 0,
+    TIFFCompression compression = TIFFCompression::LZW,
+    TIFFPredictor predictor = TIFFPredictor::None);
+
+/** @brief Basic properties of a TIFF image */
+struct TIFFHeader {
+    /** Image size */
+    cv::Size size;
+    /** Equivalent cv::Mat type */
+    int type{-1};
+    /** Whether the image is stored in tiles rather than strips */
+    bool tiled{false};
+    /** Whether the file is a BigTIFF */
+    bool bigTIFF{false};
+    /** Tile size, or the image width by the rows per strip */
+    cv::Size chunkSize;
+    /** Number of reduced-resolution subIFDs of the first image */
+    std::size_t subIFDs{0};
+};
+
+/**
+ * @brief Read the basic properties of a TIFF image without decoding it
+ *
+ * @param path Image path
+ * @param level 0 for the first image in the file, or n for its n-th
+ * reduced-resolution subIFD
+ *
+ * @throws std::runtime_error if the file cannot be opened, has an
+ * unsupported pixel type, or does not have the requested level
+ */
+auto ReadTIFFHeader(const filesystem::path& path, std::size_t level = 0)
+    -> TIFFHeader;
+
+/**
+ * @brief Read a rectangular region of a TIFF image
+ *
+ * Only the strips or tiles which intersect the region are decoded. They are
+ * decoded in parallel, with each worker thread using its own file handle.
+ * Supports stripped and tiled layouts, classic TIFF and BigTIFF, and 1-4
+ * channel images with chunky (contiguous) sample layout. Like cv::imread, 3
+ * and 4 channel images are returned in BGR(A) order.
+ *
+ * @param path Image path
+ * @param roi Region to read
+ * @param level Image or subIFD to read. See ReadTIFFHeader().
+ *
+ * @throws std::runtime_error if the file cannot be read or the region is not
+ * inside the image
+ */
+auto ReadTIFFRegion(
+    const filesystem::path& path, const cv::Rect& roi, std::size_t level = 0)
+    -> cv::Mat;
+
+/**
+ * @brief Read a TIFF image
+ *
+ * Equivalent to ReadTIFFRegion() over the full image. Unless you only need
+ * TIFF support, use rt::ReadImage instead.
+ *
+ * @throws std::runtime_error if the file cannot be read
+ */
+auto ReadTIFF(const filesystem::path& path, std::size_t level = 0)
+    -> cv::Mat;
+
+/**
+ * @class TIFFRegionReader
+ * @brief Read many regions of a TIFF image, decoding each strip or tile once
+ *
+ * Decoded strips and tiles are cached until clear() is called, so regions
+ * which share a chunk do not decode it again. This matters when regions are
+ * much smaller than the chunks, such as when reading small tiles from an
+ * image stored as a single strip. Decoded chunks are held in memory, so
+ * callers reading a large image should clear() the cache between groups of
+ * nearby regions.
+ *
+ * read() may be called concurrently from multiple threads. Each call uses
+ * its own libtiff handle. A chunk requested by several threads at once is
+ * decoded by one of them while the others wait.
+ */
+class TIFFRegionReader
+{
+public:
+    /**
+     * @brief Open a TIFF image or subIFD for reading
+     *
+     * @throws std::runtime_error if the file cannot be opened or has an
+     * unsupported pixel type
+     */
+    explicit TIFFRegionReader(
+        const filesystem::path& path, std::size_t level = 0);
+
+    /** @brief Image properties */
+    [[nodiscard]] auto header() const -> const TIFFHeader&;
+
+    /**
+     * @brief Read a rectangular region
+     *
+     * Output matches ReadTIFFRegion().
+     *
+     * @throws std::runtime_error if the file cannot be read or the region is
+     * not inside the image
+     */
+    auto read(const cv::Rect& roi) -> cv::Mat;
+
+    /** @brief Release every cached strip or tile */
+    void clear();
+
+    /** @brief Number of strips or tiles decoded so far */
+    [[nodiscard]] auto chunksDecoded() const -> std::size_t;
+
+private:
+    /** Decoded strip or tile */
+    using Buffer = std::shared_ptr<const std::vector<char>>;
+    /** Get a decoded chunk from the cache, or decode it with tif */
+    auto chunk_(void* tif, std::uint32_t index) -> Buffer;
+
+    /** Image path */
+    filesystem::path path_;
+    /** Image or subIFD */
+    std::size_t level_;
+    /** Image properties */
+    TIFFHeader header_;
+    /** Decoded chunks by strip or tile index */
+    std::unordered_map<std::uint32_t, std::shared_future<Buffer>> cache_;
+    /** Number of chunks decoded */
+    std::atomic<std::size_t> decoded_{0};
+    /** Guards cache_ */
+    std::mutex mutex_;
+};
+
+/**
+ * @class TIFFTileWriter
+ * @brief Write a tiled TIFF image one tile at a time
+ *
+ * Allows images which do not fit in memory to be written incrementally.
+ * Files which may exceed 4GB are written as BigTIFF.
+ *
+ * writeTile() may be called concurrently from multiple threads. Each tile is
+ * compressed on the calling thread and only the write of the compressed data
+ * to the file is serialized.
+ *
+ * If constructed with subIFDs, call startSubIFD() after writing every tile of
+ * the current image to begin the next reduced-resolution image. All subIFDs
+ * must be written before the file is closed.
  */
-void WriteTIFF(const filesystem::path& path, const cv::Mat& img);
-}  // namespace rt
+class TIFFTileWriter
+{
+public:
+    /**
+     * @brief Open a new tiled TIFF for writing
+     *
+     * @param path Output file path (.tif, .tiff)
+     * @param size Full image size
+     * @param type cv::Mat type of the tiles. Supports 1-4 channels.
+     * @param tileSize Tile size. Each dimension must be a multiple of 16.
+     * @param compression Compression scheme
+     * @param predictor Predictor. Ignored if compression is None.
+     * @param subIFDs Number of reduced-resolution subIFDs
+     */
+    TIFFTileWriter(
+        const filesystem::path& path,
+        const cv::Size& size,
+        int type,
+        const cv::Size& tileSize = {512, 512},
+        TIFFCompression compression = TIFFCompression::LZW,
+        TIFFPredictor predictor = TIFFPredictor::None,
+        std::size_t subIFDs = 0);
+
+    /** @brief Closes the file if still open */
+    ~TIFFTileWriter();
+
+    /**@{*/
+    /** Non-copyable */
+    TIFFTileWriter(const TIFFTileWriter&) = delete;
+    auto operator=(const TIFFTileWriter&) -> TIFFTileWriter& = delete;
+    /**@}*/
+
+    /** @brief Size of the image or subIFD currently being written */
+    [[nodiscard]] auto size() const -> cv::Size;
+
+    /** @brief Tile size */
+    [[nodiscard]] auto tileSize() const -> cv::Size;
+
+    /**
+     * @brief Write the tile whose top-left corner is at origin
+     *
+     * The origin must be a multiple of the tile size. Tiles on the right and
+     * bottom edges of the image may be smaller than the tile size.
+     */
+    void writeTile(const cv::Mat& tile, const cv::Point& origin);
+
+    /**
+     * @brief Finish the current image and start the next subIFD
+     *
+     * The subIFD is half the size of the current image, rounded up. Must not
+     * be called concurrently with writeTile().
+     *
+     * @throws std::runtime_error if every subIFD has already been started
+     */
+    void startSubIFD();
+
+    /** @brief Finish writing and close the file */
+    void close();
+
+private:
+    /** libtiff handle */
+    void* tif_{nullptr};
+    /** Image size */
+    cv::Size size_;
+    /** Image type */
+    int type_;
+    /** Tile size */
+    cv::Size tileSize_;
+    /** libtiff compression scheme */
+    int compression_;
+    /** libtiff predictor */
+    int predictor_;
+    /** Number of subIFDs */
+    std::size_t subIFDs_;
+    /** Number of subIFDs started */
+    std::size_t level_{0};
+    /** Serializes access to the libtiff handle */
+    std::mutex mutex_;
+    /** Set the tags of the current directory */
+    void setTags_();
+};
+}  // namespace rt::io
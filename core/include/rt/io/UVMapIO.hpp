@@ -2,16 +2,95 @@
 
 /** @file */
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
 #include "rt/filesystem.hpp"
+#include "rt/io/MemoryMappedFile.hpp"
+#include "rt/types/Span.hpp"
 #include "rt/types/UVMap.hpp"
 
 namespace rt
 {
 
-/** @brief Write a UVMap to a file (.uvm) */
+/**
+ * @brief Write a UVMap to a file (.uvm)
+ *
+ * Writes the version 2 layout: a text header, padded to an 8-byte boundary,
+ * followed by contiguous blocks of UVs, the dense face array, and a face
+ * validity bitmap. The blocks can be memory mapped and used in place by
+ * UVMapView.
+ */
 void WriteUVMap(const rt::filesystem::path& path, const UVMap& uvMap);
 
-/** @brief Read a UVMap from a file (.uvm) */
+/**
+ * @brief Read a UVMap from a file (.uvm)
+ *
+ * Reads version 1 and version 2 files. The file is memory mapped and version
+ * 2 data blocks are bulk copied.
+ */
 auto ReadUVMap(const rt::filesystem::path& path) -> UVMap;
 
-}  // namespace rt
\ No newline at end of file
+/**
+ * @class UVMapView
+ * @brief Read-only, zero-copy view of a version 2 UVMap file
+ *
+ * Maps the file and exposes its UV and face blocks directly. Accessors
+ * mirror the non-allocating UVMap accessors. UV values are relative to the
+ * top-left storage origin. Use toUVMap() to get an editable copy.
+ *
+ * Throws rt::IOException if the file is not a valid version 2 UVMap file.
+ */
+class UVMapView
+{
+public:
+    /** @brief Map a UVMap file */
+    explicit UVMapView(const rt::filesystem::path& path);
+
+    /** @brief Number of UVs */
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /** @brief Number of valid faces */
+    [[nodiscard]] auto size_faces() const -> std::size_t;
+
+    /** @brief Origin the UV map was written with */
+    [[nodiscard]] auto origin() const -> UVMap::Origin;
+
+    /** @brief Size information (aspect ratio, width, height) */
+    [[nodiscard]] auto ratio() const -> UVMap::Ratio;
+
+    /** @brief View the UV coordinates */
+    [[nodiscard]] auto uvs() const -> Span<const cv::Vec2d>;
+
+    /** @brief View the dense Face array, indexed by face number */
+    [[nodiscard]] auto faces() const -> Span<const UVMap::Face>;
+
+    /** @brief Check for a Face by index */
+    [[nodiscard]] auto hasFace(std::size_t idx) const -> bool;
+
+    /** @brief Get the UV coordinates associated with a Face */
+    [[nodiscard]] auto faceUVs(std::size_t id) const
+        -> std::array<cv::Vec2d, 3>;
+
+    /** @brief Copy the view into a UVMap */
+    [[nodiscard]] auto toUVMap() const -> UVMap;
+
+private:
+    /** Mapped file */
+    io::MemoryMappedFile file_;
+    /** UV block */
+    Span<const cv::Vec2d> uvs_;
+    /** Face block */
+    Span<const UVMap::Face> faces_;
+    /** Face validity bitmap block */
+    Span<const std::uint64_t> hasFace_;
+    /** Number of valid faces */
+    std::size_t numFaces_{0};
+    /** Stored origin */
+    UVMap::Origin origin_{UVMap::Origin::TopLeft};
+    /** Stored ratio */
+    UVMap::Ratio ratio_;
+};
+
+}  // namespace rt
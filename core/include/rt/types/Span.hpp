@@ -0,0 +1,102 @@
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rt
+{
+
+/**
+ * @class Span
+ * @brief Non-owning view of a contiguous sequence of elements
+ *
+ * A minimal stand-in for C++20's std::span. The view is invalidated by any
+ * operation which reallocates the viewed storage.
+ */
+template <typename T>
+class Span
+{
+public:
+    /** Element type */
+    using element_type = T;
+    /** Iterator type */
+    using iterator = T*;
+
+    /** @brief Empty span */
+    constexpr Span() noexcept = default;
+
+    /** @brief View count elements starting at data */
+    constexpr Span(T* data, std::size_t count) noexcept
+        : data_{data}, size_{count}
+    {
+    }
+
+    /** @brief View the contents of a vector */
+    template <typename U, typename Alloc>
+    Span(std::vector<U, Alloc>& v) noexcept
+        : data_{v.data()}, size_{v.size()}
+    {
+    }
+
+    /** @brief View the contents of a const vector */
+    template <typename U, typename Alloc>
+    Span(const std::vector<U, Alloc>& v) noexcept
+        : data_{v.data()}, size_{v.size()}
+    {
+    }
+
+    /** @brief Pointer to the first element */
+    [[nodiscard]] constexpr auto data() const noexcept -> T* { return data_; }
+
+    /** @brief Number of elements */
+    [[nodiscard]] constexpr auto size() const noexcept -> std::size_t
+    {
+        return size_;
+    }
+
+    /** @brief Whether the span has no elements */
+    [[nodiscard]] constexpr auto empty() const noexcept -> bool
+    {
+        return size_ == 0;
+    }
+
+    /** @brief Unchecked element access */
+    constexpr auto operator[](std::size_t idx) const -> T&
+    {
+        return data_[idx];
+    }
+
+    /** @brief Checked element access */
+    [[nodiscard]] auto at(std::size_t idx) const -> T&
+    {
+        if (idx >= size_) {
+            throw std::out_of_range(
+                "span index out of range: " + std::to_string(idx));
+        }
+        return data_[idx];
+    }
+
+    /** @brief Iterator to the first element */
+    [[nodiscard]] constexpr auto begin() const noexcept -> iterator
+    {
+        return data_;
+    }
+
+    /** @brief Iterator past the last element */
+    [[nodiscard]] constexpr auto end() const noexcept -> iterator
+    {
+        return data_ + size_;
+    }
+
+private:
+    /** First element */
+    T* data_{nullptr};
+    /** Number of elements */
+    std::size_t size_{0};
+};
+
+}  // namespace rt
@@ -2,10 +2,14 @@
 
 /** @file */
 
+#include <array>
 #include <unordered_map>
+#include <vector>
 
 #include <opencv2/core.hpp>
 
+#include "rt/types/Span.hpp"
+
 namespace rt
 {
 /**
@@ -50,6 +54,11 @@ namespace rt
  * circumstances, use getFace() to retrieve the mapping between a face's
  * vertices and the UV values returned by getUV().
  *
+ * UVs and faces are stored in contiguous arrays. Faces are indexed by face
+ * number and a bitmap records which face numbers have a mapping. uvs(),
+ * faces(), and faceUVs() read this storage without allocating and are
+ * intended for per-face and per-pixel loops. The container-returning
+ * accessors are kept for compatibility and copy the storage.
  */
 class UVMap
 {
@@ -73,6 +82,22 @@ public:
     /**@{*/
     /** @brief Construct and set origin */
     explicit UVMap(Origin o = Origin::TopLeft);
+
+    /**
+     * @brief Construct from storage arrays
+     *
+     * UVs are relative to the top-left storage origin. faces is indexed by
+     * face number and hasFace marks which of its entries are valid. Used to
+     * bulk-load a UV map without per-element insertion.
+     *
+     * @throws std::invalid_argument if faces and hasFace differ in size or a
+     * valid face references a missing UV
+     */
+    UVMap(
+        std::vector<cv::Vec2d> uvs,
+        std::vector<Face> faces,
+        std::vector<bool> hasFace,
+        Origin o = Origin::TopLeft);
     /**@}*/
 
     /**@{*/
@@ -88,9 +113,26 @@ public:
     /** @brief Get the UV coordinates as a vector */
     [[nodiscard]] auto uvs_as_vector() const -> std::vector<cv::Vec2d>;
 
-    /** @brief Get the Face to UV mappings as a vector */
+    /** @brief Get the Face to UV mappings as a map */
     [[nodiscard]] auto faces_as_map() const
         -> std::unordered_map<std::size_t, Face>;
+
+    /**
+     * @brief View the UV coordinates
+     *
+     * Values are relative to the top-left storage origin. The view is
+     * invalidated by addUV().
+     */
+    [[nodiscard]] auto uvs() const -> Span<const cv::Vec2d>;
+
+    /**
+     * @brief View the Face array, indexed by face number
+     *
+     * The array covers face numbers up to the largest one added. Entries for
+     * which hasFace() is false are zero. The view is invalidated by
+     * addFace().
+     */
+    [[nodiscard]] auto faces() const -> Span<const Face>;
     /**@}*/
 
     /**@{*/
@@ -169,6 +211,16 @@ public:
     /** @brief Get the UV coordinates associated with a Face */
     [[nodiscard]] auto getFaceUVs(std::size_t id) const
         -> std::vector<cv::Vec2d>;
+
+    /**
+     * @brief Get the UV coordinates associated with a Face
+     *
+     * Values are relative to the top-left storage origin, as with
+     * getFaceUVs(). Unlike getFaceUVs(), does not allocate and does not
+     * check that the face exists.
+     */
+    [[nodiscard]] auto faceUVs(std::size_t id) const
+        -> std::array<cv::Vec2d, 3>;
     /**@}*/
 
     /**@{*/
@@ -186,8 +238,12 @@ private:
     /** UV storage */
     std::vector<cv::Vec2d> uvs_;
 
-    /** UV storage */
-    std::unordered_map<std::size_t, Face> faces_;
+    /** Face storage, indexed by face number */
+    std::vector<Face> faces_;
+    /** Whether each entry in faces_ has been added */
+    std::vector<bool> hasFace_;
+    /** Number of faces which have been added */
+    std::size_t numFaces_{0};
 
     /** Origin for set and get functions */
     Origin origin_;
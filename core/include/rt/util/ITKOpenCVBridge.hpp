@@ -8,10 +8,36 @@
 namespace rt
 {
 
+/**
+ * @brief itk::MetaDataDictionary key which records the channel order of a
+ * multi-channel image
+ *
+ * Set to "BGR" on images created by CVMatToITKImageView(), whose RGB(A) pixel
+ * components are stored in OpenCV's BGR(A) order. Images without this key are
+ * assumed to be in ITK's RGB(A) order.
+ */
+constexpr auto CHANNEL_ORDER_KEY = "ChannelOrder";
+
+/** @brief Whether an itk::Image's pixel components are in BGR(A) order */
+template <typename ITKImageType>
+auto HasBGRChannelOrder(const itk::SmartPointer<ITKImageType>& img) -> bool;
+
 /** @brief Convert an itk::Image to a cv::Mat */
 template <typename ITKImageType>
 auto ITKImageToCVMat(const itk::SmartPointer<ITKImageType>& img) -> cv::Mat;
 
+/**
+ * @brief Wrap an itk::Image's pixel buffer as a cv::Mat without copying
+ *
+ * If the image has 1 channel or its components are in BGR(A) order (see
+ * HasBGRChannelOrder()), the returned cv::Mat shares the image's buffer.
+ * In that case, the image must outlive the returned cv::Mat. Otherwise, the
+ * RGB(A) pixels are converted into a new cv::Mat.
+ */
+template <typename ITKImageType>
+auto ITKImageToCVMatView(const itk::SmartPointer<ITKImageType>& img)
+    -> cv::Mat;
+
 /**
  * @brief Convert a cv::Mat to an itk::Image
  *
@@ -23,6 +49,24 @@ auto ITKImageToCVMat(const itk::SmartPointer<ITKImageType>& img) -> cv::Mat;
  */
 template <typename ITKImageType>
 auto CVMatToITKImage(const cv::Mat& img) -> typename ITKImageType::Pointer;
+
+/**
+ * @brief Wrap a cv::Mat's pixel buffer as an itk::Image without copying
+ *
+ * The returned image shares its pixel buffer with img and holds a reference
+ * to it, so the buffer stays valid for the lifetime of the image. Writes
+ * through either are visible in both. Pixel components are not reordered.
+ * Instead, 3 and 4 channel images keep OpenCV's BGR(A) order, and this is
+ * recorded under CHANNEL_ORDER_KEY in the image's MetaDataDictionary.
+ *
+ * img is only copied if it is not continuous or if ColorConvertImage() is
+ * needed to match the channels of ITKImageType.
+ *
+ * @throws std::invalid_argument if input type has incompatible pixel type or
+ * input does not have 1, 3, or 4 channels,
+ */
+template <typename ITKImageType>
+auto CVMatToITKImageView(const cv::Mat& img) -> typename ITKImageType::Pointer;
 }  // namespace rt
 
 #include "ITKOpenCVBridgeImpl.hpp"
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include <exception>
+#include <string>
 #include <typeinfo>
 
 #include <itkConvertPixelBuffer.h>
+#include <itkImportImageContainer.h>
+#include <itkMetaDataObject.h>
 #include <itkNumericTraits.h>
 #include <itkRGBAPixel.h>
 #include <itkRGBPixel.h>
@@ -14,22 +17,10 @@ namespace rt
 
 namespace detail
 {
-/** Convert a cv::Mat to an itk::Image with a specific pixel type */
-template <typename ITKImageType, typename CVPixelType>
-auto CVMatToITKImage(const cv::Mat& img) -> typename ITKImageType::Pointer
+/** Throw if a cv::Mat pixel type can't be reinterpreted as ITKPixelType */
+template <typename ITKPixelType, typename CVPixelType>
+void CheckPixelType(int cns)
 {
-    // Typedefs
-    using ITKPixelType = typename ITKImageType::PixelType;
-    using ConvertPixelTraits = itk::DefaultConvertPixelTraits<ITKPixelType>;
-    using ConvertBuffer =
-        itk::ConvertPixelBuffer<CVPixelType, ITKPixelType, ConvertPixelTraits>;
-
-    // Dimensions
-    auto w = img.cols;
-    auto h = img.rows;
-    auto cns = img.channels();
-
-    // We won't convert depth, so make sure depth matches
     if (cns == 4) {
         if (typeid(itk::RGBAPixel<CVPixelType>) != typeid(ITKPixelType)) {
             throw std::invalid_argument("Image depths don't match");
@@ -46,6 +37,123 @@ auto CVMatToITKImage(const cv::Mat& img) -> typename ITKImageType::Pointer
         throw std::invalid_argument(
             "Unsupported channels: " + std::to_string(cns));
     }
+}
+
+/** Get the cv::Mat type equivalent to an ITK pixel type */
+template <typename PixelType>
+auto CVMatType() -> int
+{
+    using ValueType = typename itk::NumericTraits<PixelType>::ValueType;
+    auto cns = itk::NumericTraits<PixelType>::MeasurementVectorType::Dimension;
+    if (typeid(ValueType) == typeid(uint8_t)) {
+        return CV_8UC(cns);
+    } else if (typeid(ValueType) == typeid(int8_t)) {
+        return CV_8SC(cns);
+    } else if (typeid(ValueType) == typeid(uint16_t)) {
+        return CV_16UC(cns);
+    } else if (typeid(ValueType) == typeid(int16_t)) {
+        return CV_16SC(cns);
+    } else if (typeid(ValueType) == typeid(float)) {
+        return CV_32FC(cns);
+    } else if (typeid(ValueType) == typeid(int32_t)) {
+        return CV_32SC(cns);
+    } else if (typeid(ValueType) == typeid(double)) {
+        return CV_64FC(cns);
+    } else {
+        throw std::invalid_argument("Unrecognized pixel type");
+    }
+}
+
+/**
+ * ImportImageContainer which shares the buffer of a cv::Mat. Holds a
+ * reference to the cv::Mat so the buffer lives as long as the container.
+ */
+template <typename TElement>
+class MatImportImageContainer
+    : public itk::ImportImageContainer<itk::SizeValueType, TElement>
+{
+public:
+    using Self = MatImportImageContainer;
+    using Superclass = itk::ImportImageContainer<itk::SizeValueType, TElement>;
+    using Pointer = itk::SmartPointer<Self>;
+    using ConstPointer = itk::SmartPointer<const Self>;
+
+    itkNewMacro(Self);
+    itkTypeMacro(MatImportImageContainer, ImportImageContainer);
+
+    /** Share the buffer of a continuous cv::Mat */
+    void SetMat(const cv::Mat& m)
+    {
+        mat_ = m;
+        this->SetImportPointer(
+            reinterpret_cast<TElement*>(mat_.data), mat_.total(), false);
+    }
+
+protected:
+    MatImportImageContainer() = default;
+    ~MatImportImageContainer() override = default;
+
+private:
+    cv::Mat mat_;
+};
+
+/** Wrap a cv::Mat as an itk::Image with a specific pixel type */
+template <typename ITKImageType, typename CVPixelType>
+auto CVMatToITKImageView(const cv::Mat& img) -> typename ITKImageType::Pointer
+{
+    using ITKPixelType = typename ITKImageType::PixelType;
+    using Container = MatImportImageContainer<ITKPixelType>;
+
+    auto cns = img.channels();
+    CheckPixelType<ITKPixelType, CVPixelType>(cns);
+
+    typename ITKImageType::RegionType region;
+    typename ITKImageType::RegionType::SizeType size;
+    typename ITKImageType::RegionType::IndexType start;
+    typename ITKImageType::SpacingType spacing;
+    size.Fill(1);
+    size[0] = img.cols;
+    size[1] = img.rows;
+    start.Fill(0);
+    spacing.Fill(1);
+    region.SetSize(size);
+    region.SetIndex(start);
+
+    // ITK requires a contiguous buffer
+    auto container = Container::New();
+    container->SetMat(img.isContinuous() ? img : img.clone());
+
+    auto out = ITKImageType::New();
+    out->SetRegions(region);
+    out->SetSpacing(spacing);
+    out->SetPixelContainer(container);
+
+    // Components stay in OpenCV order
+    if (cns >= 3) {
+        itk::EncapsulateMetaData<std::string>(
+            out->GetMetaDataDictionary(), CHANNEL_ORDER_KEY, "BGR");
+    }
+
+    return out;
+}
+
+/** Convert a cv::Mat to an itk::Image with a specific pixel type */
+template <typename ITKImageType, typename CVPixelType>
+auto CVMatToITKImage(const cv::Mat& img) -> typename ITKImageType::Pointer
+{
+    // Typedefs
+    using ITKPixelType = typename ITKImageType::PixelType;
+    using ConvertPixelTraits = itk::DefaultConvertPixelTraits<ITKPixelType>;
+    using ConvertBuffer =
+        itk::ConvertPixelBuffer<CVPixelType, ITKPixelType, ConvertPixelTraits>;
+
+    // Dimensions
+    auto w = img.cols;
+    auto h = img.rows;
+    auto cns = img.channels();
+
+    // We won't convert depth, so make sure depth matches
+    CheckPixelType<ITKPixelType, CVPixelType>(cns);
 
     typename ITKImageType::RegionType region;
     typename ITKImageType::RegionType::SizeType size;
@@ -84,11 +192,18 @@ auto CVMatToITKImage(const cv::Mat& img) -> typename ITKImageType::Pointer
 }  // namespace detail
 
 template <typename ITKImageType>
-auto ITKImageToCVMat(const itk::SmartPointer<ITKImageType>& img) -> cv::Mat
+auto HasBGRChannelOrder(const itk::SmartPointer<ITKImageType>& img) -> bool
 {
+    std::string order;
+    return itk::ExposeMetaData<std::string>(
+               img->GetMetaDataDictionary(), CHANNEL_ORDER_KEY, order) and
+           order == "BGR";
+}
 
+template <typename ITKImageType>
+auto ITKImageToCVMatView(const itk::SmartPointer<ITKImageType>& img) -> cv::Mat
+{
     using PixelType = typename ITKImageType::PixelType;
-    using ValueType = typename itk::NumericTraits<PixelType>::ValueType;
 
     // Make sure the image is not null
     if (!img) {
@@ -96,47 +211,41 @@ auto ITKImageToCVMat(const itk::SmartPointer<ITKImageType>& img) -> cv::Mat
     }
 
     // Get the channels and dimensions
-    auto region = img->GetLargestPossibleRegion();
+    auto region = img->GetBufferedRegion();
     auto size = region.GetSize();
     auto cns = itk::NumericTraits<PixelType>::MeasurementVectorType::Dimension;
     auto w = static_cast<int>(size[0]);
     auto h = static_cast<int>(size[1]);
 
     // Get the pixel type depth
-    int type{-1};
-    if (typeid(ValueType) == typeid(uint8_t)) {
-        type = CV_8UC(cns);
-    } else if (typeid(ValueType) == typeid(int8_t)) {
-        type = CV_8SC(cns);
-    } else if (typeid(ValueType) == typeid(uint16_t)) {
-        type = CV_16UC(cns);
-    } else if (typeid(ValueType) == typeid(int16_t)) {
-        type = CV_16SC(cns);
-    } else if (typeid(ValueType) == typeid(float)) {
-        type = CV_32FC(cns);
-    } else if (typeid(ValueType) == typeid(int32_t)) {
-        type = CV_32SC(cns);
-    } else if (typeid(ValueType) == typeid(double)) {
-        type = CV_64FC(cns);
-    } else {
-        throw std::invalid_argument("Unrecognized pixel type");
-    }
+    auto type = detail::CVMatType<PixelType>();
     auto tmp = cv::Mat(
         h, w, type, reinterpret_cast<uint8_t*>(img->GetBufferPointer()));
 
     // RGB -> BGR if needed
+    if (cns < 3 or HasBGRChannelOrder(img)) {
+        return tmp;
+    }
     cv::Mat out;
     if (cns == 4) {
         cv::cvtColor(tmp, out, cv::COLOR_RGBA2BGRA);
-    } else if (cns == 3) {
-        cv::cvtColor(tmp, out, cv::COLOR_RGB2BGR);
     } else {
-        tmp.copyTo(out);
+        cv::cvtColor(tmp, out, cv::COLOR_RGB2BGR);
     }
-
     return out;
 }
 
+template <typename ITKImageType>
+auto ITKImageToCVMat(const itk::SmartPointer<ITKImageType>& img) -> cv::Mat
+{
+    // Copy if the view shares the ITK buffer
+    auto view = ITKImageToCVMatView(img);
+    if (view.data == reinterpret_cast<uint8_t*>(img->GetBufferPointer())) {
+        return view.clone();
+    }
+    return view;
+}
+
 template <typename ITKImageType>
 auto CVMatToITKImage(const cv::Mat& img) -> typename ITKImageType::Pointer
 {
@@ -167,4 +276,35 @@ auto CVMatToITKImage(const cv::Mat& img) -> typename ITKImageType::Pointer
             throw std::invalid_argument("Image type not supported");
     }
 }
-}  // namespace rt
\ No newline at end of file
+
+template <typename ITKImageType>
+auto CVMatToITKImageView(const cv::Mat& img) -> typename ITKImageType::Pointer
+{
+    // Out channels
+    using ITKPixelType = typename ITKImageType::PixelType;
+    auto outCns =
+        itk::NumericTraits<ITKPixelType>::MeasurementVectorType::Dimension;
+
+    // Color convert (only copies if needed)
+    auto tmp = rt::ColorConvertImage(img, outCns);
+
+    switch (tmp.depth()) {
+        case CV_8U:
+            return detail::CVMatToITKImageView<ITKImageType, uint8_t>(tmp);
+        case CV_8S:
+            return detail::CVMatToITKImageView<ITKImageType, int8_t>(tmp);
+        case CV_16U:
+            return detail::CVMatToITKImageView<ITKImageType, uint16_t>(tmp);
+        case CV_16S:
+            return detail::CVMatToITKImageView<ITKImageType, int16_t>(tmp);
+        case CV_32S:
+            return detail::CVMatToITKImageView<ITKImageType, int32_t>(tmp);
+        case CV_32F:
+            return detail::CVMatToITKImageView<ITKImageType, float>(tmp);
+        case CV_64F:
+            return detail::CVMatToITKImageView<ITKImageType, double>(tmp);
+        default:
+            throw std::invalid_argument("Image type not supported");
+    }
+}
+}  // namespace rt
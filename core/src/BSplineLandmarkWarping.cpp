@@ -19,7 +19,7 @@ auto BSplineLandmarkWarping::compute()
 
     // Convert to 8UC3
     auto fixed8u = QuantizeImage(fixedImg_, CV_8U);
-    auto fixedImg = CVMatToITKImage<Image8UC3>(fixed8u);
+    auto fixedImg = CVMatToITKImageView<Image8UC3>(fixed8u);
 
     using TransformInitializer =
         itk::LandmarkBasedTransformInitializer<Transform, Image8UC3, Image8UC3>;
@@ -0,0 +1,301 @@
+#include "rt/io/BinaryMeshIO.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "rt/io/MemoryMappedFile.hpp"
+#include "rt/types/Exceptions.hpp"
+
+using namespace rt;
+using namespace rt::io;
+
+namespace fs = rt::filesystem;
+
+// File signature and the version written by this library
+constexpr static std::array<char, 8> MAGIC{'R', 'T', 'M', 'E', 'S', 'H', 0, 0};
+constexpr static std::uint32_t VERSION = 1;
+
+// Header flags
+constexpr static std::uint32_t HAS_NORMALS = 1;
+
+namespace
+{
+// Fixed-size file header. Followed by the texture path, padded to a multiple
+// of 8 bytes, then the data arrays in declaration order:
+// vertices (3 x double), normals (3 x double, if HAS_NORMALS),
+// faces (3 x uint64), UVs (2 x double, top-left origin), and UV faces
+// (4 x uint64: face index, then 3 UV indices).
+struct Header {
+    std::array<char, 8> magic{MAGIC};
+    std::uint32_t version{VERSION};
+    std::uint32_t flags{0};
+    std::uint64_t numVertices{0};
+    std::uint64_t numFaces{0};
+    std::uint64_t numUVs{0};
+    std::uint64_t numUVFaces{0};
+    std::array<double, 3> ratio{1, 1, 1};
+    std::uint32_t uvOrigin{0};
+    std::uint32_t textureLength{0};
+};
+static_assert(sizeof(Header) == 80, "Unexpected binary mesh header padding");
+}  // namespace
+
+// Round a byte count up to a multiple of 8
+static auto Pad8(std::size_t n) -> std::size_t
+{
+    return (n + 7) & ~std::size_t{7};
+}
+
+// Write an array of values to a stream
+template <typename T>
+static void WriteArray(std::ofstream& ofs, const std::vector<T>& vals)
+{
+    ofs.write(
+        reinterpret_cast<const char*>(vals.data()),
+        static_cast<std::streamsize>(vals.size() * sizeof(T)));
+}
+
+void rt::io::WriteBinaryMesh(
+    const fs::path& path,
+    const ITKMesh::Pointer& mesh,
+    const UVMap& uvMap,
+    const fs::path& texturePath)
+{
+    if (not mesh) {
+        throw IOException("Mesh is empty");
+    }
+
+    auto texture = texturePath.string();
+    Header h;
+    h.numVertices = mesh->GetNumberOfPoints();
+    h.numFaces = mesh->GetNumberOfCells();
+    h.numUVs = uvMap.size();
+    h.numUVFaces = uvMap.size_faces();
+    h.ratio = {uvMap.ratio().width, uvMap.ratio().height, uvMap.ratio().aspect};
+    h.uvOrigin = static_cast<std::uint32_t>(uvMap.origin());
+    h.textureLength = static_cast<std::uint32_t>(texture.size());
+
+    // Vertices and normals
+    std::vector<double> vertices;
+    vertices.reserve(3 * h.numVertices);
+    for (auto it = mesh->GetPoints()->Begin(); it != mesh->GetPoints()->End();
+         ++it) {
+        const auto& p = it.Value();
+        vertices.insert(vertices.end(), {p[0], p[1], p[2]});
+    }
+
+    std::vector<double> normals;
+    auto pointData = mesh->GetPointData();
+    if (pointData and pointData->Size() == h.numVertices) {
+        h.flags |= HAS_NORMALS;
+        normals.reserve(3 * h.numVertices);
+        for (auto it = pointData->Begin(); it != pointData->End(); ++it) {
+            const auto& n = it.Value();
+            normals.insert(normals.end(), {n[0], n[1], n[2]});
+        }
+    }
+
+    // Faces
+    std::vector<std::uint64_t> faces;
+    faces.reserve(3 * h.numFaces);
+    for (auto cell = mesh->GetCells()->Begin(); cell != mesh->GetCells()->End();
+         ++cell) {
+        if (cell.Value()->GetNumberOfPoints() != 3) {
+            throw IOException("Binary mesh only supports triangular faces");
+        }
+        for (auto id = cell.Value()->PointIdsBegin();
+             id != cell.Value()->PointIdsEnd(); ++id) {
+            faces.push_back(*id);
+        }
+    }
+
+    // UVs, stored relative to the top-left like UVMap
+    std::vector<double> uvs;
+    uvs.reserve(2 * h.numUVs);
+    for (const auto& uv : uvMap.uvs()) {
+        uvs.insert(uvs.end(), {uv[0], uv[1]});
+    }
+
+    std::vector<std::uint64_t> uvFaces;
+    uvFaces.reserve(4 * h.numUVFaces);
+    auto uvMapFaces = uvMap.faces();
+    for (std::size_t idx = 0; idx < uvMapFaces.size(); idx++) {
+        if (uvMap.hasFace(idx)) {
+            const auto& f = uvMapFaces[idx];
+            uvFaces.insert(uvFaces.end(), {idx, f[0], f[1], f[2]});
+        }
+    }
+
+    std::ofstream ofs{path.string(), std::ios::binary};
+    if (!ofs.is_open()) {
+        auto msg = "could not open file '" + path.string() + "'";
+        throw IOException(msg);
+    }
+
+    ofs.write(reinterpret_cast<const char*>(&h), sizeof(Header));
+    std::vector<char> textureBytes(Pad8(texture.size()), 0);
+    std::copy(texture.begin(), texture.end(), textureBytes.begin());
+    WriteArray(ofs, textureBytes);
+    WriteArray(ofs, vertices);
+    WriteArray(ofs, normals);
+    WriteArray(ofs, faces);
+    WriteArray(ofs, uvs);
+    WriteArray(ofs, uvFaces);
+
+    ofs.close();
+    if (ofs.fail()) {
+        throw IOException("Failed to write file '" + path.string() + "'");
+    }
+}
+
+auto rt::io::ReadBinaryMesh(const fs::path& path) -> BinaryMesh
+{
+    MemoryMappedFile file(path);
+
+    // Bounds-checked walk over the mapped sections
+    std::size_t offset{0};
+    auto take = [&](std::uint64_t count, std::size_t size) -> const char* {
+        auto remaining = file.size() - offset;
+        if (count > remaining / size) {
+            throw IOException(
+                "Binary mesh file is truncated: " + path.string());
+        }
+        const auto* section = file.data() + offset;
+        offset += Pad8(static_cast<std::size_t>(count) * size);
+        offset = std::min(offset, file.size());
+        return section;
+    };
+
+    Header h;
+    std::memcpy(&h, take(1, sizeof(Header)), sizeof(Header));
+    if (h.magic != MAGIC) {
+        throw IOException("File is not a binary mesh: " + path.string());
+    } else if (h.version != VERSION) {
+        auto msg = "Version mismatch. Binary mesh file version is " +
+                   std::to_string(h.version) + ", processing version is " +
+                   std::to_string(VERSION) + ".";
+        throw IOException(msg);
+    } else if (h.numVertices == 0) {
+        throw IOException("No vertices in binary mesh file");
+    }
+
+    const auto* texture = take(h.textureLength, 1);
+    const auto* vertices = take(h.numVertices, 3 * sizeof(double));
+    const char* normals{nullptr};
+    if ((h.flags & HAS_NORMALS) != 0) {
+        normals = take(h.numVertices, 3 * sizeof(double));
+    }
+    const auto* faces = take(h.numFaces, 3 * sizeof(std::uint64_t));
+    const auto* uvs = take(h.numUVs, 2 * sizeof(double));
+    const auto* uvFaces = take(h.numUVFaces, 4 * sizeof(std::uint64_t));
+
+    BinaryMesh result;
+    if (h.textureLength > 0) {
+        result.texturePath = std::string(texture, h.textureLength);
+        if (result.texturePath.is_relative()) {
+            result.texturePath = path.parent_path() / result.texturePath;
+        }
+    }
+
+    // Points and normals. The containers are vectors, so elements can be
+    // filled in parallel once they have been allocated.
+    auto numVerts = static_cast<int>(h.numVertices);
+    auto points = ITKPointsContainer::New();
+    points->Reserve(h.numVertices);
+    auto& pts = points->CastToSTLContainer();
+    ITKMesh::PointDataContainer::Pointer pointData;
+    if (normals != nullptr) {
+        pointData = ITKMesh::PointDataContainer::New();
+        pointData->Reserve(h.numVertices);
+    }
+    cv::parallel_for_(cv::Range(0, numVerts), [&](const cv::Range& r) {
+        for (auto i = r.start; i < r.end; i++) {
+            auto pos = 3 * sizeof(double) * static_cast<std::size_t>(i);
+            std::memcpy(
+                pts[i].GetDataPointer(), vertices + pos, 3 * sizeof(double));
+            if (normals != nullptr) {
+                std::memcpy(
+                    pointData->ElementAt(i).GetDataPointer(), normals + pos,
+                    3 * sizeof(double));
+            }
+        }
+    });
+
+    // Faces. Ownership of each cell passes to the mesh.
+    auto numFaces = static_cast<int>(h.numFaces);
+    auto cells = ITKMesh::CellsContainer::New();
+    cells->Reserve(h.numFaces);
+    auto& cellVec = cells->CastToSTLContainer();
+    std::atomic<bool> badFace{false};
+    cv::parallel_for_(cv::Range(0, numFaces), [&](const cv::Range& r) {
+        std::array<std::uint64_t, 3> f{};
+        std::array<ITKMesh::PointIdentifier, 3> ids{};
+        for (auto i = r.start; i < r.end; i++) {
+            auto pos = sizeof(f) * static_cast<std::size_t>(i);
+            std::memcpy(f.data(), faces + pos, sizeof(f));
+            for (std::size_t v = 0; v < 3; v++) {
+                if (f[v] >= h.numVertices) {
+                    badFace = true;
+                }
+                ids[v] = static_cast<ITKMesh::PointIdentifier>(f[v]);
+            }
+            auto* cell = new ITKTriangle;
+            cell->SetPointIds(ids.data());
+            cellVec[i] = cell;
+        }
+    });
+
+    result.mesh = ITKMesh::New();
+    result.mesh->SetPoints(points);
+    result.mesh->SetCells(cells);
+    if (normals != nullptr) {
+        result.mesh->SetPointData(pointData);
+    }
+    if (badFace) {
+        throw IOException("Out-of-range vertex reference");
+    }
+
+    // UV map. Faces are stored sparsely by face index, so they are unpacked
+    // into the map's storage arrays and loaded in one go.
+    std::vector<cv::Vec2d> uvVec(h.numUVs);
+    for (std::size_t i = 0; i < uvVec.size(); i++) {
+        auto& uv = uvVec[i];
+        std::memcpy(uv.val, uvs + i * sizeof(uv.val), sizeof(uv.val));
+    }
+    std::vector<std::array<std::uint64_t, 4>> uvFaceVec(h.numUVFaces);
+    std::uint64_t numFaceSlots{0};
+    for (std::size_t i = 0; i < uvFaceVec.size(); i++) {
+        auto& f = uvFaceVec[i];
+        std::memcpy(f.data(), uvFaces + i * sizeof(f), sizeof(f));
+        if (f[1] >= h.numUVs or f[2] >= h.numUVs or f[3] >= h.numUVs) {
+            throw IOException("Out-of-range UV reference");
+        }
+        numFaceSlots = std::max(numFaceSlots, f[0] + 1);
+    }
+    std::vector<UVMap::Face> faceVec(numFaceSlots);
+    std::vector<bool> hasFace(numFaceSlots, false);
+    for (const auto& f : uvFaceVec) {
+        auto idx = static_cast<std::size_t>(f[0]);
+        faceVec[idx] = {
+            static_cast<std::size_t>(f[1]), static_cast<std::size_t>(f[2]),
+            static_cast<std::size_t>(f[3])};
+        hasFace[idx] = true;
+    }
+    result.uvMap =
+        UVMap(std::move(uvVec), std::move(faceVec), std::move(hasFace));
+    auto& uvMap = result.uvMap;
+    uvMap.ratio(h.ratio[0], h.ratio[1]);
+    uvMap.ratio(h.ratio[2]);
+    uvMap.setOrigin(static_cast<UVMap::Origin>(h.uvOrigin));
+
+    return result;
+}
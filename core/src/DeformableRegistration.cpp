@@ -1,12 +1,21 @@
 #include "rt/DeformableRegistration.hpp"
 
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <itkBSplineTransformParametersAdaptor.h>
 #include <itkCommand.h>
 #include <itkImageRegistrationMethod.h>
+#include <itkImageRegistrationMethodv4.h>
 #include <itkLinearInterpolateImageFunction.h>
 #include <itkMattesMutualInformationImageToImageMetric.h>
+#include <itkMattesMutualInformationImageToImageMetricv4.h>
 #include <itkRegularStepGradientDescentOptimizer.h>
+#include <itkRegularStepGradientDescentOptimizerv4.h>
+#include <opencv2/imgproc.hpp>
 
-#include "rt/ITKImageTypes.hpp"
 #include "rt/util/ITKOpenCVBridge.hpp"
 
 using namespace rt;
@@ -17,6 +26,13 @@ using Metric =
     itk::MattesMutualInformationImageToImageMetric<Image8UC1, Image8UC1>;
 using Optimizer = itk::RegularStepGradientDescentOptimizer;
 using Registration = itk::ImageRegistrationMethod<Image8UC1, Image8UC1>;
+using MetricV4 =
+    itk::MattesMutualInformationImageToImageMetricv4<Image8UC1, Image8UC1>;
+using OptimizerV4 = itk::RegularStepGradientDescentOptimizerv4<double>;
+using RegistrationV4 = itk::ImageRegistrationMethodv4<
+    Image8UC1,
+    Image8UC1,
+    DeformableRegistration::Transform>;
 using BSplineParameters = DeformableRegistration::Transform::ParametersType;
 
 static constexpr double DEFAULT_MAX_STEP_FACTOR = 1.0 / 500.0;
@@ -31,12 +47,60 @@ to be used depends on the content of the image. If the images are
 smooth and do not contain much detail, then using approximately
 1 percent of the pixels will do. On the other hand, if the images
 are detailed, it may be necessary to use a much higher proportion,
-such as 20 percent. */
+such as 20 percent. The default sampling rate is
+DeformableRegistration::DEFAULT_SAMPLE_FACTOR. */
 static constexpr size_t DEFAULT_HISTOGRAM_BINS = 50;
-static constexpr double DEFAULT_SAMPLE_FACTOR = 1.0 / 80.0;
 
 using Transform = DeformableRegistration::Transform;
 
+// Downsample a single-channel image by a scale factor and convert it to an
+// ITK image. Spacing and origin are adjusted so that the downsampled image
+// occupies the same physical space as the full-resolution image.
+static auto ShrinkImage(const cv::Mat& m, size_t factor) -> Image8UC1::Pointer
+{
+    if (factor <= 1) {
+        return CVMatToITKImageView<Image8UC1>(m);
+    }
+
+    auto f = static_cast<int>(factor);
+    cv::Size size{std::max(1, m.cols / f), std::max(1, m.rows / f)};
+    cv::Mat small;
+    cv::resize(m, small, size, 0, 0, cv::INTER_AREA);
+    auto img = CVMatToITKImageView<Image8UC1>(small);
+
+    // Each output pixel is the average of a block of input pixels, so its
+    // center is in the middle of that block
+    Image8UC1::SpacingType spacing;
+    Image8UC1::PointType origin;
+    spacing[0] = static_cast<double>(m.cols) / size.width;
+    spacing[1] = static_cast<double>(m.rows) / size.height;
+    origin[0] = 0.5 * (spacing[0] - 1.0);
+    origin[1] = 0.5 * (spacing[1] - 1.0);
+    img->SetSpacing(spacing);
+    img->SetOrigin(origin);
+    return img;
+}
+
+// Resample the B-Spline coefficients onto a mesh with a new size
+static void RefineTransform(const Transform::Pointer& tfm, uint32_t meshFill)
+{
+    using Adaptor = itk::BSplineTransformParametersAdaptor<Transform>;
+
+    Transform::MeshSizeType meshSize;
+    meshSize.Fill(meshFill);
+
+    auto adaptor = Adaptor::New();
+    adaptor->SetTransform(tfm);
+    adaptor->SetRequiredTransformDomainOrigin(tfm->GetTransformDomainOrigin());
+    adaptor->SetRequiredTransformDomainPhysicalDimensions(
+        tfm->GetTransformDomainPhysicalDimensions());
+    adaptor->SetRequiredTransformDomainDirection(
+        tfm->GetTransformDomainDirection());
+    adaptor->SetRequiredTransformDomainMeshSize(meshSize);
+    adaptor->AdaptTransformParameters();
+}
+
+template <class TOptimizer>
 class ReportMetricCallback : public itk::Command
 {
 protected:
@@ -44,7 +108,7 @@ protected:
 
 public:
     using Pointer = itk::SmartPointer<ReportMetricCallback>;
-    using Optimizer = itk::RegularStepGradientDescentOptimizer;
+    using Optimizer = TOptimizer;
 
     static auto New() -> Pointer
     {
@@ -116,16 +180,66 @@ auto DeformableRegistration::getReportMetrics() const -> bool
     return reportMetrics_;
 }
 
+void DeformableRegistration::setNumberOfLevels(size_t i)
+{
+    if (i > MAX_LEVELS) {
+        throw std::invalid_argument(
+            "Number of levels must be at most " + std::to_string(MAX_LEVELS));
+    }
+    levels_ = std::max<size_t>(i, 1);
+}
+
+auto DeformableRegistration::getNumberOfLevels() const -> size_t
+{
+    return levels_;
+}
+
+void DeformableRegistration::setIterationSchedule(const std::vector<size_t>& s)
+{
+    iterSchedule_ = s;
+}
+
+auto DeformableRegistration::getIterationSchedule() const
+    -> std::vector<size_t>
+{
+    return iterSchedule_;
+}
+
+void DeformableRegistration::setSamplingSchedule(const std::vector<double>& s)
+{
+    sampleSchedule_ = s;
+}
+
+auto DeformableRegistration::getSamplingSchedule() const
+    -> std::vector<double>
+{
+    return sampleSchedule_;
+}
+
+void DeformableRegistration::setFramework(Framework f) { framework_ = f; }
+
+auto DeformableRegistration::getFramework() const -> Framework
+{
+    return framework_;
+}
+
+void DeformableRegistration::setNumberOfThreads(unsigned i) { threads_ = i; }
+
+auto DeformableRegistration::getNumberOfThreads() const -> unsigned
+{
+    return threads_;
+}
+
 auto DeformableRegistration::compute()
     -> DeformableRegistration::Transform::Pointer
 {
     ///// Create grayscale images /////
-    auto fixed8u = QuantizeImage(fixedImage_, CV_8U);
-    auto fixed = CVMatToITKImage<Image8UC1>(fixed8u);
-    auto moving8u = QuantizeImage(movingImage_, CV_8U);
-    auto moving = CVMatToITKImage<Image8UC1>(moving8u);
+    auto fixed8u = ColorConvertImage(QuantizeImage(fixedImage_, CV_8U), 1);
+    auto fixed = CVMatToITKImageView<Image8UC1>(fixed8u);
+    auto moving8u = ColorConvertImage(QuantizeImage(movingImage_, CV_8U), 1);
 
     ///// Setup the BSpline Transform /////
+    // The transform domain is always defined by the full-resolution image
     output_ = Transform::New();
     Transform::PhysicalDimensionsType fixedPhysicalDims;
     Transform::MeshSizeType meshSize;
@@ -138,7 +252,25 @@ auto DeformableRegistration::compute()
             static_cast<double>(
                 fixed->GetLargestPossibleRegion().GetSize()[i] - 1);
     }
-    meshSize.Fill(meshFillSize_);
+
+    // Limit the levels so the coarsest is at least 2 pixels in each dimension
+    auto minDim = static_cast<size_t>(std::min(fixed8u.cols, fixed8u.rows));
+    size_t levels{1};
+    while (levels < levels_ and (minDim >> levels) >= 2) {
+        levels++;
+    }
+    if (levels < levels_) {
+        std::cerr << "Warning: Image too small for " << levels_;
+        std::cerr << " pyramid levels. Using " << levels << "." << std::endl;
+    }
+
+    // Start with the mesh size of the coarsest level
+    auto levelMeshFill = [this, levels](size_t level) {
+        auto shift = levels - 1 - level;
+        auto fill = (shift < 32) ? meshFillSize_ >> shift : 0;
+        return std::max<uint32_t>(fill, 1);
+    };
+    meshSize.Fill(levelMeshFill(0));
 
     output_->SetTransformDomainOrigin(fixedOrigin);
     output_->SetTransformDomainPhysicalDimensions(fixedPhysicalDims);
@@ -148,8 +280,57 @@ auto DeformableRegistration::compute()
     const auto numParams = output_->GetNumberOfParameters();
     BSplineParameters parameters(numParams);
     parameters.Fill(0.0);
-    output_->SetParameters(parameters);
+    output_->SetParametersByValue(parameters);
 
+    // Optimizer step lengths are relative to the full-resolution image
+    auto regionWidth =
+        static_cast<double>(fixed->GetLargestPossibleRegion().GetSize()[0]);
+
+    ///// Run the pyramid, coarse to fine /////
+    for (size_t level = 0; level < levels; level++) {
+        // Refine the mesh from the previous level
+        auto meshFill = levelMeshFill(level);
+        auto prevFill = output_->GetTransformDomainMeshSize()[0];
+        if (level > 0 and meshFill != prevFill) {
+            RefineTransform(output_, meshFill);
+        }
+
+        // Level parameters
+        auto iters =
+            (level < iterSchedule_.size()) ? iterSchedule_[level] : iterations_;
+        auto sampleFactor = (level < sampleSchedule_.size())
+                                ? sampleSchedule_[level]
+                                : DEFAULT_SAMPLE_FACTOR;
+
+        // Level images
+        size_t shrink = size_t{1} << (levels - 1 - level);
+        auto levelFixed = (shrink == 1) ? fixed : ShrinkImage(fixed8u, shrink);
+        auto levelMoving = ShrinkImage(moving8u, shrink);
+
+        if (reportMetrics_ and levels > 1) {
+            std::cout << "Level " << level + 1 << "/" << levels;
+            std::cout << " (shrink: " << shrink << ", mesh: " << meshFill;
+            std::cout << ")" << std::endl;
+        }
+        if (framework_ == Framework::ITKv4) {
+            compute_level_v4_(
+                levelFixed, levelMoving, iters, sampleFactor, regionWidth);
+        } else {
+            compute_level_(
+                levelFixed, levelMoving, iters, sampleFactor, regionWidth);
+        }
+    }
+
+    return output_;
+}
+
+void DeformableRegistration::compute_level_(
+    const Image8UC1::Pointer& fixed,
+    const Image8UC1::Pointer& moving,
+    size_t iterations,
+    double sampleFactor,
+    double regionWidth)
+{
     ///// Setup Registration and Metrics /////
     auto metric = Metric::New();
     auto optimizer = Optimizer::New();
@@ -157,7 +338,7 @@ auto DeformableRegistration::compute()
     auto grayInterpolator = GrayInterpolator::New();
     if (reportMetrics_) {
         optimizer->AddObserver(
-            itk::IterationEvent(), ReportMetricCallback::New());
+            itk::IterationEvent(), ReportMetricCallback<Optimizer>::New());
     }
 
     registration->SetFixedImage(fixed);
@@ -172,13 +353,11 @@ auto DeformableRegistration::compute()
     registration->SetFixedImageRegion(fixedRegion);
 
     metric->SetNumberOfHistogramBins(DEFAULT_HISTOGRAM_BINS);
-    auto numSamples = static_cast<size_t>(
-        fixedRegion.GetNumberOfPixels() * DEFAULT_SAMPLE_FACTOR);
+    auto numSamples =
+        static_cast<size_t>(fixedRegion.GetNumberOfPixels() * sampleFactor);
     metric->SetNumberOfSpatialSamples(numSamples);
 
     ///// Setup Optimizer /////
-    auto regionWidth =
-        static_cast<double>(fixed->GetLargestPossibleRegion().GetSize()[0]);
     auto maxStepLength = regionWidth * DEFAULT_MAX_STEP_FACTOR;
     auto minStepLength = regionWidth * DEFAULT_MIN_STEP_FACTOR;
 
@@ -186,7 +365,7 @@ auto DeformableRegistration::compute()
     optimizer->SetMaximumStepLength(maxStepLength);
     optimizer->SetMinimumStepLength(minStepLength);
     optimizer->SetRelaxationFactor(relaxationFactor_);
-    optimizer->SetNumberOfIterations(iterations_);
+    optimizer->SetNumberOfIterations(iterations);
     optimizer->SetGradientMagnitudeTolerance(gradMagTol_);
 
     ///// Run Registration /////
@@ -199,6 +378,87 @@ auto DeformableRegistration::compute()
         std::cout << "Final Metric Value:" << optimizer->GetValue() << "\n";
     }
 
-    output_->SetParameters(registration->GetLastTransformParameters());
-    return output_;
-}
\ No newline at end of file
+    // BSplineTransform::SetParameters only keeps a reference to its input, so
+    // copy the result before the registration object goes out of scope
+    output_->SetParametersByValue(registration->GetLastTransformParameters());
+}
+
+void DeformableRegistration::compute_level_v4_(
+    const Image8UC1::Pointer& fixed,
+    const Image8UC1::Pointer& moving,
+    size_t iterations,
+    double sampleFactor,
+    double regionWidth)
+{
+    ///// Setup Registration and Metrics /////
+    auto metric = MetricV4::New();
+    auto optimizer = OptimizerV4::New();
+    auto registration = RegistrationV4::New();
+    if (reportMetrics_) {
+        optimizer->AddObserver(
+            itk::IterationEvent(), ReportMetricCallback<OptimizerV4>::New());
+    }
+
+    registration->SetFixedImage(fixed);
+    registration->SetMovingImage(moving);
+    registration->SetMetric(metric);
+    registration->SetOptimizer(optimizer);
+    registration->SetInitialTransform(output_);
+    registration->InPlaceOn();
+
+    // The pyramid is handled by compute(), so only run a single level
+    RegistrationV4::ShrinkFactorsArrayType shrinkFactors(1);
+    shrinkFactors.Fill(1);
+    RegistrationV4::SmoothingSigmasArrayType smoothingSigmas(1);
+    smoothingSigmas.Fill(0);
+    registration->SetNumberOfLevels(1);
+    registration->SetShrinkFactorsPerLevel(shrinkFactors);
+    registration->SetSmoothingSigmasPerLevel(smoothingSigmas);
+
+    // Sample the same fraction of fixed pixels as the v3 metric
+    metric->SetNumberOfHistogramBins(DEFAULT_HISTOGRAM_BINS);
+#if ITK_VERSION_MAJOR > 5 || (ITK_VERSION_MAJOR == 5 && ITK_VERSION_MINOR >= 1)
+    registration->SetMetricSamplingStrategy(
+        itk::ImageRegistrationMethodv4Enums::MetricSamplingStrategy::RANDOM);
+#else
+    registration->SetMetricSamplingStrategy(RegistrationV4::RANDOM);
+#endif
+    registration->SetMetricSamplingPercentage(sampleFactor);
+
+    // Metric and gradient evaluation are split across this many threads
+    if (threads_ > 0) {
+#if ITK_VERSION_MAJOR >= 5
+        registration->SetNumberOfWorkUnits(threads_);
+        optimizer->SetNumberOfWorkUnits(threads_);
+        metric->SetMaximumNumberOfWorkUnits(threads_);
+#else
+        registration->SetNumberOfThreads(threads_);
+        optimizer->SetNumberOfThreads(threads_);
+        metric->SetMaximumNumberOfThreads(threads_);
+#endif
+    }
+
+    ///// Setup Optimizer /////
+    // Use the same fixed step schedule as the v3 optimizer
+    auto maxStepLength = regionWidth * DEFAULT_MAX_STEP_FACTOR;
+    auto minStepLength = regionWidth * DEFAULT_MIN_STEP_FACTOR;
+
+    optimizer->SetLearningRate(maxStepLength);
+    optimizer->SetMinimumStepLength(minStepLength);
+    optimizer->SetRelaxationFactor(relaxationFactor_);
+    optimizer->SetNumberOfIterations(iterations);
+    optimizer->SetGradientMagnitudeTolerance(gradMagTol_);
+    optimizer->SetDoEstimateLearningRateOnce(false);
+    optimizer->SetDoEstimateLearningRateAtEachIteration(false);
+
+    ///// Run Registration /////
+    // Updates output_ in place
+    registration->Update();
+
+    // Report final values as requested
+    if (reportMetrics_) {
+        std::cout << "Stop Condition: ";
+        std::cout << optimizer->GetStopConditionDescription() << "\n";
+        std::cout << "Final Metric Value:" << optimizer->GetValue() << "\n";
+    }
+}
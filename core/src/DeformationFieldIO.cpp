@@ -0,0 +1,128 @@
+#include "rt/io/DeformationFieldIO.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "rt/types/Exceptions.hpp"
+#include "rt/util/String.hpp"
+
+namespace fs = rt::filesystem;
+
+using Field = rt::DeformationField;
+
+void rt::WriteDeformationField(
+    const fs::path& path, const DeformationField::Pointer& field)
+{
+    if (not field) {
+        throw std::invalid_argument("field is nullptr");
+    }
+
+    std::ofstream ofs{path.string(), std::ios::binary};
+    if (!ofs.is_open()) {
+        auto msg = "could not open file '" + path.string() + "'";
+        throw IOException(msg);
+    }
+
+    // Header
+    auto size = field->GetLargestPossibleRegion().GetSize();
+    std::stringstream ss;
+    ss << "filetype: deformationfield" << std::endl;
+    ss << "version: 1" << std::endl;
+    ss << "type: displacement" << std::endl;
+    ss << "width: " << size[0] << std::endl;
+    ss << "height: " << size[1] << std::endl;
+    ss << "<>" << std::endl;
+    ofs << ss.rdbuf();
+
+    // Write the displacements in row-major order
+    auto bytes = size[0] * size[1] * sizeof(Field::PixelType);
+    ofs.write(
+        reinterpret_cast<const char*>(field->GetBufferPointer()),
+        static_cast<std::streamsize>(bytes));
+
+    ofs.close();
+}
+
+auto rt::ReadDeformationField(const fs::path& path)
+    -> DeformationField::Pointer
+{
+    std::ifstream ifs{path.string(), std::ios::binary};
+    if (!ifs.is_open()) {
+        auto msg = "could not open file '" + path.string() + "'";
+        throw IOException(msg);
+    }
+
+    struct Header {
+        std::string fileType;
+        int version{0};
+        std::string type;
+        std::size_t width{0};
+        std::size_t height{0};
+    };
+
+    Header h;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        trim(line);
+
+        // End of the header
+        if (line == "<>") {
+            break;
+        }
+
+        // Skip comments and anything which isn't a key: value pair
+        auto colon = line.find(':');
+        if (line.empty() or line.front() == '#' or
+            colon == std::string::npos) {
+            continue;
+        }
+        auto key = line.substr(0, colon);
+        auto val = line.substr(colon + 1);
+        trim(key);
+        trim(val);
+
+        if (key == "filetype") {
+            h.fileType = val;
+        } else if (key == "version") {
+            h.version = std::stoi(val);
+        } else if (key == "type") {
+            h.type = val;
+        } else if (key == "width") {
+            h.width = std::stoul(val);
+        } else if (key == "height") {
+            h.height = std::stoul(val);
+        }
+    }
+
+    // Sanity check. Do we have a valid header?
+    if (h.fileType.empty()) {
+        throw IOException("Must provide file type");
+    } else if (h.fileType != "deformationfield") {
+        throw IOException("File is not a DeformationField");
+    } else if (h.version != 1) {
+        auto msg = "Version mismatch. DeformationField file version is " +
+                   std::to_string(h.version) + ", processing version is 1.";
+        throw IOException(msg);
+    } else if (h.type != "displacement") {
+        throw IOException("DeformationField type not supported: " + h.type);
+    }
+
+    // Construct the field
+    Field::RegionType region;
+    region.SetSize({h.width, h.height});
+    auto field = Field::New();
+    field->SetRegions(region);
+    field->Allocate();
+
+    // Read the displacements
+    auto bytes = h.width * h.height * sizeof(Field::PixelType);
+    ifs.read(
+        reinterpret_cast<char*>(field->GetBufferPointer()),
+        static_cast<std::streamsize>(bytes));
+    if (static_cast<std::size_t>(ifs.gcount()) != bytes) {
+        throw IOException("DeformationField file is truncated");
+    }
+
+    return field;
+}
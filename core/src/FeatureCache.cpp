@@ -0,0 +1,138 @@
+#include "rt/FeatureCache.hpp"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+using namespace rt;
+
+namespace fs = rt::filesystem;
+
+// 64-bit FNV-1a
+constexpr static std::uint64_t FNV_OFFSET = 14695981039346656037ULL;
+constexpr static std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+// Hash bytes into an FNV-1a state
+static void HashBytes(std::uint64_t& h, const void* data, std::size_t len)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < len; i++) {
+        h = (h ^ bytes[i]) * FNV_PRIME;
+    }
+}
+
+// Hash an image's header and pixels
+static void HashMat(std::uint64_t& h, const cv::Mat& m)
+{
+    std::array<int, 3> header{m.rows, m.cols, m.type()};
+    HashBytes(h, header.data(), sizeof(header));
+    if (m.empty()) {
+        return;
+    }
+    auto rowBytes = static_cast<std::size_t>(m.cols) * m.elemSize();
+    for (int y = 0; y < m.rows; y++) {
+        HashBytes(h, m.ptr(y), rowBytes);
+    }
+}
+
+FeatureCache::FeatureCache(fs::path dir) : dir_{std::move(dir)}
+{
+    if (not dir_.empty()) {
+        fs::create_directories(dir_);
+    }
+}
+
+auto FeatureCache::New() -> Pointer { return std::make_shared<FeatureCache>(); }
+
+auto FeatureCache::New(fs::path dir) -> Pointer
+{
+    return std::make_shared<FeatureCache>(std::move(dir));
+}
+
+auto FeatureCache::Key(
+    const cv::Mat& img, const cv::Mat& mask, const std::string& params)
+    -> std::string
+{
+    auto h = FNV_OFFSET;
+    HashMat(h, img);
+    HashMat(h, mask);
+    HashBytes(h, params.data(), params.size());
+
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << h;
+    return ss.str();
+}
+
+auto FeatureCache::directory() const -> fs::path { return dir_; }
+
+auto FeatureCache::get(const std::string& key, const cv::Mat& img)
+    -> std::optional<ImageFeatures>
+{
+    auto matches = [&img](const Entry& e) {
+        return e.size == img.size() and e.type == img.type();
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto it = entries_.find(key); it != entries_.end()) {
+            if (not matches(it->second)) {
+                return std::nullopt;
+            }
+            return it->second.features;
+        }
+    }
+
+    // Check the cache directory
+    if (dir_.empty()) {
+        return std::nullopt;
+    }
+    auto path = dir_ / (key + ".yml.gz");
+    if (not fs::exists(path)) {
+        return std::nullopt;
+    }
+    cv::FileStorage file(path.string(), cv::FileStorage::READ);
+    if (not file.isOpened()) {
+        return std::nullopt;
+    }
+    // Entries written without the image properties never match
+    Entry entry;
+    cv::read(file["size"], entry.size, cv::Size());
+    cv::read(file["type"], entry.type, -1);
+    if (not matches(entry)) {
+        return std::nullopt;
+    }
+    cv::read(file["keypoints"], entry.features.keypoints);
+    file["descriptors"] >> entry.features.descriptors;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.emplace(key, entry);
+    return entry.features;
+}
+
+void FeatureCache::put(
+    const std::string& key, const cv::Mat& img, const ImageFeatures& features)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[key] = {img.size(), img.type(), features};
+    }
+
+    if (dir_.empty()) {
+        return;
+    }
+
+    // Write to a temporary file and rename it, so that readers in other
+    // processes never see a partial entry
+    auto thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    auto tmp = dir_ / (key + "." + std::to_string(thread) + ".tmp.yml.gz");
+    {
+        cv::FileStorage file(tmp.string(), cv::FileStorage::WRITE);
+        cv::write(file, "size", img.size());
+        cv::write(file, "type", img.type());
+        cv::write(file, "keypoints", features.keypoints);
+        file << "descriptors" << features.descriptors;
+    }
+    fs::rename(tmp, dir_ / (key + ".yml.gz"));
+}
@@ -1,5 +1,6 @@
 #include "rt/io/ImageIO.hpp"
 
+#include <exception>
 #include <iostream>
 
 #include <opencv2/imgcodecs.hpp>
@@ -14,8 +15,20 @@ static const auto IsFormat = rt::FileExtensionFilter;
 
 auto rt::ReadImage(const fs::path& path) -> cv::Mat
 {
+    // Use our parallel TIFF reader for the layouts it supports
+    cv::Mat img;
+    if (IsFormat(path, {"tif", "tiff"})) {
+        try {
+            img = io::ReadTIFF(path);
+        } catch (const std::exception&) {
+            img = cv::Mat();
+        }
+    }
+
     // Attempt to read with OpenCV
-    auto img = cv::imread(path.string(), cv::IMREAD_UNCHANGED);
+    if (img.empty()) {
+        img = cv::imread(path.string(), cv::IMREAD_UNCHANGED);
+    }
 
     // If OpenCV failed and is a TIFF, try our reader
     if (img.empty() and IsFormat(path, {"tif", "tiff"})) {
@@ -29,7 +42,10 @@ auto rt::ReadImage(const fs::path& path) -> cv::Mat
     return img;
 }
 
-void rt::WriteImage(const fs::path& path, const cv::Mat& img)
+void rt::WriteImage(
+    const fs::path& path,
+    const cv::Mat& img,
+    const io::TIFFWriteOptions& tiffOptions)
 {
     // Do nothing on empty images
     if (img.empty()) {
@@ -40,7 +56,7 @@ void rt::WriteImage(const fs::path& path, const cv::Mat& img)
 
     // Use our TIFF writer
     if (IsFormat(path, {"tif", "tiff"})) {
-        rt::io::WriteTIFF(path, img);
+        rt::io::WriteTIFF(path, img, tiffOptions);
     } else {
         cv::Mat output = img.clone();
         if (img.depth() == CV_32F or img.depth() == CV_64F) {
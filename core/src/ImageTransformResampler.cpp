@@ -1,12 +1,196 @@
 #include "rt/ImageTransformResampler.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <vector>
+
 #include <itkNearestNeighborInterpolateImageFunction.h>
 #include <itkResampleImageFilter.h>
 
 #include "rt/ITKImageTypes.hpp"
+#include "rt/TransformMapper.hpp"
+#include "rt/io/TIFFIO.hpp"
 #include "rt/util/ITKOpenCVBridge.hpp"
+#include "rt/util/ImageConversion.hpp"
 
 using namespace rt;
+namespace fs = rt::filesystem;
+
+// Nearest pixel index along one axis of the moving image. Returns false if
+// the coordinate is outside of the image. Inside test and rounding match
+// itk::NearestNeighborInterpolateImageFunction.
+static inline auto NearestIndex(double x, int size, int& idx) -> bool
+{
+    if (not(x >= -0.5 and x < static_cast<double>(size) - 0.5)) {
+        return false;
+    }
+    idx = std::min(static_cast<int>(std::floor(x + 0.5)), size - 1);
+    return true;
+}
+
+// Copy the nearest moving pixel for each mapped coordinate. m holds the
+// pixels of a moving image of size full, starting at offset. Pixels which map
+// outside of the moving image are left unchanged.
+template <std::size_t N>
+static void GatherNearest(
+    const cv::Mat& m,
+    const cv::Point& offset,
+    const cv::Size& full,
+    const double* xs,
+    const double* ys,
+    int n,
+    uint8_t* dst)
+{
+    int c{0};
+    int r{0};
+    for (int i = 0; i < n; i++) {
+        if (not NearestIndex(xs[i], full.width, c) or
+            not NearestIndex(ys[i], full.height, r)) {
+            continue;
+        }
+        const auto* src = m.ptr(r - offset.y) + (c - offset.x) * N;
+        std::memcpy(dst + i * N, src, N);
+    }
+}
+
+// Dispatch GatherNearest on the pixel size so the copy is inlined
+static void GatherNearest(
+    const cv::Mat& m,
+    const cv::Point& offset,
+    const cv::Size& full,
+    const double* xs,
+    const double* ys,
+    int n,
+    uint8_t* dst)
+{
+    switch (m.elemSize()) {
+        case 1:
+            return GatherNearest<1>(m, offset, full, xs, ys, n, dst);
+        case 2:
+            return GatherNearest<2>(m, offset, full, xs, ys, n, dst);
+        case 3:
+            return GatherNearest<3>(m, offset, full, xs, ys, n, dst);
+        case 4:
+            return GatherNearest<4>(m, offset, full, xs, ys, n, dst);
+        case 6:
+            return GatherNearest<6>(m, offset, full, xs, ys, n, dst);
+        case 8:
+            return GatherNearest<8>(m, offset, full, xs, ys, n, dst);
+        case 12:
+            return GatherNearest<12>(m, offset, full, xs, ys, n, dst);
+        case 16:
+            return GatherNearest<16>(m, offset, full, xs, ys, n, dst);
+        case 24:
+            return GatherNearest<24>(m, offset, full, xs, ys, n, dst);
+        case 32:
+            return GatherNearest<32>(m, offset, full, xs, ys, n, dst);
+        default:
+            throw std::runtime_error("unsupported image type");
+    }
+}
+
+// Gather from a complete moving image
+static void GatherNearest(
+    const cv::Mat& m, const double* xs, const double* ys, int n, uint8_t* dst)
+{
+    GatherNearest(m, {0, 0}, m.size(), xs, ys, n, dst);
+}
+
+// Resample with the transform mapper. Rows are split across threads.
+static auto ResampleMapped(const cv::Mat& m, const TransformMapper& mapper)
+    -> cv::Mat
+{
+    auto s = mapper.size();
+    cv::Mat out = cv::Mat::zeros(s, m.type());
+    cv::parallel_for_(cv::Range(0, s.height), [&](const cv::Range& range) {
+        std::vector<double> xs(s.width);
+        std::vector<double> ys(s.width);
+        for (auto y = range.start; y < range.end; y++) {
+            mapper.mapRow(y, 0, s.width, xs.data(), ys.data());
+            GatherNearest(m, xs.data(), ys.data(), s.width, out.ptr(y));
+        }
+    });
+    return out;
+}
+
+// Resample from a baked field. Rows are split across threads.
+static auto ResampleField(const cv::Mat& m, const DeformationField* field)
+    -> cv::Mat
+{
+    auto size = field->GetLargestPossibleRegion().GetSize();
+    cv::Size s(static_cast<int>(size[0]), static_cast<int>(size[1]));
+    const auto* disp = field->GetBufferPointer();
+
+    cv::Mat out = cv::Mat::zeros(s, m.type());
+    cv::parallel_for_(cv::Range(0, s.height), [&](const cv::Range& range) {
+        std::vector<double> xs(s.width);
+        std::vector<double> ys(s.width);
+        for (auto y = range.start; y < range.end; y++) {
+            const auto* row = disp + static_cast<std::size_t>(y) * s.width;
+            for (int x = 0; x < s.width; x++) {
+                xs[x] = static_cast<double>(x) + row[x][0];
+                ys[x] = static_cast<double>(y) + row[x][1];
+            }
+            GatherNearest(m, xs.data(), ys.data(), s.width, out.ptr(y));
+        }
+    });
+    return out;
+}
+
+// Resample a single output tile, reading only the part of the moving image it
+// samples
+static auto ResampleTile(
+    io::TIFFRegionReader& moving,
+    int type,
+    const TransformMapper& mapper,
+    const cv::Rect& tile) -> cv::Mat
+{
+    // Map the tile
+    auto w = tile.width;
+    std::vector<double> xs(tile.area());
+    std::vector<double> ys(tile.area());
+    for (int y = 0; y < tile.height; y++) {
+        mapper.mapRow(tile.y + y, tile.x, w, &xs[y * w], &ys[y * w]);
+    }
+
+    // Bounding box of the moving pixels sampled by the tile
+    const auto& movingSize = moving.header().size;
+    auto minX = std::numeric_limits<int>::max();
+    auto minY = std::numeric_limits<int>::max();
+    auto maxX = std::numeric_limits<int>::min();
+    auto maxY = std::numeric_limits<int>::min();
+    int c{0};
+    int r{0};
+    for (std::size_t i = 0; i < xs.size(); i++) {
+        if (NearestIndex(xs[i], movingSize.width, c) and
+            NearestIndex(ys[i], movingSize.height, r)) {
+            minX = std::min(minX, c);
+            minY = std::min(minY, r);
+            maxX = std::max(maxX, c);
+            maxY = std::max(maxY, r);
+        }
+    }
+
+    // Tile is entirely outside of the moving image
+    cv::Mat out = cv::Mat::zeros(tile.size(), type);
+    if (minX > maxX) {
+        return out;
+    }
+
+    // Read and gather
+    cv::Rect roi{minX, minY, maxX - minX + 1, maxY - minY + 1};
+    auto region = moving.read(roi);
+    region = ColorConvertImage(region, CV_MAT_CN(type));
+    for (int y = 0; y < tile.height; y++) {
+        GatherNearest(
+            region, roi.tl(), movingSize, &xs[y * w], &ys[y * w], w,
+            out.ptr(y));
+    }
+    return out;
+}
 
 template <typename TImageType>
 auto InterpolateImage(
@@ -25,99 +209,189 @@ auto InterpolateImage(
     resample->SetSize(s);
     resample->Update();
 
-    return resample->GetOutput();
+    // Keep the input's channel order
+    auto output = resample->GetOutput();
+    output->SetMetaDataDictionary(m->GetMetaDataDictionary());
+    return output;
 }
 
 auto rt::ImageTransformResampler(
     const cv::Mat& m, const cv::Size& s, const Transform::Pointer& transform)
     -> cv::Mat
 {
+    // Composites containing a B-spline are evaluated natively, gathering all
+    // channels together. Otherwise, ITK resamples 1 and 3 channel images. It
+    // has no 2 or 4 channel image types here, so those are resampled one
+    // channel at a time.
+    switch (m.type()) {
+        case CV_8UC1:
+        case CV_8UC3:
+        case CV_16UC1:
+        case CV_16UC3:
+        case CV_32FC1:
+        case CV_32FC3: {
+            TransformMapper mapper(transform, s);
+            if (mapper.isNative()) {
+                return ResampleMapped(m, mapper);
+            }
+            break;
+        }
+        case CV_8UC2:
+        case CV_8UC4:
+        case CV_16UC2:
+        case CV_16UC4:
+        case CV_32FC2:
+        case CV_32FC4: {
+            TransformMapper mapper(transform, s);
+            if (mapper.isNative()) {
+                return ResampleMapped(m, mapper);
+            }
+            std::vector<cv::Mat> cns;
+            cv::split(m, cns);
+            for (auto& c : cns) {
+                c = ImageTransformResampler(c, s, transform);
+            }
+            cv::Mat output;
+            cv::merge(cns, output);
+            return output;
+        }
+        default:
+            throw std::runtime_error("unsupported image type");
+    }
+
     switch (m.type()) {
         case CV_8UC1: {
             using T = Image8UC1;
-            auto i = CVMatToITKImage<T>(m);
+            auto i = CVMatToITKImageView<T>(m);
             i = InterpolateImage<T>(i, {s.width, s.height}, transform);
             return ITKImageToCVMat<T>(i);
         }
         case CV_8UC3: {
             using T = Image8UC3;
-            auto i = CVMatToITKImage<T>(m);
+            auto i = CVMatToITKImageView<T>(m);
             i = InterpolateImage<T>(i, {s.width, s.height}, transform);
             return ITKImageToCVMat<T>(i);
         }
-        case CV_8UC2:
-        case CV_8UC4: {
-            // Extract and transform each channel
-            std::vector<cv::Mat> cns;
-            cv::split(m, cns);
-            for (auto& c : cns) {
-                using T = Image8UC1;
-                auto i = CVMatToITKImage<T>(c);
-                i = InterpolateImage<T>(i, {s.width, s.height}, transform);
-                c = ITKImageToCVMat<T>(i);
-            }
-
-            cv::Mat result(m.rows, m.cols, CV_8U);
-            cv::merge(cns, result);
-            return result;
-        }
         case CV_16UC1: {
             using T = Image16UC1;
-            auto i = CVMatToITKImage<T>(m);
+            auto i = CVMatToITKImageView<T>(m);
             i = InterpolateImage<T>(i, {s.width, s.height}, transform);
             return ITKImageToCVMat<T>(i);
         }
         case CV_16UC3: {
             using T = Image16UC3;
-            auto i = CVMatToITKImage<T>(m);
+            auto i = CVMatToITKImageView<T>(m);
             i = InterpolateImage<T>(i, {s.width, s.height}, transform);
             return ITKImageToCVMat<T>(i);
         }
-        case CV_16UC2:
-        case CV_16UC4: {
-            // Extract and transform each channel
-            std::vector<cv::Mat> cns;
-            cv::split(m, cns);
-            for (auto& c : cns) {
-                using T = Image16UC1;
-                auto i = CVMatToITKImage<T>(c);
-                i = InterpolateImage<T>(i, {s.width, s.height}, transform);
-                c = ITKImageToCVMat<T>(i);
-            }
-
-            cv::Mat result(m.rows, m.cols, CV_16U);
-            cv::merge(cns, result);
-            return result;
-        }
         case CV_32FC1: {
             using T = Image32FC1;
-            auto i = CVMatToITKImage<T>(m);
+            auto i = CVMatToITKImageView<T>(m);
             i = InterpolateImage<T>(i, {s.width, s.height}, transform);
             return ITKImageToCVMat<T>(i);
         }
         case CV_32FC3: {
             using T = Image32FC3;
-            auto i = CVMatToITKImage<T>(m);
+            auto i = CVMatToITKImageView<T>(m);
             i = InterpolateImage<T>(i, {s.width, s.height}, transform);
             return ITKImageToCVMat<T>(i);
         }
-        case CV_32FC2:
-        case CV_32FC4: {
-            // Extract and transform each channel
-            std::vector<cv::Mat> cns;
-            cv::split(m, cns);
-            for (auto& c : cns) {
-                using T = Image32FC1;
-                auto i = CVMatToITKImage<T>(c);
-                i = InterpolateImage<T>(i, {s.width, s.height}, transform);
-                c = ITKImageToCVMat<T>(i);
+        default:
+            throw std::runtime_error("unsupported image type");
+    }
+}
+
+auto rt::ImageTransformResampler(
+    const cv::Mat& m, const DeformationField::Pointer& field) -> cv::Mat
+{
+    if (not field) {
+        throw std::invalid_argument("field is nullptr");
+    }
+    if (m.channels() < 1 or m.channels() > 4) {
+        throw std::runtime_error("unsupported image type");
+    }
+    return ResampleField(m, field.GetPointer());
+}
+
+auto rt::BakeDeformationField(
+    const Transform::Pointer& transform, const cv::Size& s)
+    -> DeformationField::Pointer
+{
+    DeformationField::RegionType region;
+    region.SetSize(
+        {static_cast<itk::SizeValueType>(s.width),
+         static_cast<itk::SizeValueType>(s.height)});
+
+    auto field = DeformationField::New();
+    field->SetRegions(region);
+    field->Allocate();
+    auto* disp = field->GetBufferPointer();
+
+    // Map each row and store the displacement from the output pixel
+    TransformMapper mapper(transform, s);
+    cv::parallel_for_(cv::Range(0, s.height), [&](const cv::Range& range) {
+        std::vector<double> xs(s.width);
+        std::vector<double> ys(s.width);
+        for (auto y = range.start; y < range.end; y++) {
+            mapper.mapRow(y, 0, s.width, xs.data(), ys.data());
+            auto* row = disp + static_cast<std::size_t>(y) * s.width;
+            for (int x = 0; x < s.width; x++) {
+                row[x][0] = xs[x] - static_cast<double>(x);
+                row[x][1] = ys[x] - static_cast<double>(y);
             }
+        }
+    });
+    return field;
+}
 
-            cv::Mat result(m.rows, m.cols, CV_32F);
-            cv::merge(cns, result);
-            return result;
+void rt::TiledImageTransformResampler(
+    const fs::path& moving,
+    const fs::path& output,
+    const cv::Size& s,
+    const Transform::Pointer& transform,
+    bool forceAlpha,
+    const cv::Size& tileSize)
+{
+    // Output type
+    io::TIFFRegionReader reader(moving);
+    auto type = reader.header().type;
+    auto cns = CV_MAT_CN(type);
+    if (forceAlpha and (cns == 1 or cns == 3)) {
+        type = CV_MAKETYPE(CV_MAT_DEPTH(type), cns + 1);
+    }
+
+    io::TIFFTileWriter writer(output, s, type, tileSize);
+    TransformMapper mapper(transform, s);
+
+    // Resample and write one band of tiles at a time. Tiles in a band
+    // usually sample the same moving strips or tiles, so each is decoded
+    // once per band and released before the next band. Tiles are compressed
+    // on the worker threads and only the file write is serialized.
+    cv::Rect bounds{{0, 0}, s};
+    for (int y = 0; y < s.height; y += tileSize.height) {
+        std::vector<cv::Rect> tiles;
+        for (int x = 0; x < s.width; x += tileSize.width) {
+            tiles.emplace_back(cv::Rect{{x, y}, tileSize} & bounds);
         }
-        default:
-            throw std::runtime_error("unsupported image type");
+
+        std::vector<std::exception_ptr> errors(tiles.size());
+        auto range = cv::Range(0, static_cast<int>(tiles.size()));
+        cv::parallel_for_(range, [&](const cv::Range& r) {
+            for (auto i = r.start; i < r.end; i++) {
+                try {
+                    auto tile = ResampleTile(reader, type, mapper, tiles[i]);
+                    writer.writeTile(tile, tiles[i].tl());
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        });
+        for (const auto& e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+        reader.clear();
     }
-}
\ No newline at end of file
+    writer.close();
+}
@@ -1,9 +1,26 @@
 #include "rt/LandmarkDetector.hpp"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
 
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core/hal/hal.hpp>
 #include <opencv2/features2d.hpp>
+#include <opencv2/flann.hpp>
+#include <opencv2/imgproc.hpp>
 
 using namespace rt;
 
@@ -13,50 +30,672 @@ void LandmarkDetector::setMovingImage(const cv::Mat& img) { movingImg_ = img; }
 void LandmarkDetector::setMovingMask(const cv::Mat& img) { movingMask_ = img; }
 void LandmarkDetector::setMatchRatio(float r) { nnMatchRatio_ = r; }
 
-// Compute the matches
-auto LandmarkDetector::compute() -> std::vector<rt::LandmarkPair>
+using Clock = std::chrono::steady_clock;
+using KnnMatches = std::vector<std::vector<cv::DMatch>>;
+
+// Number of key points used to estimate a predicted transform
+constexpr static std::size_t PREDICTION_KEYPOINTS{2000};
+// Minimum number of matches needed to estimate a predicted transform
+constexpr static std::size_t MIN_PREDICTION_MATCHES{10};
+// Number of index leaves checked by approximate searches
+constexpr static int FLANN_CHECKS{64};
+
+// Seconds elapsed since start
+static auto Elapsed(const Clock::time_point& start) -> double
 {
-    // Make sure we have the images
-    if (fixedImg_.empty() || movingImg_.empty()) {
-        throw std::runtime_error("Missing image(s)");
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Run fn(i) for i in [0, count) in parallel. Rethrows the first exception.
+template <typename Fn>
+static void ParallelFor(std::size_t count, Fn fn)
+{
+    std::vector<std::exception_ptr> errors(count);
+    auto range = cv::Range(0, static_cast<int>(count));
+    cv::parallel_for_(range, [&](const cv::Range& r) {
+        for (auto i = r.start; i < r.end; i++) {
+            try {
+                fn(static_cast<std::size_t>(i));
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    });
+    for (const auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
     }
+}
 
-    // Clear the output vector
-    output_.clear();
+// Detect features in an image region. Key points are returned in image
+// coordinates.
+static auto DetectRegion(
+    const cv::Mat& img, const cv::Mat& mask, const cv::Rect& roi)
+    -> ImageFeatures
+{
+    ImageFeatures features;
+    auto detector = cv::AKAZE::create();
+    cv::Mat roiMask = mask.empty() ? cv::Mat() : mask(roi);
+    detector->detectAndCompute(
+        img(roi), roiMask, features.keypoints, features.descriptors);
+    for (auto& kp : features.keypoints) {
+        kp.pt.x += static_cast<float>(roi.x);
+        kp.pt.y += static_cast<float>(roi.y);
+    }
+    return features;
+}
+
+// Detect features in overlapping tiles, in parallel. Each key point is kept
+// only by the tile whose unextended region contains it, which removes
+// duplicate detections in the overlaps.
+static auto DetectTiled(
+    const cv::Mat& img, const cv::Mat& mask, int tileSize, int overlap)
+    -> ImageFeatures
+{
+    const cv::Rect bounds(0, 0, img.cols, img.rows);
+    std::vector<cv::Rect> cores;
+    for (int y = 0; y < img.rows; y += tileSize) {
+        for (int x = 0; x < img.cols; x += tileSize) {
+            cores.emplace_back(cv::Rect(x, y, tileSize, tileSize) & bounds);
+        }
+    }
+
+    std::vector<ImageFeatures> tiles(cores.size());
+    ParallelFor(cores.size(), [&](std::size_t i) {
+        const auto& core = cores[i];
+        cv::Rect roi(
+            core.x - overlap, core.y - overlap, core.width + 2 * overlap,
+            core.height + 2 * overlap);
+        auto detected = DetectRegion(img, mask, roi & bounds);
+
+        const cv::Rect2f owned(core);
+        auto& tile = tiles[i];
+        for (std::size_t k = 0; k < detected.keypoints.size(); k++) {
+            if (owned.contains(detected.keypoints[k].pt)) {
+                tile.keypoints.push_back(detected.keypoints[k]);
+                tile.descriptors.push_back(
+                    detected.descriptors.row(static_cast<int>(k)));
+            }
+        }
+    });
+
+    // Merge in tile order
+    ImageFeatures features;
+    for (const auto& tile : tiles) {
+        features.keypoints.insert(
+            features.keypoints.end(), tile.keypoints.begin(),
+            tile.keypoints.end());
+        if (not tile.descriptors.empty()) {
+            features.descriptors.push_back(tile.descriptors);
+        }
+    }
+    return features;
+}
+
+// Describe the detector parameters for use in feature cache keys
+static auto DetectorParams(
+    LandmarkDetector::DetectionMode mode,
+    int tileSize,
+    int overlap,
+    double scale) -> std::string
+{
+    using DetectionMode = LandmarkDetector::DetectionMode;
+    auto d = cv::AKAZE::create();
+    std::stringstream ss;
+    ss << "AKAZE";
+    ss << " desc=" << d->getDescriptorType();
+    ss << " size=" << d->getDescriptorSize();
+    ss << " channels=" << d->getDescriptorChannels();
+    ss << " threshold=" << d->getThreshold();
+    ss << " octaves=" << d->getNOctaves();
+    ss << " layers=" << d->getNOctaveLayers();
+    ss << " diffusivity=" << d->getDiffusivity();
+    if (mode == DetectionMode::Tiled or mode == DetectionMode::CoarseToFine) {
+        ss << " tile=" << tileSize << " overlap=" << overlap;
+    }
+    if (mode == DetectionMode::CoarseToFine) {
+        ss << " scale=" << scale;
+    }
+    return ss.str();
+}
+
+void LandmarkDetector::setFeatureCache(FeatureCache::Pointer cache)
+{
+    cache_ = std::move(cache);
+}
+
+auto LandmarkDetector::featureCache() const -> FeatureCache::Pointer
+{
+    return cache_;
+}
+
+void LandmarkDetector::setDetectionMode(DetectionMode mode) { mode_ = mode; }
+
+auto LandmarkDetector::detectionMode() const -> DetectionMode
+{
+    return mode_;
+}
+
+void LandmarkDetector::setTileSize(int size)
+{
+    if (size <= 0) {
+        throw std::invalid_argument("Tile size must be positive");
+    }
+    tileSize_ = size;
+}
+
+auto LandmarkDetector::tileSize() const -> int { return tileSize_; }
+
+void LandmarkDetector::setTileOverlap(int overlap)
+{
+    if (overlap < 0) {
+        throw std::invalid_argument("Tile overlap must be non-negative");
+    }
+    tileOverlap_ = overlap;
+}
+
+auto LandmarkDetector::tileOverlap() const -> int { return tileOverlap_; }
+
+void LandmarkDetector::setCoarseScale(double scale)
+{
+    if (scale <= 0 or scale > 1) {
+        throw std::invalid_argument("Coarse scale must be in range (0, 1]");
+    }
+    coarseScale_ = scale;
+}
+
+auto LandmarkDetector::coarseScale() const -> double { return coarseScale_; }
+
+void LandmarkDetector::setRefineRadius(int radius)
+{
+    if (radius <= 0) {
+        throw std::invalid_argument("Refinement radius must be positive");
+    }
+    refineRadius_ = radius;
+}
+
+auto LandmarkDetector::refineRadius() const -> int { return refineRadius_; }
+
+void LandmarkDetector::setMatcherType(MatcherType type)
+{
+    matcherType_ = type;
+}
+
+auto LandmarkDetector::matcherType() const -> MatcherType
+{
+    return matcherType_;
+}
+
+void LandmarkDetector::setSearchRadius(float radius)
+{
+    if (radius < 0) {
+        throw std::invalid_argument("Search radius must be non-negative");
+    }
+    searchRadius_ = radius;
+}
+
+auto LandmarkDetector::searchRadius() const -> float { return searchRadius_; }
+
+void LandmarkDetector::setPredictedTransform(const cv::Mat& tfm)
+{
+    if (not tfm.empty() and (tfm.rows != 2 or tfm.cols != 3)) {
+        throw std::invalid_argument("Predicted transform must be 2x3");
+    }
+    predictedTfm_ = tfm;
+}
+
+auto LandmarkDetector::predictedTransform() const -> cv::Mat
+{
+    return predictedTfm_;
+}
+
+void LandmarkDetector::setGeometricModel(GeometricModel model)
+{
+    model_ = model;
+}
+
+auto LandmarkDetector::geometricModel() const -> GeometricModel
+{
+    return model_;
+}
+
+void LandmarkDetector::setRobustEstimator(RobustEstimator estimator)
+{
+    estimator_ = estimator;
+}
+
+auto LandmarkDetector::robustEstimator() const -> RobustEstimator
+{
+    return estimator_;
+}
+
+void LandmarkDetector::setInlierThreshold(double t)
+{
+    if (t <= 0) {
+        throw std::invalid_argument("Inlier threshold must be positive");
+    }
+    inlierThreshold_ = t;
+}
+
+auto LandmarkDetector::inlierThreshold() const -> double
+{
+    return inlierThreshold_;
+}
+
+void LandmarkDetector::setMaxLandmarks(std::size_t n) { maxLandmarks_ = n; }
+
+auto LandmarkDetector::maxLandmarks() const -> std::size_t
+{
+    return maxLandmarks_;
+}
+
+auto LandmarkDetector::detect_(const cv::Mat& img, const cv::Mat& mask) const
+    -> ImageFeatures
+{
+    // Check the cache
+    std::string key;
+    if (cache_) {
+        auto params =
+            DetectorParams(mode_, tileSize_, tileOverlap_, coarseScale_);
+        key = FeatureCache::Key(img, mask, params);
+        if (auto cached = cache_->get(key, img)) {
+            return *cached;
+        }
+    }
 
     // Detect key points and compute their descriptors
-    auto featureDetector = cv::AKAZE::create();
-    std::vector<cv::KeyPoint> fixedKeys;
-    std::vector<cv::KeyPoint> movingKeys;
-    cv::Mat fixedDesc;
-    cv::Mat movingDesc;
-    featureDetector->detectAndCompute(
-        fixedImg_, fixedMask_, fixedKeys, fixedDesc);
-    featureDetector->detectAndCompute(
-        movingImg_, movingMask_, movingKeys, movingDesc);
+    ImageFeatures features;
+    switch (mode_) {
+        case DetectionMode::Full:
+            features =
+                DetectRegion(img, mask, cv::Rect(0, 0, img.cols, img.rows));
+            break;
+        case DetectionMode::Tiled:
+            features = DetectTiled(img, mask, tileSize_, tileOverlap_);
+            break;
+        case DetectionMode::CoarseToFine: {
+            cv::Mat small;
+            cv::Mat smallMask;
+            cv::resize(
+                img, small, cv::Size(), coarseScale_, coarseScale_,
+                cv::INTER_AREA);
+            if (not mask.empty()) {
+                cv::resize(
+                    mask, smallMask, small.size(), 0, 0, cv::INTER_NEAREST);
+            }
+            features = DetectTiled(small, smallMask, tileSize_, tileOverlap_);
+
+            // Return key points in full resolution coordinates
+            auto scale = static_cast<float>(coarseScale_);
+            for (auto& kp : features.keypoints) {
+                kp.pt /= scale;
+                kp.size /= scale;
+            }
+        } break;
+    }
+
+    if (cache_) {
+        cache_->put(key, img, features);
+    }
+    return features;
+}
+
+// k-nearest-neighbor search using an approximate FLANN index
+static auto KnnSearchIndex(
+    const cv::Mat& query,
+    const cv::Mat& train,
+    const cv::flann::IndexParams& params) -> KnnMatches
+{
+    cv::flann::Index index(train, params, cvflann::FLANN_DIST_HAMMING);
+    cv::Mat indices;
+    cv::Mat dists;
+    index.knnSearch(
+        query, indices, dists, 2, cv::flann::SearchParams(FLANN_CHECKS));
+    dists.convertTo(dists, CV_32F);
+
+    KnnMatches matches(query.rows);
+    for (int q = 0; q < query.rows; q++) {
+        for (int k = 0; k < indices.cols; k++) {
+            auto t = indices.at<int>(q, k);
+            if (t >= 0 and t < train.rows) {
+                matches[q].emplace_back(q, t, 0, dists.at<float>(q, k));
+            }
+        }
+    }
+    return matches;
+}
+
+// k-nearest-neighbor search using the selected backend
+static auto KnnSearch(
+    const cv::Mat& query,
+    const cv::Mat& train,
+    LandmarkDetector::MatcherType type) -> KnnMatches
+{
+    using MatcherType = LandmarkDetector::MatcherType;
+    KnnMatches matches;
+    switch (type) {
+        case MatcherType::BruteForce: {
+            auto matcher = cv::DescriptorMatcher::create(
+                cv::DescriptorMatcher::BRUTEFORCE_HAMMING);
+            matcher->knnMatch(query, train, matches, 2);
+        } break;
+        case MatcherType::LSH:
+            matches = KnnSearchIndex(
+                query, train, cv::flann::LshIndexParams(6, 12, 1));
+            break;
+        case MatcherType::HierarchicalClustering:
+            matches = KnnSearchIndex(
+                query, train,
+                cv::flann::HierarchicalClusteringIndexParams(
+                    32, cvflann::FLANN_CENTERS_RANDOM, 4, 100));
+            break;
+    }
+    return matches;
+}
+
+// k-nearest-neighbor search which only compares train key points within
+// radius of each query key point's predicted position
+static auto KnnSearchSpatial(
+    const ImageFeatures& query,
+    const ImageFeatures& train,
+    const cv::Mat& tfm,
+    float radius) -> KnnMatches
+{
+    // Bucket the train key points into a grid of radius-sized cells
+    auto cellKey = [](int x, int y) {
+        auto ux = static_cast<std::uint64_t>(static_cast<std::uint32_t>(x));
+        return ux << 32 | static_cast<std::uint32_t>(y);
+    };
+    auto cellIdx = [radius](float v) {
+        return static_cast<int>(std::floor(v / radius));
+    };
+    std::unordered_map<std::uint64_t, std::vector<int>> cells;
+    for (int t = 0; t < static_cast<int>(train.keypoints.size()); t++) {
+        const auto& pt = train.keypoints[t].pt;
+        cells[cellKey(cellIdx(pt.x), cellIdx(pt.y))].push_back(t);
+    }
+
+    // Predict the query key point positions
+    std::vector<cv::Point2f> predicted;
+    predicted.reserve(query.keypoints.size());
+    for (const auto& kp : query.keypoints) {
+        predicted.push_back(kp.pt);
+    }
+    cv::transform(predicted, predicted, tfm);
+
+    KnnMatches matches(query.keypoints.size());
+    const auto r2 = radius * radius;
+    const auto cols = query.descriptors.cols;
+    auto range = cv::Range(0, static_cast<int>(query.keypoints.size()));
+    cv::parallel_for_(range, [&](const cv::Range& r) {
+        for (auto q = r.start; q < r.end; q++) {
+            const auto& p = predicted[q];
+            const auto* qDesc = query.descriptors.ptr<std::uint8_t>(q);
+            std::array<cv::DMatch, 2> best;
+            best.fill(cv::DMatch(q, -1, 0, std::numeric_limits<float>::max()));
+            for (auto cy = cellIdx(p.y - radius); cy <= cellIdx(p.y + radius);
+                 cy++) {
+                for (auto cx = cellIdx(p.x - radius);
+                     cx <= cellIdx(p.x + radius); cx++) {
+                    auto it = cells.find(cellKey(cx, cy));
+                    if (it == cells.end()) {
+                        continue;
+                    }
+                    for (const auto& t : it->second) {
+                        auto d = train.keypoints[t].pt - p;
+                        if (d.dot(d) > r2) {
+                            continue;
+                        }
+                        auto dist = static_cast<float>(cv::hal::normHamming(
+                            qDesc, train.descriptors.ptr<std::uint8_t>(t),
+                            cols));
+                        if (dist < best[0].distance) {
+                            best[1] = best[0];
+                            best[0] = cv::DMatch(q, t, 0, dist);
+                        } else if (dist < best[1].distance) {
+                            best[1] = cv::DMatch(q, t, 0, dist);
+                        }
+                    }
+                }
+            }
+            for (const auto& m : best) {
+                if (m.trainIdx >= 0) {
+                    matches[q].push_back(m);
+                }
+            }
+        }
+    });
+    return matches;
+}
+
+// Keep the n key points with the strongest response
+static auto Strongest(const ImageFeatures& features, std::size_t n)
+    -> ImageFeatures
+{
+    if (features.keypoints.size() <= n) {
+        return features;
+    }
+    std::vector<int> idxs(features.keypoints.size());
+    std::iota(idxs.begin(), idxs.end(), 0);
+    std::partial_sort(
+        idxs.begin(), idxs.begin() + static_cast<std::ptrdiff_t>(n),
+        idxs.end(), [&](auto a, auto b) {
+            return features.keypoints[a].response >
+                   features.keypoints[b].response;
+        });
+    ImageFeatures result;
+    for (std::size_t i = 0; i < n; i++) {
+        result.keypoints.push_back(features.keypoints[idxs[i]]);
+        result.descriptors.push_back(features.descriptors.row(idxs[i]));
+    }
+    return result;
+}
+
+// USAC estimators are supported by estimateAffine2D in OpenCV 4.5.1+
+#if CV_VERSION_MAJOR > 4 ||                                                   \
+    (CV_VERSION_MAJOR == 4 &&                                                 \
+     (CV_VERSION_MINOR > 5 ||                                                 \
+      (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 1)))
+#define RT_HAVE_USAC
+#endif
+
+// Convert a RobustEstimator to an OpenCV estimation method
+static auto EstimationMethod(LandmarkDetector::RobustEstimator e) -> int
+{
+#ifdef RT_HAVE_USAC
+    using RobustEstimator = LandmarkDetector::RobustEstimator;
+    switch (e) {
+        case RobustEstimator::RANSAC:
+            return cv::RANSAC;
+        case RobustEstimator::PROSAC:
+            return cv::USAC_PROSAC;
+        case RobustEstimator::MAGSAC:
+            return cv::USAC_MAGSAC;
+    }
+    return cv::RANSAC;
+#else
+    std::ignore = e;
+    return cv::RANSAC;
+#endif
+}
+
+// Select up to n matches spread evenly over the fixed image. Matches are
+// bucketed into a grid over the image, then taken from each cell in turn in
+// their original order.
+static auto Distribute(
+    const std::vector<LandmarkPair>& matches, std::size_t n, cv::Size size)
+    -> std::vector<LandmarkPair>
+{
+    if (n == 0 or matches.size() <= n) {
+        return matches;
+    }
+
+    auto g = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n))));
+    auto cellW = std::max(1.F, static_cast<float>(size.width) / g);
+    auto cellH = std::max(1.F, static_cast<float>(size.height) / g);
+    std::vector<std::vector<std::size_t>> cells(g * g);
+    for (std::size_t i = 0; i < matches.size(); i++) {
+        const auto& pt = matches[i].first;
+        auto cx = std::clamp(static_cast<int>(pt.x / cellW), 0, g - 1);
+        auto cy = std::clamp(static_cast<int>(pt.y / cellH), 0, g - 1);
+        cells[cy * g + cx].push_back(i);
+    }
+
+    std::vector<std::size_t> picked;
+    picked.reserve(n);
+    for (std::size_t round = 0; picked.size() < n; round++) {
+        bool added{false};
+        for (const auto& cell : cells) {
+            if (round < cell.size() and picked.size() < n) {
+                picked.push_back(cell[round]);
+                added = true;
+            }
+        }
+        if (not added) {
+            break;
+        }
+    }
+
+    // Restore the original order
+    std::sort(picked.begin(), picked.end());
+    std::vector<LandmarkPair> result;
+    result.reserve(picked.size());
+    for (const auto& i : picked) {
+        result.push_back(matches[i]);
+    }
+    return result;
+}
+
+auto LandmarkDetector::verify_(
+    const std::vector<LandmarkPair>& matches, std::size_t* numInliers) const
+    -> std::vector<LandmarkPair>
+{
+    if (numInliers) {
+        *numInliers = 0;
+    }
+    if (model_ == GeometricModel::None) {
+        return matches;
+    }
+    std::size_t minPts = (model_ == GeometricModel::Affine) ? 3 : 4;
+    if (matches.size() < minPts) {
+        return matches;
+    }
+
+    std::vector<cv::Point2f> src;
+    std::vector<cv::Point2f> dst;
+    for (const auto& [f, m] : matches) {
+        src.push_back(f);
+        dst.push_back(m);
+    }
+
+    // Estimate the model
+    auto method = EstimationMethod(estimator_);
+    std::vector<std::uint8_t> inliers;
+    cv::Mat model;
+    if (model_ == GeometricModel::Affine) {
+        model = cv::estimateAffine2D(
+            src, dst, inliers, method, inlierThreshold_);
+    } else {
+        model = cv::findHomography(
+            src, dst, method, inlierThreshold_, inliers);
+    }
+    if (model.empty()) {
+        std::cerr << "Warning: Geometric verification failed to fit a model. ";
+        std::cerr << "Matches will not be filtered." << std::endl;
+        return matches;
+    }
+
+    std::vector<LandmarkPair> result;
+    for (std::size_t i = 0; i < matches.size(); i++) {
+        if (inliers[i] != 0) {
+            result.push_back(matches[i]);
+        }
+    }
+    if (numInliers) {
+        *numInliers = result.size();
+    }
+    return result;
+}
+
+auto LandmarkDetector::predict_(
+    const ImageFeatures& fixed, const ImageFeatures& moving) const -> cv::Mat
+{
+    if (not predictedTfm_.empty()) {
+        return predictedTfm_;
+    }
+
+    // Estimate from an unconstrained match of the strongest key points
+    auto matches = match_(
+        Strongest(fixed, PREDICTION_KEYPOINTS),
+        Strongest(moving, PREDICTION_KEYPOINTS));
+    if (matches.size() < MIN_PREDICTION_MATCHES) {
+        return {};
+    }
+    std::vector<cv::Point2f> src;
+    std::vector<cv::Point2f> dst;
+    for (const auto& [f, m] : matches) {
+        src.push_back(f);
+        dst.push_back(m);
+    }
+    return cv::estimateAffine2D(
+        src, dst, cv::noArray(), cv::RANSAC, DEFAULT_INLIER_THRESHOLD);
+}
+
+auto LandmarkDetector::match_(
+    const ImageFeatures& fixed,
+    const ImageFeatures& moving,
+    bool spatial,
+    bool* constrained) const -> std::vector<LandmarkPair>
+{
+    if (constrained) {
+        *constrained = false;
+    }
+    std::vector<LandmarkPair> output;
+    if (fixed.descriptors.empty() or moving.descriptors.rows < 2) {
+        return output;
+    }
 
     // Match keypoints
-    auto matcher = cv::DescriptorMatcher::create(
-        cv::DescriptorMatcher::BRUTEFORCE_HAMMING);
-    std::vector<std::vector<cv::DMatch>> matches;
-    matcher->knnMatch(fixedDesc, movingDesc, matches, 2);
+    cv::Mat tfm;
+    if (spatial and searchRadius_ > 0) {
+        tfm = predict_(fixed, moving);
+    }
+    KnnMatches matches;
+    if (not tfm.empty()) {
+        matches = KnnSearchSpatial(fixed, moving, tfm, searchRadius_);
+        if (constrained) {
+            *constrained = true;
+        }
+    } else {
+        matches =
+            KnnSearch(fixed.descriptors, moving.descriptors, matcherType_);
+    }
 
     // Filter matches
     std::vector<cv::DMatch> goodMatches;
     for (const auto& m : matches) {
+        if (m.size() < 2) {
+            continue;
+        }
         if (m[0].distance < nnMatchRatio_ * m[1].distance) {
             goodMatches.push_back(m[0]);
         }
     }
 
+    // Sort by strength of match. Required by PROSAC.
+    std::stable_sort(
+        goodMatches.begin(), goodMatches.end(),
+        [](const auto& a, const auto& b) { return a.distance < b.distance; });
+
     // Convert good matches to landmark pairs
     // query = fixed, train = moving
     for (const auto& m : goodMatches) {
         // From fixed -> moving
         if (m.imgIdx == 0) {
-            auto fixPt = fixedKeys[m.queryIdx].pt;
-            auto movPt = movingKeys[m.trainIdx].pt;
-            output_.emplace_back(fixPt, movPt);
+            auto fixPt = fixed.keypoints[m.queryIdx].pt;
+            auto movPt = moving.keypoints[m.trainIdx].pt;
+            output.emplace_back(fixPt, movPt);
         }
 
         // From moving -> fixed
@@ -66,9 +705,141 @@ auto LandmarkDetector::compute() -> std::vector<rt::LandmarkPair>
         }
     }
 
+    return output;
+}
+
+auto LandmarkDetector::refine_(
+    const std::vector<LandmarkPair>& coarse,
+    const cv::Mat& movingImg,
+    const cv::Mat& movingMask) const -> std::vector<LandmarkPair>
+{
+    // Match the features in a pair of windows around each coarse match
+    const cv::Rect fixedBounds(0, 0, fixedImg_.cols, fixedImg_.rows);
+    const cv::Rect movingBounds(0, 0, movingImg.cols, movingImg.rows);
+    auto window = [r = refineRadius_](const cv::Point2f& p) {
+        auto x = static_cast<int>(std::round(p.x)) - r;
+        auto y = static_cast<int>(std::round(p.y)) - r;
+        return cv::Rect(x, y, 2 * r + 1, 2 * r + 1);
+    };
+    std::vector<std::vector<LandmarkPair>> local(coarse.size());
+    ParallelFor(coarse.size(), [&](std::size_t i) {
+        auto fixedRoi = window(coarse[i].first) & fixedBounds;
+        auto movingRoi = window(coarse[i].second) & movingBounds;
+        if (fixedRoi.empty() or movingRoi.empty()) {
+            return;
+        }
+        auto fixed = DetectRegion(fixedImg_, fixedMask_, fixedRoi);
+        auto moving = DetectRegion(movingImg, movingMask, movingRoi);
+        local[i] = match_(fixed, moving);
+    });
+
+    // Merge in coarse match order. Windows can overlap, so only keep the
+    // first match for each fixed point.
+    std::vector<LandmarkPair> output;
+    std::set<std::pair<float, float>> seen;
+    for (const auto& matches : local) {
+        for (const auto& m : matches) {
+            if (seen.emplace(m.first.x, m.first.y).second) {
+                output.push_back(m);
+            }
+        }
+    }
+    return output;
+}
+
+auto LandmarkDetector::matchImages_(
+    const ImageFeatures& fixed,
+    const cv::Mat& movingImg,
+    const cv::Mat& movingMask,
+    MatchReport* report) const -> std::vector<LandmarkPair>
+{
+    auto start = Clock::now();
+    auto moving = detect_(movingImg, movingMask);
+    auto detectSeconds = Elapsed(start);
+
+    start = Clock::now();
+    bool constrained{false};
+    auto matches = match_(fixed, moving, true, &constrained);
+    if (mode_ == DetectionMode::CoarseToFine) {
+        matches = refine_(matches, movingImg, movingMask);
+    }
+    auto matchSeconds = Elapsed(start);
+
+    // Filter and cap the matches
+    start = Clock::now();
+    std::size_t inliers{0};
+    auto verified = verify_(matches, report ? &inliers : nullptr);
+    auto landmarks = Distribute(verified, maxLandmarks_, fixedImg_.size());
+    auto filterSeconds = Elapsed(start);
+
+    if (report) {
+        report->movingKeypoints = moving.keypoints.size();
+        report->matches = matches.size();
+        report->verified = model_ != GeometricModel::None;
+        report->inliers = inliers;
+        report->outliersRejected = matches.size() - verified.size();
+        report->landmarks = landmarks.size();
+        report->spatiallyConstrained = constrained;
+        report->detectSeconds += detectSeconds;
+        report->matchSeconds += matchSeconds;
+        report->filterSeconds += filterSeconds;
+    }
+    return landmarks;
+}
+
+// Compute the matches
+auto LandmarkDetector::compute() -> std::vector<rt::LandmarkPair>
+{
+    // Make sure we have the images
+    if (fixedImg_.empty() || movingImg_.empty()) {
+        throw std::runtime_error("Missing image(s)");
+    }
+
+    // Clear the output vector
+    output_.clear();
+    report_ = MatchReport();
+
+    auto start = Clock::now();
+    auto fixed = detect_(fixedImg_, fixedMask_);
+    report_.fixedKeypoints = fixed.keypoints.size();
+    report_.detectSeconds = Elapsed(start);
+    output_ = matchImages_(fixed, movingImg_, movingMask_, &report_);
+
     return output_;
 }
 
+auto LandmarkDetector::computeBatch(
+    const std::vector<cv::Mat>& movingImgs,
+    const std::vector<cv::Mat>& movingMasks)
+    -> std::vector<std::vector<LandmarkPair>>
+{
+    // Make sure we have the images
+    if (fixedImg_.empty()) {
+        throw std::runtime_error("Missing fixed image");
+    }
+    if (not movingMasks.empty() and movingMasks.size() != movingImgs.size()) {
+        throw std::invalid_argument(
+            "Number of moving masks does not match number of moving images");
+    }
+    for (const auto& img : movingImgs) {
+        if (img.empty()) {
+            throw std::runtime_error("Missing moving image(s)");
+        }
+    }
+
+    // Fixed features are shared by all tasks
+    auto fixed = detect_(fixedImg_, fixedMask_);
+
+    // Detect and match each moving image
+    std::vector<std::vector<LandmarkPair>> results(movingImgs.size());
+    ParallelFor(movingImgs.size(), [&](std::size_t i) {
+        const auto& mask = movingMasks.empty() ? cv::Mat() : movingMasks[i];
+        results[i] = matchImages_(fixed, movingImgs[i], mask);
+    });
+
+    return results;
+}
+
 // Return previously computed matches
 auto LandmarkDetector::getLandmarkPairs() -> std::vector<rt::LandmarkPair>
 {
@@ -100,3 +871,40 @@ auto LandmarkDetector::getMovingLandmarks() const -> LandmarkContainer
 }
 
 auto LandmarkDetector::matchRatio() const -> float { return nnMatchRatio_; }
+
+auto LandmarkDetector::matchReport() const -> MatchReport { return report_; }
+
+auto LandmarkDetector::MatchReport::inlierRatio() const -> double
+{
+    if (matches == 0) {
+        return 0;
+    }
+    return static_cast<double>(inliers) / static_cast<double>(matches);
+}
+
+auto rt::operator<<(std::ostream& os, const LandmarkDetector::MatchReport& r)
+    -> std::ostream&
+{
+    auto flags = os.flags();
+    auto precision = os.precision();
+    os << "Key points: " << r.fixedKeypoints << " fixed, ";
+    os << r.movingKeypoints << " moving\n";
+    os << "Matches: " << r.matches << "\n";
+    if (r.verified) {
+        os << "Inliers: " << r.inliers << " (" << std::fixed
+           << std::setprecision(1) << 100 * r.inlierRatio() << "%)\n";
+    } else {
+        os << "Inliers: not verified\n";
+    }
+    os << "Outliers rejected: " << r.outliersRejected << "\n";
+    os << "Landmarks: " << r.landmarks << "\n";
+    os << "Spatially constrained: ";
+    os << (r.spatiallyConstrained ? "yes" : "no") << "\n";
+    os << "Detection time: " << std::setprecision(3) << r.detectSeconds;
+    os << " s\n";
+    os << "Matching time: " << r.matchSeconds << " s\n";
+    os << "Filtering time: " << r.filterSeconds << " s";
+    os.flags(flags);
+    os.precision(precision);
+    return os;
+}
@@ -0,0 +1,110 @@
+#include "rt/io/MemoryMappedFile.hpp"
+
+#include <fstream>
+#include <utility>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RT_HAVE_MMAP
+#endif
+
+#include "rt/types/Exceptions.hpp"
+
+using namespace rt;
+using namespace rt::io;
+
+namespace fs = rt::filesystem;
+
+MemoryMappedFile::MemoryMappedFile(const fs::path& path)
+{
+#ifdef RT_HAVE_MMAP
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw IOException("Failed to open file for reading: " + path.string());
+    }
+
+    struct stat info {
+    };
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw IOException("Failed to stat file: " + path.string());
+    }
+
+    // mmap rejects zero-length mappings
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ > 0) {
+        auto* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw IOException("Failed to map file: " + path.string());
+        }
+        ::posix_madvise(addr, size_, POSIX_MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(addr);
+        mapped_ = true;
+    }
+
+    // The mapping remains valid after the descriptor is closed
+    ::close(fd);
+#else
+    std::ifstream ifs(path.string(), std::ios::binary | std::ios::ate);
+    if (not ifs.good()) {
+        throw IOException("Failed to open file for reading: " + path.string());
+    }
+    buffer_.resize(static_cast<std::size_t>(ifs.tellg()));
+    ifs.seekg(0);
+    ifs.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    if (ifs.fail()) {
+        throw IOException("Failed to read file: " + path.string());
+    }
+    size_ = buffer_.size();
+    data_ = buffer_.empty() ? nullptr : buffer_.data();
+#endif
+}
+
+MemoryMappedFile::~MemoryMappedFile() { release_(); }
+
+MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)}
+    , size_{std::exchange(other.size_, 0)}
+    , mapped_{std::exchange(other.mapped_, false)}
+    , buffer_{std::move(other.buffer_)}
+{
+}
+
+auto MemoryMappedFile::operator=(MemoryMappedFile&& other) noexcept
+    -> MemoryMappedFile&
+{
+    if (this != &other) {
+        release_();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapped_ = std::exchange(other.mapped_, false);
+        buffer_ = std::move(other.buffer_);
+    }
+    return *this;
+}
+
+auto MemoryMappedFile::data() const -> const char* { return data_; }
+
+auto MemoryMappedFile::size() const -> std::size_t { return size_; }
+
+auto MemoryMappedFile::view() const -> std::string_view
+{
+    return {data_, size_};
+}
+
+void MemoryMappedFile::release_()
+{
+#ifdef RT_HAVE_MMAP
+    if (mapped_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    buffer_.clear();
+}
@@ -0,0 +1,187 @@
+#include "rt/MeshAccelerator.hpp"
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <vtkCellArray.h>
+#include <vtkOBBTree.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+using namespace rt;
+
+// Check if a value is near zero
+template <
+    typename T,
+    std::enable_if_t<std::is_floating_point<T>::value, bool> = true>
+static inline auto NearZero(T val, T eps = 1e-7) -> bool
+{
+    return std::abs(val) <= eps;
+}
+
+MeshAccelerator::MeshAccelerator(const ITKMesh::Pointer& mesh, const UVMap& uv)
+    : mesh_{mesh}, uv_{uv}
+{
+    if (not mesh) {
+        throw std::invalid_argument("mesh is nullptr");
+    }
+
+    vertices_.reserve(mesh->GetNumberOfPoints());
+    for (auto it = mesh->GetPoints()->Begin(); it != mesh->GetPoints()->End();
+         ++it) {
+        const auto& p = it.Value();
+        vertices_.emplace_back(p[0], p[1], p[2]);
+    }
+
+    faces_.reserve(mesh->GetNumberOfCells());
+    faceUVs_.reserve(3 * mesh->GetNumberOfCells());
+    for (auto cell = mesh->GetCells()->Begin(); cell != mesh->GetCells()->End();
+         ++cell) {
+        const auto& ids = cell.Value()->GetPointIdsContainer();
+        faces_.emplace_back(ids[0], ids[1], ids[2]);
+
+        if (not uv.hasFace(cell.Index())) {
+            throw std::out_of_range(
+                "face not in uv map: " + std::to_string(cell.Index()));
+        }
+        auto uvs = uv.faceUVs(cell.Index());
+        faceUVs_.insert(faceUVs_.end(), uvs.begin(), uvs.end());
+    }
+}
+
+auto MeshAccelerator::New(const ITKMesh::Pointer& mesh, const UVMap& uv)
+    -> Pointer
+{
+    return std::make_shared<MeshAccelerator>(mesh, uv);
+}
+
+auto MeshAccelerator::mesh() const -> ITKMesh::Pointer { return mesh_; }
+
+auto MeshAccelerator::uvMap() const -> const UVMap& { return uv_; }
+
+auto MeshAccelerator::vertices() const -> const std::vector<cv::Vec3d>&
+{
+    return vertices_;
+}
+
+auto MeshAccelerator::faces() const -> const std::vector<Face>&
+{
+    return faces_;
+}
+
+auto MeshAccelerator::faceUVs() const -> const std::vector<cv::Vec2d>&
+{
+    return faceUVs_;
+}
+
+auto MeshAccelerator::obb() const -> OBB
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (obb_) {
+        return *obb_;
+    }
+
+    // vtkOBBTree weights by face area, so it needs the faces as well as the
+    // points. Point precision matches ITK2VTK.
+    auto points = vtkSmartPointer<vtkPoints>::New();
+    points->SetNumberOfPoints(static_cast<vtkIdType>(vertices_.size()));
+    for (std::size_t i = 0; i < vertices_.size(); i++) {
+        points->SetPoint(static_cast<vtkIdType>(i), vertices_[i].val);
+    }
+    auto polys = vtkSmartPointer<vtkCellArray>::New();
+    for (const auto& f : faces_) {
+        std::array<vtkIdType, 3> ids{
+            static_cast<vtkIdType>(f[0]), static_cast<vtkIdType>(f[1]),
+            static_cast<vtkIdType>(f[2])};
+        polys->InsertNextCell(3, ids.data());
+    }
+    auto polyData = vtkSmartPointer<vtkPolyData>::New();
+    polyData->SetPoints(points);
+    polyData->SetPolys(polys);
+
+    // Computes the OBB and returns the 3 axes relative to the box
+    OBB box;
+    std::array<double, 3> size;
+    auto obbTree = vtkSmartPointer<vtkOBBTree>::New();
+    obbTree->ComputeOBB(
+        polyData, box.origin.val, box.xAxis.val, box.yAxis.val, box.zAxis.val,
+        size.data());
+    obb_ = box;
+    return box;
+}
+
+auto MeshAccelerator::uvDensity(const cv::Size& s) const -> double
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto key = std::make_pair(s.width, s.height);
+    if (auto it = density_.find(key); it != density_.end()) {
+        return it->second;
+    }
+
+    double density{0};
+    std::size_t count{0};
+
+    auto maxXIdx = static_cast<double>(s.width) - 1;
+    auto maxYIdx = static_cast<double>(s.height) - 1;
+
+    // For each face
+    for (std::size_t face = 0; face < faces_.size(); face++) {
+        const auto& f = faces_[face];
+        const auto* uvs = &faceUVs_[3 * face];
+
+        // Update the density for each edge
+        for (std::size_t idxA = 0; idxA < 3; idxA++) {
+            // Next idx in the list
+            auto idxB = (idxA == 2) ? 0 : idxA + 1;
+
+            // Transform UVs to image coordinates
+            cv::Vec2d uvA{uvs[idxA][0] * maxXIdx, uvs[idxA][1] * maxYIdx};
+            cv::Vec2d uvB{uvs[idxB][0] * maxXIdx, uvs[idxB][1] * maxYIdx};
+
+            // Calculate 2D and 3D edge lengths
+            auto edge3D = cv::norm(vertices_[f[idxB]] - vertices_[f[idxA]]);
+            auto edge2D = cv::norm(uvB - uvA);
+
+            // Skip if one of the lengths is zero or nan
+            if (NearZero(edge3D) or std::isnan(edge3D) or NearZero(edge2D) or
+                std::isnan(edge2D)) {
+                continue;
+            }
+
+            // Update the density
+            auto edgeDensity = edge3D / edge2D;
+            count++;
+            density += (edgeDensity - density) / static_cast<double>(count);
+        }
+    }
+
+    density_[key] = density;
+    return density;
+}
+
+auto MeshAccelerator::rayCaster(const cv::Vec3d& direction) const
+    -> const ParallelRayCaster&
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [dir, caster] : casters_) {
+        if (dir == direction) {
+            return *caster;
+        }
+    }
+
+    // Only the first caster builds a BVH
+    std::unique_ptr<ParallelRayCaster> caster;
+    if (casters_.empty()) {
+        caster = std::make_unique<ParallelRayCaster>(
+            vertices_, faces_, direction);
+    } else {
+        caster = std::make_unique<ParallelRayCaster>(
+            casters_.front().second->withDirection(direction));
+    }
+    casters_.emplace_back(direction, std::move(caster));
+    return *casters_.back().second;
+}
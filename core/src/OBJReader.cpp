@@ -1,12 +1,16 @@
 #include "rt/io/OBJReader.hpp"
 
-#include <regex>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
 #include <string>
+#include <string_view>
 
 #include <opencv2/imgcodecs.hpp>
 
+#include "rt/io/MemoryMappedFile.hpp"
 #include "rt/types/Exceptions.hpp"
-#include "rt/util/String.hpp"
 
 using namespace rt;
 using namespace rt::io;
@@ -17,6 +21,9 @@ namespace fs = rt::filesystem;
 constexpr static std::size_t NOT_PRESENT = 0;
 constexpr static size_t VALID_FACE_SIZE = 3;
 
+// Minimum number of bytes parsed by a single task
+constexpr static std::size_t MIN_CHUNK_SIZE = 1 << 20;
+
 // Validation enumeration to ensure proper parsing vertices
 enum class RefType {
     Invalid,
@@ -26,7 +33,24 @@ enum class RefType {
     VertexWithTextureAndNormal
 };
 
-static auto ClassifyVertexRef(const std::string& ref) -> RefType;
+namespace
+{
+// Same layout as OBJReader::VertexRefs and OBJReader::Face
+using Refs = cv::Vec<std::size_t, 3>;
+using Triangle = std::array<Refs, VALID_FACE_SIZE>;
+
+// Elements parsed from one chunk of the OBJ file, in file order
+struct Chunk {
+    std::vector<cv::Vec3d> vertices;
+    std::vector<cv::Vec3d> normals;
+    std::vector<cv::Vec2d> uvs;
+    std::vector<Triangle> faces;
+    std::vector<std::string> mtllibs;
+    std::string error;
+};
+}  // namespace
+
+static auto ClassifyVertexRef(std::string_view ref) -> RefType;
 
 void OBJReader::setPath(const fs::path& p) { path_ = p; }
 
@@ -53,6 +77,8 @@ auto OBJReader::getTextureMat() -> cv::Mat
     return cv::imread(texturePath_.string(), -1);
 }
 
+auto OBJReader::getTexturePath() const -> fs::path { return texturePath_; }
+
 // Prepare all data structures to read a new file
 void OBJReader::reset_()
 {
@@ -63,121 +89,256 @@ void OBJReader::reset_()
     texturePath_.clear();
 }
 
-// Parse the file
-void OBJReader::parse_()
+// Whitespace within a line
+static inline auto IsBlank(char c) -> bool
 {
-    std::regex vertex{"^v"};
-    std::regex normal{"^vn"};
-    std::regex tcoord{"^vt"};
-    std::regex face{"^f"};
-    std::regex mtllib("^mtllib");
+    return c == ' ' or c == '\t' or c == '\r' or c == '\v' or c == '\f';
+}
 
-    std::ifstream ifs(path_.string());
-    if (!ifs.good()) {
-        throw IOException("Failed to open file for reading");
+// Remove and return the next whitespace-delimited token in a line. Returns
+// an empty token at the end of the line.
+static auto NextToken(std::string_view& line) -> std::string_view
+{
+    std::size_t begin{0};
+    while (begin < line.size() and IsBlank(line[begin])) {
+        begin++;
     }
+    auto end = begin;
+    while (end < line.size() and not IsBlank(line[end])) {
+        end++;
+    }
+    auto token = line.substr(begin, end - begin);
+    line.remove_prefix(end);
+    return token;
+}
 
-    std::string line;
-    while (std::getline(ifs, line)) {
-        // Parse the line
-        trim(line);
-        if (line.empty()) {
-            continue;
-        }
-        auto strs = split(line, ' ');
-        std::for_each(
-            std::begin(strs), std::end(strs), [](auto& t) { trim(t); });
+// Parse a floating-point token. Like std::stod, trailing characters are
+// ignored.
+static auto ParseReal(std::string_view token) -> double
+{
+    if (not token.empty() and token.front() == '+') {
+        token.remove_prefix(1);
+    }
+    double val{0};
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto res = std::from_chars(token.data(), token.data() + token.size(), val);
+    if (token.empty() or res.ec != std::errc()) {
+        throw IOException("Failed to parse number in obj file");
+    }
+#else
+    // No floating-point from_chars: strtod needs a terminated string
+    std::string str(token);
+    char* end{nullptr};
+    val = std::strtod(str.c_str(), &end);
+    if (end == str.c_str()) {
+        throw IOException("Failed to parse number in obj file");
+    }
+#endif
+    return val;
+}
 
-        // Handle vertices
-        if (std::regex_match(strs[0], vertex)) {
-            parse_vertex_(strs);
-        }
+// Parse a 1-based element index
+static auto ParseIndex(std::string_view token) -> std::size_t
+{
+    std::size_t val{0};
+    auto res = std::from_chars(token.data(), token.data() + token.size(), val);
+    if (token.empty() or res.ec != std::errc() or
+        res.ptr != token.data() + token.size()) {
+        throw IOException("Invalid face in obj file");
+    }
+    return val;
+}
 
-        // Handle normals
-        else if (std::regex_match(strs[0], normal)) {
-            parse_normal_(strs);
-        }
+// Parse a face vertex of the given type
+static auto ParseVertexRef(std::string_view ref, RefType type) -> Refs
+{
+    if (ClassifyVertexRef(ref) != type) {
+        throw IOException("Invalid face in obj file");
+    }
 
-        // Handle texture coordinates
-        else if (std::regex_match(strs[0], tcoord)) {
-            parse_tcoord_(strs);
+    auto pos0 = ref.find('/');
+    switch (type) {
+        case RefType::Vertex:
+            return {ParseIndex(ref), NOT_PRESENT, NOT_PRESENT};
+        case RefType::VertexWithTexture:
+            return {
+                ParseIndex(ref.substr(0, pos0)),
+                ParseIndex(ref.substr(pos0 + 1)), NOT_PRESENT};
+        case RefType::VertexWithNormal:
+            return {
+                ParseIndex(ref.substr(0, pos0)), NOT_PRESENT,
+                ParseIndex(ref.substr(pos0 + 2))};
+        case RefType::VertexWithTextureAndNormal: {
+            auto pos1 = ref.find('/', pos0 + 1);
+            return {
+                ParseIndex(ref.substr(0, pos0)),
+                ParseIndex(ref.substr(pos0 + 1, pos1 - pos0 - 1)),
+                ParseIndex(ref.substr(pos1 + 1))};
         }
+        case RefType::Invalid:
+            break;
+    }
+    throw IOException("Invalid face in obj file");
+}
+
+// Parse a single line into the chunk
+static void ParseLine(std::string_view line, Chunk& chunk)
+{
+    auto key = NextToken(line);
+
+    // Handle vertices
+    if (key == "v") {
+        auto x = ParseReal(NextToken(line));
+        auto y = ParseReal(NextToken(line));
+        auto z = ParseReal(NextToken(line));
+        chunk.vertices.emplace_back(x, y, z);
+    }
+
+    // Handle normals
+    else if (key == "vn") {
+        auto x = ParseReal(NextToken(line));
+        auto y = ParseReal(NextToken(line));
+        auto z = ParseReal(NextToken(line));
+        chunk.normals.emplace_back(x, y, z);
+    }
+
+    // Handle texture coordinates
+    else if (key == "vt") {
+        auto u = ParseReal(NextToken(line));
+        auto v = ParseReal(NextToken(line));
+        chunk.uvs.emplace_back(u, v);
+    }
 
-        // Handle faces
-        else if (std::regex_match(strs[0], face)) {
-            parse_face_(strs);
+    // Handle faces
+    else if (key == "f") {
+        auto ref = NextToken(line);
+        if (ref.empty()) {
+            throw IOException("Invalid face in obj file");
         }
+        auto type = ClassifyVertexRef(ref);
 
-        // Handle mtllib
-        else if (std::regex_match(strs[0], mtllib)) {
-            parse_mtllib_(strs);
+        Triangle face;
+        std::size_t size{0};
+        for (; not ref.empty(); ref = NextToken(line)) {
+            if (size == VALID_FACE_SIZE) {
+                throw IOException("Parsed unsupported, non-triangular face");
+            }
+            face[size++] = ParseVertexRef(ref, type);
+        }
+        if (size != VALID_FACE_SIZE) {
+            throw IOException("Parsed unsupported, non-triangular face");
         }
+        chunk.faces.push_back(face);
     }
 
-    ifs.close();
+    // Handle mtllib
+    else if (key == "mtllib") {
+        auto file = NextToken(line);
+        if (file.empty()) {
+            throw IOException("Missing mtl file in obj file");
+        }
+        chunk.mtllibs.emplace_back(file);
+    }
 }
 
-void OBJReader::parse_vertex_(const std::vector<std::string>& strs)
+// Parse every line in a chunk
+static void ParseChunk(std::string_view text, Chunk& chunk)
 {
-    auto a = std::stod(strs[1]);
-    auto b = std::stod(strs[2]);
-    auto c = std::stod(strs[3]);
-    vertices_.emplace_back(a, b, c);
+    while (not text.empty()) {
+        auto eol = text.find('\n');
+        ParseLine(text.substr(0, eol), chunk);
+        text.remove_prefix(
+            eol == std::string_view::npos ? text.size() : eol + 1);
+    }
 }
 
-void OBJReader::parse_normal_(const std::vector<std::string>& strs)
+// Split text into chunk offsets which fall on line boundaries
+static auto ChunkOffsets(std::string_view text) -> std::vector<std::size_t>
 {
-    auto a = std::stod(strs[1]);
-    auto b = std::stod(strs[2]);
-    auto c = std::stod(strs[3]);
-    normals_.emplace_back(a, b, c);
+    auto maxChunks =
+        static_cast<std::size_t>(4 * std::max(cv::getNumThreads(), 1));
+    auto numChunks =
+        std::clamp<std::size_t>(text.size() / MIN_CHUNK_SIZE, 1, maxChunks);
+
+    std::vector<std::size_t> offsets{0};
+    for (std::size_t i = 1; i < numChunks; i++) {
+        auto pos = std::max(i * (text.size() / numChunks), offsets.back());
+        auto eol = text.find('\n', pos);
+        if (eol == std::string_view::npos or eol + 1 == text.size()) {
+            break;
+        }
+        offsets.push_back(eol + 1);
+    }
+    offsets.push_back(text.size());
+    return offsets;
 }
 
-void OBJReader::parse_tcoord_(const std::vector<std::string>& strs)
+// Parse the file
+void OBJReader::parse_()
 {
-    auto u = std::stod(strs[1]);
-    auto v = std::stod(strs[2]);
-    uvs_.emplace_back(u, v);
-}
+    MemoryMappedFile file(path_);
+    auto text = file.view();
+
+    // Parse the chunks in parallel
+    auto offsets = ChunkOffsets(text);
+    std::vector<Chunk> chunks(offsets.size() - 1);
+    cv::parallel_for_(
+        cv::Range(0, static_cast<int>(chunks.size())),
+        [&](const cv::Range& range) {
+            for (auto i = range.start; i < range.end; i++) {
+                auto& chunk = chunks[i];
+                auto begin = offsets[i];
+                try {
+                    ParseChunk(
+                        text.substr(begin, offsets[i + 1] - begin), chunk);
+                } catch (const std::exception& e) {
+                    chunk.error = e.what();
+                }
+            }
+        });
+
+    // Report the first error in the file
+    std::size_t numVerts{0};
+    std::size_t numNormals{0};
+    std::size_t numUVs{0};
+    std::size_t numFaces{0};
+    for (const auto& chunk : chunks) {
+        if (not chunk.error.empty()) {
+            throw IOException(chunk.error);
+        }
+        numVerts += chunk.vertices.size();
+        numNormals += chunk.normals.size();
+        numUVs += chunk.uvs.size();
+        numFaces += chunk.faces.size();
+    }
 
-void OBJReader::parse_face_(const std::vector<std::string>& strs)
-{
-    OBJReader::Face f;
-    std::vector<std::string> sub(std::begin(strs) + 1, std::end(strs));
-    auto faceType = ClassifyVertexRef(sub[0]);
-
-    for (const auto& s : sub) {
-        auto vinfo = split(s, '/');
-        switch (faceType) {
-            case RefType::Vertex:
-                f.emplace_back(std::stoull(vinfo[0]), NOT_PRESENT, NOT_PRESENT);
-                break;
-            case RefType::VertexWithTexture:
-                f.emplace_back(
-                    std::stoull(vinfo[0]), std::stoull(vinfo[1]), NOT_PRESENT);
-                break;
-            case RefType::VertexWithNormal:
-                f.emplace_back(
-                    std::stoull(vinfo[0]), NOT_PRESENT, std::stoull(vinfo[1]));
-                break;
-            case RefType::VertexWithTextureAndNormal:
-                f.emplace_back(
-                    std::stoull(vinfo[0]), std::stoull(vinfo[1]),
-                    std::stoull(vinfo[2]));
-                break;
-            case RefType::Invalid:
-                throw IOException("Invalid face in obj file");
+    // Merge in file order so that element indices are global
+    vertices_.reserve(numVerts);
+    normals_.reserve(numNormals);
+    uvs_.reserve(numUVs);
+    faces_.reserve(numFaces);
+    for (auto& chunk : chunks) {
+        vertices_.insert(
+            vertices_.end(), chunk.vertices.begin(), chunk.vertices.end());
+        normals_.insert(
+            normals_.end(), chunk.normals.begin(), chunk.normals.end());
+        uvs_.insert(uvs_.end(), chunk.uvs.begin(), chunk.uvs.end());
+        faces_.insert(faces_.end(), chunk.faces.begin(), chunk.faces.end());
+
+        // Handle mtllibs in order. The last map_Kd wins.
+        for (const auto& mtl : chunk.mtllibs) {
+            parse_mtllib_(mtl);
         }
+        chunk = Chunk();
     }
-    faces_.push_back(f);
 }
 
-void OBJReader::parse_mtllib_(const std::vector<std::string>& strs)
+void OBJReader::parse_mtllib_(const std::string& mtlFile)
 {
     // Get mtl path, relative to OBJ directory
     // Two canonicals because path_ may be relative as well
     fs::path mtlPath =
-        fs::canonical(fs::canonical(path_.parent_path()) / strs[1]);
+        fs::canonical(fs::canonical(path_.parent_path()) / mtlFile);
 
     // Open the mtl file
     std::ifstream ifs(mtlPath.string());
@@ -185,31 +346,22 @@ void OBJReader::parse_mtllib_(const std::vector<std::string>& strs)
         throw IOException("Failed to open mtl file for reading");
     }
 
-    // Find the map_kd line
-    std::regex mapKd{"^map_Kd"};
-
     // Parse the file
     std::string line;
     while (std::getline(ifs, line)) {
-        trim(line);
-        if (line.empty()) {
-            continue;
-        }
-        auto mtlstrs = split(line, ' ');
-        std::for_each(
-            std::begin(mtlstrs), std::end(mtlstrs), [](auto& t) { trim(t); });
+        std::string_view rest(line);
 
         // Handle map_Kd
-        if (std::regex_match(mtlstrs[0], mapKd)) {
-            texturePath_ =
-                fs::canonical(fs::canonical(path_.parent_path()) / mtlstrs[1]);
+        if (NextToken(rest) == "map_Kd") {
+            auto texture = NextToken(rest);
+            texturePath_ = fs::canonical(
+                fs::canonical(path_.parent_path()) / std::string(texture));
         }
-        mtlstrs.clear();
     }
     ifs.close();
 }
 
-auto ClassifyVertexRef(const std::string& ref) -> RefType
+auto ClassifyVertexRef(std::string_view ref) -> RefType
 {
     const char delimiter = '/';
     auto slashCount = std::count(ref.begin(), ref.end(), delimiter);
@@ -272,10 +424,6 @@ void OBJReader::build_mesh_()
     ITKCell::CellAutoPointer cell;
     ITKMesh::CellIdentifier cid = 0;
     for (const auto& face : faces_) {
-        if (face.size() != VALID_FACE_SIZE) {
-            throw IOException("Parsed unsupported, non-triangular face");
-        }
-
         // Setup output objects
         cell.TakeOwnership(new ITKTriangle);
         UVMap::Face uvFace;
@@ -1,6 +1,12 @@
 #include "rt/io/OBJWriter.hpp"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "rt/io/ImageIO.hpp"
 
@@ -8,6 +14,63 @@ namespace fs = rt::filesystem;
 
 static constexpr std::size_t UNSET_VALUE = 0;
 
+// Number of elements formatted by a single task
+static constexpr std::size_t CHUNK_SIZE = 1 << 16;
+
+// Append a real number in its shortest round-trip representation
+static void AppendReal(std::string& buf, double val)
+{
+    std::array<char, 32> str{};
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto res = std::to_chars(str.data(), str.data() + str.size(), val);
+    buf.append(str.data(), res.ptr);
+#else
+    // No floating-point to_chars: 17 significant digits always round-trip
+    auto len = std::snprintf(str.data(), str.size(), "%.17g", val);
+    buf.append(str.data(), static_cast<std::size_t>(len));
+#endif
+}
+
+// Append an unsigned integer
+static void AppendIndex(std::string& buf, std::size_t val)
+{
+    std::array<char, 24> str{};
+    auto res = std::to_chars(str.data(), str.data() + str.size(), val);
+    buf.append(str.data(), res.ptr);
+}
+
+// Format elements [0, count) in parallel and write them in order. Chunks of
+// CHUNK_SIZE elements are formatted into separate buffers, a batch of chunks
+// at a time, and each buffer is written with a single call.
+template <typename FormatFn>
+static void WriteChunked(std::ostream& os, std::size_t count, FormatFn format)
+{
+    auto numThreads = std::max(cv::getNumThreads(), 1);
+    std::vector<std::string> bufs(4 * static_cast<std::size_t>(numThreads));
+    auto batchSize = bufs.size() * CHUNK_SIZE;
+    for (std::size_t batch = 0; batch < count; batch += batchSize) {
+        auto numChunks = std::min(
+            bufs.size(), (count - batch + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        cv::parallel_for_(
+            cv::Range(0, static_cast<int>(numChunks)),
+            [&](const cv::Range& r) {
+                for (auto c = r.start; c < r.end; c++) {
+                    auto& buf = bufs[c];
+                    buf.clear();
+                    auto begin = batch + c * CHUNK_SIZE;
+                    auto end = std::min(begin + CHUNK_SIZE, count);
+                    for (auto i = begin; i < end; i++) {
+                        format(buf, i);
+                    }
+                }
+            });
+        for (std::size_t c = 0; c < numChunks; c++) {
+            os.write(
+                bufs[c].data(), static_cast<std::streamsize>(bufs[c].size()));
+        }
+    }
+}
+
 using namespace rt::io;
 
 OBJWriter::OBJWriter(fs::path outputPath, ITKMesh::Pointer mesh)
@@ -156,32 +219,41 @@ auto OBJWriter::write_vertices_() -> int
 
     outputMesh_ << "# Vertices: " << mesh_->GetNumberOfPoints() << "\n";
 
-    // Iterate over all of the points
-    std::size_t vIndex = 1;
+    // Assign OBJ indices. Normal indices only count points with normals.
+    const auto& points = mesh_->GetPoints()->CastToSTLConstContainer();
+    pointLinks_.assign(points.size(), PointLink());
+    std::vector<ITKPixel> normals(points.size());
     std::size_t vnIndex = 1;
-    for (auto pt = mesh_->GetPoints()->Begin(); pt != mesh_->GetPoints()->End();
-         pt++) {
-        // Make a new point link for this point
-        PointLink pointLink(vIndex, UNSET_VALUE, UNSET_VALUE);
-
-        // Write the point position components
-        outputMesh_ << "v " << pt.Value()[0] << " " << pt.Value()[1] << " "
-                    << pt.Value()[2] << "\n";
-
-        // Write the point normal information
-        ITKPixel normal;
-        if (mesh_->GetPointData(pt.Index(), &normal)) {
-            outputMesh_ << "vn " << normal[0] << " " << normal[1] << " "
-                        << normal[2] << "\n";
-            pointLink[2] = vnIndex++;
+    for (std::size_t pId = 0; pId < points.size(); ++pId) {
+        pointLinks_[pId][0] = pId + 1;
+        if (mesh_->GetPointData(pId, &normals[pId])) {
+            pointLinks_[pId][2] = vnIndex++;
         }
-
-        // Add this vertex to the point links
-        pointLinks_.insert({pt.Index(), pointLink});
-
-        ++vIndex;
     }
 
+    // Write the point positions and normals
+    WriteChunked(outputMesh_, points.size(), [&](auto& buf, auto pId) {
+        const auto& pt = points[pId];
+        buf += "v ";
+        AppendReal(buf, pt[0]);
+        buf += ' ';
+        AppendReal(buf, pt[1]);
+        buf += ' ';
+        AppendReal(buf, pt[2]);
+        buf += '\n';
+
+        if (pointLinks_[pId][2] != UNSET_VALUE) {
+            const auto& normal = normals[pId];
+            buf += "vn ";
+            AppendReal(buf, normal[0]);
+            buf += ' ';
+            AppendReal(buf, normal[1]);
+            buf += ' ';
+            AppendReal(buf, normal[2]);
+            buf += '\n';
+        }
+    });
+
     return EXIT_SUCCESS;
 }
 
@@ -193,24 +265,23 @@ auto OBJWriter::write_texture_coordinates_() -> int
     }
     std::cerr << "Writing texture coordinates...\n";
 
-    // Ensure coordinates are relative to bottom left
-    auto startingOrigin = uvMap_.origin();
-    uvMap_.setOrigin(UVMap::Origin::BottomLeft);
-
     // Write mtl path, relative to OBJ
     auto mtlpath = outputPath_.stem();
     mtlpath.replace_extension("mtl");
     outputMesh_ << "# Texture information\n";
     outputMesh_ << "mtllib " << mtlpath.string() << "\n";
 
-    // Iterate over all of the saved coordinates in our coordinate map
-    for (std::size_t pId = 0; pId < uvMap_.size(); ++pId) {
-        cv::Vec2d uv = uvMap_.getUV(pId);
-        outputMesh_ << "vt " << uv[0] << " " << uv[1] << "\n";
-    }
+    // Write all of the saved coordinates, relative to bottom left
+    const auto& uvMap = uvMap_;
+    WriteChunked(outputMesh_, uvMap.size(), [&](auto& buf, auto pId) {
+        auto uv = uvMap.getUV(pId, UVMap::Origin::BottomLeft);
+        buf += "vt ";
+        AppendReal(buf, uv[0]);
+        buf += ' ';
+        AppendReal(buf, uv[1]);
+        buf += '\n';
+    });
 
-    // Restore the starting origin
-    uvMap_.setOrigin(startingOrigin);
     return EXIT_SUCCESS;
 }
 
@@ -223,62 +294,64 @@ auto OBJWriter::write_faces_() -> int
     std::cerr << "Writing faces...\n";
 
     outputMesh_ << "# Faces: " << mesh_->GetNumberOfCells() << "\n";
-
-    bool usingImageMTL = false;
     outputMesh_ << "usemtl default\n";
 
-    // Iterate over the faces of the mesh
-    for (auto cell = mesh_->GetCells()->Begin();
-         cell != mesh_->GetCells()->End(); ++cell) {
-        // Get the UV indices for this face
-        auto hasUVFace = not uvMap_.empty() and uvMap_.hasFace(cell.Index());
-        UVMap::Face uvFace;
-        if (hasUVFace) {
-            uvFace = uvMap_.getFace(cell.Index());
+    // Whether a face uses the image material
+    const auto& cells = mesh_->GetCells()->CastToSTLConstContainer();
+    const auto& uvMap = uvMap_;
+    auto hasUVFace = [&](std::size_t cId) {
+        return not uvMap.empty() and uvMap.hasFace(cId);
+    };
+
+    // The material only changes between faces with and without UVs, so the
+    // active material at each face depends only on the previous face
+    WriteChunked(outputMesh_, cells.size(), [&](auto& buf, auto cId) {
+        auto hasUV = hasUVFace(cId);
+        auto usingImageMTL =
+            cId > 0 and not texture_.empty() and hasUVFace(cId - 1);
+        if (not texture_.empty() and hasUV and not usingImageMTL) {
+            buf += "usemtl image\n";
         }
-
-        if (not texture_.empty() and hasUVFace and not usingImageMTL) {
-            outputMesh_ << "usemtl image\n";
-            usingImageMTL = true;
+        if (not hasUV and usingImageMTL) {
+            buf += "usemtl default\n";
         }
 
-        if (not hasUVFace and usingImageMTL) {
-            outputMesh_ << "usemtl default\n";
-            usingImageMTL = false;
+        UVMap::Face uvFace;
+        if (hasUV) {
+            uvFace = uvMap.faces()[cId];
         }
 
         // Starts a new face line
-        outputMesh_ << "f ";
+        buf += "f ";
 
         // Iterate over the points of this face
         int pIdx{0};
-        for (auto* point = cell.Value()->PointIdsBegin();
-             point != cell.Value()->PointIdsEnd(); ++point) {
-
-            auto pId = static_cast<std::size_t>(*point);
-            auto pointLink = pointLinks_.find(pId)->second;
-
-            outputMesh_ << pointLink[0];
+        const auto* cell = cells[cId];
+        for (const auto* point = cell->PointIdsBegin();
+             point != cell->PointIdsEnd(); ++point) {
+            const auto& pointLink = pointLinks_[*point];
+            AppendIndex(buf, pointLink[0]);
 
             // Write the vtIndex
-            if (hasUVFace) {
-                outputMesh_ << "/" << uvFace[pIdx] + 1;
+            if (hasUV) {
+                buf += '/';
+                AppendIndex(buf, uvFace[pIdx] + 1);
             }
 
             // Write the vnIndex
             if (pointLink[2] != UNSET_VALUE) {
                 // Write a buffer slash if there wasn't a vtIndex
-                if (not hasUVFace) {
-                    outputMesh_ << "/";
+                if (not hasUV) {
+                    buf += '/';
                 }
-
-                outputMesh_ << "/" << pointLink[2];
+                buf += '/';
+                AppendIndex(buf, pointLink[2]);
             }
             pIdx++;
-            outputMesh_ << " ";
+            buf += ' ';
         }
-        outputMesh_ << "\n";
-    }
+        buf += '\n';
+    });
 
     return EXIT_SUCCESS;
 }
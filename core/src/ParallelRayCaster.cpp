@@ -0,0 +1,397 @@
+#include "rt/ParallelRayCaster.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <bvh/bvh.hpp>
+#include <bvh/sweep_sah_builder.hpp>
+#include <bvh/triangle.hpp>
+#include <bvh/vector.hpp>
+
+using namespace rt;
+
+using Bvh = bvh::Bvh<float>;
+using Triangle = bvh::Triangle<float>;
+using Vector3 = bvh::Vector3<float>;
+
+namespace
+{
+constexpr int PacketSize =
+    ParallelRayCaster::PacketDim * ParallelRayCaster::PacketDim;
+
+// Same as bvh::SingleRayTraverser
+constexpr std::size_t StackSize{64};
+
+// A triangle prepared for a fixed ray direction d. With c = p0 - o, a ray
+// from o hits the triangle at u = c.a, v = c.b, t = c.n. This is the
+// bvh::Triangle test with the direction-dependent terms factored out.
+struct PackedTriangle {
+    // First vertex
+    float p0[3];
+    // (e2 x d) / (n . d)
+    float a[3];
+    // (e1 x d) / (n . d)
+    float b[3];
+    // n / (n . d)
+    float n[3];
+};
+
+// A packet of rays in structure-of-arrays layout. Unused rays have a
+// negative tMax, so they never hit anything.
+struct Packet {
+    alignas(32) float ox[PacketSize];
+    alignas(32) float oy[PacketSize];
+    alignas(32) float oz[PacketSize];
+    alignas(32) float tMax[PacketSize];
+    alignas(32) float u[PacketSize];
+    alignas(32) float v[PacketSize];
+    std::size_t prim[PacketSize];
+};
+
+// 1 / x, clamped away from infinity as in bvh::FastNodeIntersector
+inline auto SafeInverse(float x) -> float
+{
+    constexpr auto eps = std::numeric_limits<float>::epsilon();
+    return std::abs(x) <= eps ? std::copysign(1.0f / eps, x) : 1.0f / x;
+}
+// Direction-independent data. Shared between casters for the same mesh.
+struct Tree {
+    // BVH over the mesh faces
+    Bvh bvh;
+    // Face vertices relative to center, in BVH leaf order
+    std::vector<std::array<cv::Vec3d, 3>> faces;
+    // Mesh face index of each leaf-order face
+    std::vector<std::size_t> faceIds;
+    // Center of the mesh bounds. Triangles and rays are relative to this.
+    cv::Vec3d center;
+};
+
+// Vertex positions of a mesh
+auto MeshVertices(const ITKMesh::Pointer& mesh) -> std::vector<cv::Vec3d>
+{
+    if (not mesh) {
+        throw std::invalid_argument("mesh is nullptr");
+    }
+    std::vector<cv::Vec3d> vertices;
+    vertices.reserve(mesh->GetNumberOfPoints());
+    for (auto it = mesh->GetPoints()->Begin(); it != mesh->GetPoints()->End();
+         ++it) {
+        const auto& p = it.Value();
+        vertices.emplace_back(p[0], p[1], p[2]);
+    }
+    return vertices;
+}
+
+// Triangle vertex indices of a mesh, in cell order
+auto MeshFaces(const ITKMesh::Pointer& mesh)
+    -> std::vector<ParallelRayCaster::Face>
+{
+    if (not mesh) {
+        throw std::invalid_argument("mesh is nullptr");
+    }
+    std::vector<ParallelRayCaster::Face> faces;
+    faces.reserve(mesh->GetNumberOfCells());
+    for (auto cell = mesh->GetCells()->Begin(); cell != mesh->GetCells()->End();
+         ++cell) {
+        const auto& ids = cell.Value()->GetPointIdsContainer();
+        faces.emplace_back(ids[0], ids[1], ids[2]);
+    }
+    return faces;
+}
+}  // namespace
+
+struct ParallelRayCaster::Impl {
+    // BVH and faces
+    std::shared_ptr<const Tree> tree;
+    // Triangles in BVH leaf order, packed for the ray direction
+    std::vector<PackedTriangle> tris;
+    // Ray direction
+    float dir[3]{0, 0, 0};
+    // Inverse ray direction
+    float invDir[3]{0, 0, 0};
+    // Ray direction octant: 1 if the direction is negative along an axis
+    int neg[3]{0, 0, 0};
+
+    // Pack the tree's triangles for a ray direction
+    void setDirection(const cv::Vec3d& direction);
+    // Whether any ray in the packet hits the node's bounds
+    [[nodiscard]] auto hitsNode(const Bvh::Node& node, const Packet& p) const
+        -> bool;
+    // Intersect every ray in the packet with packed triangle j
+    void intersect(std::size_t j, Packet& p) const;
+    // Traverse the BVH with a packet
+    void traverse(Packet& p) const;
+};
+
+auto ParallelRayCaster::Impl::hitsNode(
+    const Bvh::Node& node, const Packet& p) const -> bool
+{
+    // bvh stores bounds as {min x, max x, min y, max y, min z, max z}
+    const auto* b = node.bounds;
+    auto x0 = b[0 + neg[0]];
+    auto x1 = b[1 - neg[0]];
+    auto y0 = b[2 + neg[1]];
+    auto y1 = b[3 - neg[1]];
+    auto z0 = b[4 + neg[2]];
+    auto z1 = b[5 - neg[2]];
+
+    int any{0};
+    for (int i = 0; i < PacketSize; i++) {
+        auto tx0 = (x0 - p.ox[i]) * invDir[0];
+        auto tx1 = (x1 - p.ox[i]) * invDir[0];
+        auto ty0 = (y0 - p.oy[i]) * invDir[1];
+        auto ty1 = (y1 - p.oy[i]) * invDir[1];
+        auto tz0 = (z0 - p.oz[i]) * invDir[2];
+        auto tz1 = (z1 - p.oz[i]) * invDir[2];
+        auto entry = std::max(std::max(tx0, ty0), std::max(tz0, 0.0f));
+        auto exit = std::min(std::min(tx1, ty1), std::min(tz1, p.tMax[i]));
+        any |= static_cast<int>(entry <= exit);
+    }
+    return any != 0;
+}
+
+void ParallelRayCaster::Impl::intersect(std::size_t j, Packet& p) const
+{
+    const auto& tri = tris[j];
+    for (int i = 0; i < PacketSize; i++) {
+        auto cx = tri.p0[0] - p.ox[i];
+        auto cy = tri.p0[1] - p.oy[i];
+        auto cz = tri.p0[2] - p.oz[i];
+        auto u = cx * tri.a[0] + cy * tri.a[1] + cz * tri.a[2];
+        auto v = cx * tri.b[0] + cy * tri.b[1] + cz * tri.b[2];
+        auto t = cx * tri.n[0] + cy * tri.n[1] + cz * tri.n[2];
+        auto hit = (u >= 0.0f) & (v >= 0.0f) & (1.0f - u - v >= 0.0f) &
+                   (t >= 0.0f) & (t < p.tMax[i]);
+        p.tMax[i] = hit ? t : p.tMax[i];
+        p.u[i] = hit ? u : p.u[i];
+        p.v[i] = hit ? v : p.v[i];
+        p.prim[i] = hit ? j : p.prim[i];
+    }
+}
+
+void ParallelRayCaster::Impl::traverse(Packet& p) const
+{
+    std::array<std::size_t, StackSize> stack;
+    std::size_t size{0};
+    stack[size++] = 0;
+
+    // Projection of a node's center onto the ray direction. Sorts children
+    // front to back, which is the same for every ray in the packet.
+    auto depth = [this](const Bvh::Node& n) {
+        const auto* b = n.bounds;
+        return (b[0] + b[1]) * dir[0] + (b[2] + b[3]) * dir[1] +
+               (b[4] + b[5]) * dir[2];
+    };
+
+    while (size > 0) {
+        const auto& node = tree->bvh.nodes[stack[--size]];
+        if (not hitsNode(node, p)) {
+            continue;
+        }
+
+        auto first = static_cast<std::size_t>(node.first_child_or_primitive);
+        if (node.is_leaf()) {
+            auto last = first + static_cast<std::size_t>(node.primitive_count);
+            for (auto j = first; j < last; j++) {
+                intersect(j, p);
+            }
+            continue;
+        }
+
+        // Push the far child first
+        auto left = first;
+        auto right = first + 1;
+        const auto& nodes = tree->bvh.nodes;
+        if (depth(nodes[left]) > depth(nodes[right])) {
+            std::swap(left, right);
+        }
+        if (size + 2 > StackSize) {
+            throw std::runtime_error("BVH traversal stack overflow");
+        }
+        stack[size++] = right;
+        stack[size++] = left;
+    }
+}
+
+void ParallelRayCaster::Impl::setDirection(const cv::Vec3d& direction)
+{
+    for (int d = 0; d < 3; d++) {
+        dir[d] = static_cast<float>(direction[d]);
+        invDir[d] = SafeInverse(dir[d]);
+        neg[d] = static_cast<int>(invDir[d] < 0.0f);
+    }
+
+    // Computed in double precision, then rounded
+    auto nan = std::numeric_limits<float>::quiet_NaN();
+    tris.resize(tree->faces.size());
+    for (std::size_t j = 0; j < tree->faces.size(); j++) {
+        const auto& f = tree->faces[j];
+        auto e1 = f[0] - f[1];
+        auto e2 = f[2] - f[0];
+        auto n = e1.cross(e2);
+        auto det = n.dot(direction);
+
+        auto& t = tris[j];
+        for (int d = 0; d < 3; d++) {
+            t.p0[d] = static_cast<float>(f[0][d]);
+        }
+
+        // Parallel to the rays: never hit
+        if (det == 0.0) {
+            std::fill_n(t.a, 3, nan);
+            std::fill_n(t.b, 3, nan);
+            std::fill_n(t.n, 3, nan);
+            continue;
+        }
+        auto a = e2.cross(direction) / det;
+        auto b = e1.cross(direction) / det;
+        auto nd = n / det;
+        for (int d = 0; d < 3; d++) {
+            t.a[d] = static_cast<float>(a[d]);
+            t.b[d] = static_cast<float>(b[d]);
+            t.n[d] = static_cast<float>(nd[d]);
+        }
+    }
+}
+
+ParallelRayCaster::ParallelRayCaster(
+    const ITKMesh::Pointer& mesh, const cv::Vec3d& direction)
+    : ParallelRayCaster(MeshVertices(mesh), MeshFaces(mesh), direction)
+{
+}
+
+ParallelRayCaster::ParallelRayCaster(
+    const std::vector<cv::Vec3d>& vertices,
+    const std::vector<Face>& faces,
+    const cv::Vec3d& direction)
+    : impl_{std::make_unique<Impl>()}
+{
+    if (faces.empty()) {
+        throw std::invalid_argument("mesh has no faces");
+    }
+
+    auto tree = std::make_shared<Tree>();
+
+    // Center of the mesh bounds
+    cv::Vec3d minPt = cv::Vec3d::all(std::numeric_limits<double>::max());
+    cv::Vec3d maxPt = cv::Vec3d::all(std::numeric_limits<double>::lowest());
+    for (const auto& v : vertices) {
+        for (int d = 0; d < 3; d++) {
+            minPt[d] = std::min(minPt[d], v[d]);
+            maxPt[d] = std::max(maxPt[d], v[d]);
+        }
+    }
+    tree->center = 0.5 * (minPt + maxPt);
+
+    // Single precision triangles relative to the center
+    auto toVec = [&tree](const cv::Vec3d& v) {
+        auto r = v - tree->center;
+        return Vector3(
+            static_cast<float>(r[0]), static_cast<float>(r[1]),
+            static_cast<float>(r[2]));
+    };
+    std::vector<Triangle> triangles;
+    triangles.reserve(faces.size());
+    for (const auto& f : faces) {
+        triangles.emplace_back(
+            toVec(vertices.at(f[0])), toVec(vertices.at(f[1])),
+            toVec(vertices.at(f[2])));
+    }
+
+    // Build the BVH
+    auto& bvh = tree->bvh;
+    bvh::SweepSahBuilder<Bvh> builder(bvh);
+    auto [bboxes, centers] = bvh::compute_bounding_boxes_and_centers(
+        triangles.data(), triangles.size());
+    auto meshBBox =
+        bvh::compute_bounding_boxes_union(bboxes.get(), triangles.size());
+    builder.build(meshBBox, bboxes.get(), centers.get(), triangles.size());
+
+    // Store the double precision faces in leaf order
+    tree->faces.resize(faces.size());
+    tree->faceIds.resize(faces.size());
+    for (std::size_t j = 0; j < faces.size(); j++) {
+        auto id = bvh.primitive_indices[j];
+        const auto& f = faces[id];
+        for (int i = 0; i < 3; i++) {
+            tree->faces[j][i] = vertices[f[i]] - tree->center;
+        }
+        tree->faceIds[j] = id;
+    }
+
+    impl_->tree = std::move(tree);
+    impl_->setDirection(direction);
+}
+
+ParallelRayCaster::ParallelRayCaster() : impl_{std::make_unique<Impl>()} {}
+
+ParallelRayCaster::ParallelRayCaster(ParallelRayCaster&&) noexcept = default;
+
+auto ParallelRayCaster::operator=(ParallelRayCaster&&) noexcept
+    -> ParallelRayCaster& = default;
+
+ParallelRayCaster::~ParallelRayCaster() = default;
+
+auto ParallelRayCaster::withDirection(const cv::Vec3d& direction) const
+    -> ParallelRayCaster
+{
+    ParallelRayCaster caster;
+    caster.impl_->tree = impl_->tree;
+    caster.impl_->setDirection(direction);
+    return caster;
+}
+
+void ParallelRayCaster::cast(
+    const cv::Vec3d& origin,
+    const cv::Vec3d& du,
+    const cv::Vec3d& dv,
+    int nu,
+    int nv,
+    double tMax,
+    Hit* hits) const
+{
+    if (nu < 1 or nu > PacketDim or nv < 1 or nv > PacketDim) {
+        throw std::invalid_argument("Packet size out of range");
+    }
+
+    // Setup the packet
+    Packet p;
+    auto o = origin - impl_->tree->center;
+    for (int j = 0; j < PacketDim; j++) {
+        for (int i = 0; i < PacketDim; i++) {
+            auto idx = j * PacketDim + i;
+            auto r = o + i * du + j * dv;
+            p.ox[idx] = static_cast<float>(r[0]);
+            p.oy[idx] = static_cast<float>(r[1]);
+            p.oz[idx] = static_cast<float>(r[2]);
+            auto active = i < nu and j < nv;
+            p.tMax[idx] = active ? static_cast<float>(tMax) : -1.0f;
+            p.u[idx] = 0;
+            p.v[idx] = 0;
+            p.prim[idx] = NoHit;
+        }
+    }
+
+    impl_->traverse(p);
+
+    // Copy out the hits
+    for (int j = 0; j < nv; j++) {
+        for (int i = 0; i < nu; i++) {
+            auto idx = j * PacketDim + i;
+            auto& h = hits[idx];
+            if (p.prim[idx] == NoHit) {
+                h = Hit{};
+                continue;
+            }
+            h.face = impl_->tree->faceIds[p.prim[idx]];
+            h.distance = p.tMax[idx];
+            h.u = p.u[idx];
+            h.v = p.v[idx];
+        }
+    }
+}
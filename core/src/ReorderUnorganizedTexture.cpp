@@ -1,122 +1,208 @@
 #include "rt/ReorderUnorganizedTexture.hpp"
 
+#include <algorithm>
 #include <array>
+#include <limits>
+#include <stdexcept>
 
-#include <bvh/bvh.hpp>
-#include <bvh/primitive_intersectors.hpp>
-#include <bvh/ray.hpp>
-#include <bvh/single_ray_traverser.hpp>
-#include <bvh/sweep_sah_builder.hpp>
-#include <bvh/triangle.hpp>
-#include <bvh/vector.hpp>
 #include <opencv2/imgproc.hpp>
-#include <vtkOBBTree.h>
 
-#include "rt/types/ITK2VTK.hpp"
-
-using Scalar = double;
-using Vector3 = bvh::Vector3<Scalar>;
-using Triangle = bvh::Triangle<Scalar>;
-using Ray = bvh::Ray<Scalar>;
-using Bvh = bvh::Bvh<Scalar>;
-using Intersector = bvh::ClosestPrimitiveIntersector<Bvh, Triangle>;
-using Traverser = bvh::SingleRayTraverser<Bvh>;
+#include "rt/ParallelRayCaster.hpp"
+#include "rt/util/ImageConversion.hpp"
 
 using namespace rt;
 
-// Generate the cartesian coordinate of barycentric coordinate uvw in tri abc
-static inline auto BaryToXYZ(
-    const cv::Vec3d& uvw,
-    const cv::Vec3d& a,
-    const cv::Vec3d& b,
-    const cv::Vec3d& c) -> cv::Vec3d
-{
-    return uvw[0] * a + uvw[1] * b + uvw[2] * c;
-}
-
-// Get the vertices belong to a cell
-template <typename CellIterator>
-static inline auto GetCellVertices(
-    const ITKMesh::Pointer& mesh, CellIterator& cell)
+// Bilinear interpolate an 8UC3 image at (x, y). Matches the fixed-point
+// arithmetic and replicated border of cv::getRectSubPix with a 1x1 patch.
+static inline auto SampleBilinear(const cv::Mat& img, float x, float y)
+    -> cv::Vec3b
 {
-    std::vector<cv::Vec3d> pts;
-    for (const auto& id : cell->Value()->GetPointIdsContainer()) {
-        auto p = mesh->GetPoint(id);
-        pts.template emplace_back(p[0], p[1], p[2]);
+    constexpr int Shift{16};
+    auto ix = cvFloor(x);
+    auto iy = cvFloor(y);
+    auto a = x - static_cast<float>(ix);
+    auto b = y - static_cast<float>(iy);
+    auto w00 = cvRound((1.f - a) * (1.f - b) * (1 << Shift));
+    auto w01 = cvRound(a * (1.f - b) * (1 << Shift));
+    auto w10 = cvRound((1.f - a) * b * (1 << Shift));
+    auto w11 = cvRound(a * b * (1 << Shift));
+
+    auto x0 = std::clamp(ix, 0, img.cols - 1);
+    auto x1 = std::clamp(ix + 1, 0, img.cols - 1);
+    auto y0 = std::clamp(iy, 0, img.rows - 1);
+    auto y1 = std::clamp(iy + 1, 0, img.rows - 1);
+    const auto* r0 = img.ptr<cv::Vec3b>(y0);
+    const auto* r1 = img.ptr<cv::Vec3b>(y1);
+
+    cv::Vec3b out;
+    for (int c = 0; c < 3; c++) {
+        auto v = r0[x0][c] * w00 + r0[x1][c] * w01 + r1[x0][c] * w10 +
+                 r1[x1][c] * w11;
+        out[c] = cv::saturate_cast<uint8_t>((v + (1 << (Shift - 1))) >> Shift);
     }
-    return pts;
+    return out;
 }
 
-// Check if a value is near zero
-template <
-    typename T,
-    std::enable_if_t<std::is_floating_point<T>::value, bool> = true>
-static inline auto NearZero(T val, T eps = 1e-7) -> bool
+// A mesh face projected onto the sampling plane. Positions are in output
+// pixel coordinates. Depth is the distance along the ray direction.
+struct ProjectedFace {
+    cv::Vec2d a, b, c;
+    cv::Vec3d depth;
+    double area{0};
+};
+
+// Barycentric coordinates of p relative to face f. Returns false if p is
+// outside of the face.
+static inline auto FaceBarycentric(
+    const ProjectedFace& f, const cv::Vec2d& p, cv::Vec3d& w) -> bool
 {
-    return std::abs(val) <= eps;
+    auto edge = [](const cv::Vec2d& x, const cv::Vec2d& y, const cv::Vec2d& q) {
+        return (y[0] - x[0]) * (q[1] - x[1]) - (y[1] - x[1]) * (q[0] - x[0]);
+    };
+    w[0] = edge(f.b, f.c, p) / f.area;
+    w[1] = edge(f.c, f.a, p) / f.area;
+    w[2] = edge(f.a, f.b, p) / f.area;
+    return w[0] >= 0 and w[1] >= 0 and w[2] >= 0;
 }
 
-// Calculate the pixel density of the UV map
-static inline auto ComputeUVDensity(
-    const ITKMesh::Pointer& mesh,
-    const UVMap& uv,
-    double imgWidth,
-    double imgHeight) -> double
+// Rasterize the mesh into the sampling plane. Pixel (u, v) corresponds to the
+// ray start + u * du + v * dv with direction dir. For every pixel, keeps the
+// nearest face along dir in [0, tMax). Fills depth (CV_32F) and faceIds
+// (CV_32S, -1 if no face covers the pixel). Rows are split into bands which
+// are rasterized in parallel.
+static void RasterizeMesh(
+    const MeshAccelerator& mesh,
+    const cv::Vec3d& start,
+    const cv::Vec3d& du,
+    const cv::Vec3d& dv,
+    const cv::Vec3d& dir,
+    double tMax,
+    cv::Mat& depth,
+    cv::Mat& faceIds,
+    std::vector<ProjectedFace>& faces)
 {
-    double density{0};
-    std::size_t count{0};
-
-    auto maxXIdx = imgWidth - 1;
-    auto maxYIdx = imgHeight - 1;
-
-    // For each face
-    for (auto cell = mesh->GetCells()->Begin(); cell != mesh->GetCells()->End();
-         ++cell) {
-
-        // Get the 3D vertices
-        auto pts = GetCellVertices(mesh, cell);
-
-        // Get the UV coordinates for this face
-        auto uvs = uv.getFaceUVs(cell->Index());
-
-        // Transform UVs to image coordinates
-        std::transform(
-            uvs.begin(), uvs.end(), uvs.begin(),
-            [maxXIdx, maxYIdx](const cv::Vec2d& p) -> cv::Vec2d {
-                return {p[0] * maxXIdx, p[1] * maxYIdx};
-            });
-
-        // Update the density for each edge
-        for (std::size_t idxA = 0; idxA < 3; idxA++) {
-            // Next idx in the list
-            auto idxB = (idxA == 2) ? 0 : idxA + 1;
-
-            // Calculate 2D and 3D edge lengths
-            auto edge3D = cv::norm(pts[idxB] - pts[idxA]);
-            auto edge2D = cv::norm(uvs[idxB] - uvs[idxA]);
-
-            // Skip if one of the lengths is zero or nan
-            if (NearZero(edge3D) or std::isnan(edge3D) or NearZero(edge2D) or
-                std::isnan(edge2D)) {
-                continue;
-            }
+    // Project the faces
+    auto uAxis = du / du.dot(du);
+    auto vAxis = dv / dv.dot(dv);
+    auto project = [&](std::size_t id) {
+        auto d = mesh.vertices()[id] - start;
+        return cv::Vec3d{d.dot(uAxis), d.dot(vAxis), d.dot(dir)};
+    };
+    faces.clear();
+    faces.reserve(mesh.faces().size());
+    for (const auto& ids : mesh.faces()) {
+        auto a = project(ids[0]);
+        auto b = project(ids[1]);
+        auto c = project(ids[2]);
+        ProjectedFace f;
+        f.a = {a[0], a[1]};
+        f.b = {b[0], b[1]};
+        f.c = {c[0], c[1]};
+        f.depth = {a[2], b[2], c[2]};
+        f.area = (f.b[0] - f.a[0]) * (f.c[1] - f.a[1]) -
+                 (f.b[1] - f.a[1]) * (f.c[0] - f.a[0]);
+        faces.push_back(f);
+    }
 
-            // Update the density
-            auto edgeDensity = edge3D / edge2D;
-            count++;
-            density += (edgeDensity - density) / static_cast<double>(count);
+    // Bin the faces by the row bands they overlap. Faces parallel to the
+    // rays cover no pixels.
+    constexpr int BandRows{64};
+    auto rows = depth.rows;
+    auto cols = depth.cols;
+    auto numBands = (rows + BandRows - 1) / BandRows;
+    std::vector<std::vector<int>> bands(numBands);
+    for (std::size_t i = 0; i < faces.size(); i++) {
+        const auto& f = faces[i];
+        if (f.area == 0) {
+            continue;
+        }
+        auto vMin = std::min({f.a[1], f.b[1], f.c[1]});
+        auto vMax = std::max({f.a[1], f.b[1], f.c[1]});
+        if (vMax < 0 or vMin > rows - 1) {
+            continue;
+        }
+        auto first = std::max(static_cast<int>(std::ceil(vMin)), 0);
+        auto last = std::min(static_cast<int>(std::floor(vMax)), rows - 1);
+        for (auto b = first / BandRows; b <= last / BandRows; b++) {
+            bands[b].push_back(static_cast<int>(i));
         }
     }
 
-    return density;
+    // Rasterize each band
+    depth = std::numeric_limits<float>::max();
+    faceIds = -1;
+    cv::parallel_for_(cv::Range(0, numBands), [&](const cv::Range& range) {
+        for (auto band = range.start; band < range.end; band++) {
+            auto bandMin = band * BandRows;
+            auto bandMax = std::min(bandMin + BandRows, rows) - 1;
+            for (auto id : bands[band]) {
+                const auto& f = faces[id];
+                auto uMin = std::min({f.a[0], f.b[0], f.c[0]});
+                auto uMax = std::max({f.a[0], f.b[0], f.c[0]});
+                auto vMin = std::min({f.a[1], f.b[1], f.c[1]});
+                auto vMax = std::max({f.a[1], f.b[1], f.c[1]});
+                if (uMax < 0 or uMin > cols - 1) {
+                    continue;
+                }
+                auto u0 = static_cast<int>(std::ceil(uMin));
+                auto u1 = static_cast<int>(std::floor(uMax));
+                auto v0 = static_cast<int>(std::ceil(vMin));
+                auto v1 = static_cast<int>(std::floor(vMax));
+                u0 = std::max(u0, 0);
+                u1 = std::min(u1, cols - 1);
+                v0 = std::max(v0, bandMin);
+                v1 = std::min(v1, bandMax);
+                for (auto v = v0; v <= v1; v++) {
+                    auto* depthRow = depth.ptr<float>(v);
+                    auto* faceRow = faceIds.ptr<int>(v);
+                    for (auto u = u0; u <= u1; u++) {
+                        cv::Vec2d p{
+                            static_cast<double>(u), static_cast<double>(v)};
+                        cv::Vec3d w;
+                        if (not FaceBarycentric(f, p, w)) {
+                            continue;
+                        }
+                        auto t = w.dot(f.depth);
+                        if (t < 0 or t >= tMax or t >= depthRow[u]) {
+                            continue;
+                        }
+                        depthRow[u] = static_cast<float>(t);
+                        faceRow[u] = id;
+                    }
+                }
+            }
+        }
+    });
 }
 
 void ReorderUnorganizedTexture::setMesh(const ITKMesh::Pointer& mesh)
 {
+    accel_.reset();
     inputMesh_ = mesh;
 }
 
-void ReorderUnorganizedTexture::setUVMap(const UVMap& uv) { inputUV_ = uv; }
+void ReorderUnorganizedTexture::setUVMap(const UVMap& uv)
+{
+    accel_.reset();
+    inputUV_ = uv;
+}
+
+void ReorderUnorganizedTexture::setMeshAccelerator(
+    const MeshAccelerator::Pointer& accel)
+{
+    if (not accel) {
+        throw std::invalid_argument("accelerator is nullptr");
+    }
+    accel_ = accel;
+    inputMesh_ = accel->mesh();
+    inputUV_ = accel->uvMap();
+}
+
+auto ReorderUnorganizedTexture::meshAccelerator() const
+    -> MeshAccelerator::Pointer
+{
+    return accel_;
+}
 
 void ReorderUnorganizedTexture::setTextureMat(const cv::Mat& img)
 {
@@ -143,6 +229,16 @@ auto ReorderUnorganizedTexture::samplingMode() const -> SamplingMode
     return sampleMode_;
 }
 
+void ReorderUnorganizedTexture::setSamplingEngine(SamplingEngine e)
+{
+    sampleEngine_ = e;
+}
+
+auto ReorderUnorganizedTexture::samplingEngine() const -> SamplingEngine
+{
+    return sampleEngine_;
+}
+
 void ReorderUnorganizedTexture::setSampleRate(double s) { sampleRate_ = s; }
 
 auto ReorderUnorganizedTexture::sampleRate() const -> double
@@ -189,39 +285,18 @@ auto ReorderUnorganizedTexture::compute() -> cv::Mat
 
 void ReorderUnorganizedTexture::create_texture_()
 {
-    // Create BVH for mesh
-    std::vector<Triangle> triangles;
-    for (auto cell = inputMesh_->GetCells()->Begin();
-         cell != inputMesh_->GetCells()->End(); ++cell) {
-        auto aIdx = cell.Value()->GetPointIdsContainer()[0];
-        auto bIdx = cell.Value()->GetPointIdsContainer()[1];
-        auto cIdx = cell.Value()->GetPointIdsContainer()[2];
-
-        auto a = inputMesh_->GetPoint(aIdx);
-        auto b = inputMesh_->GetPoint(bIdx);
-        auto c = inputMesh_->GetPoint(cIdx);
-
-        // Add the face to the BVH tree
-        triangles.emplace_back(
-            Vector3(a[0], a[1], a[2]), Vector3(b[0], b[1], b[2]),
-            Vector3(c[0], c[1], c[2]));
+    // Flatten the mesh, unless a previous run already did
+    if (not accel_) {
+        accel_ = MeshAccelerator::New(inputMesh_, inputUV_);
     }
-    Bvh bvh;
-    bvh::SweepSahBuilder<Bvh> builder(bvh);
-    auto [bboxes, centers] = bvh::compute_bounding_boxes_and_centers(
-        triangles.data(), triangles.size());
-    auto meshBBox =
-        bvh::compute_bounding_boxes_union(bboxes.get(), triangles.size());
-    builder.build(meshBBox, bboxes.get(), centers.get(), triangles.size());
-    Intersector intersector(bvh, triangles.data());
-    Traverser traverser(bvh);
-
-    // Computes the OBB and returns the 3 axes relative to the box
-    auto mesh = rt::ITK2VTK(inputMesh_);
-    std::array<double, 3> size;
-    auto obbTree = vtkSmartPointer<vtkOBBTree>::New();
-    obbTree->ComputeOBB(
-        mesh, origin_.val, xAxis_.val, yAxis_.val, zAxis_.val, size.data());
+    const auto& faceUVs = accel_->faceUVs();
+
+    // Get the OBB and the 3 axes relative to the box
+    auto obb = accel_->obb();
+    origin_ = obb.origin;
+    xAxis_ = obb.xAxis;
+    yAxis_ = obb.yAxis;
+    zAxis_ = obb.zAxis;
 
     int cols{-1};
     int rows{-1};
@@ -249,8 +324,7 @@ void ReorderUnorganizedTexture::create_texture_()
             rows = static_cast<int>(sampleDim_);
             break;
         case SamplingMode::AutoUV:
-            sampleRate = ComputeUVDensity(
-                inputMesh_, inputUV_, inputTexture_.cols, inputTexture_.rows);
+            sampleRate = accel_->uvDensity(inputTexture_.size());
             cols = static_cast<int>(std::ceil(xLen / sampleRate));
             rows = static_cast<int>(std::ceil(yLen / sampleRate));
             break;
@@ -294,61 +368,130 @@ void ReorderUnorganizedTexture::create_texture_()
             break;
     }
 
-    for (auto v = 0; v < rows; v++) {
-        for (auto u = 0; u < cols; u++) {
-            // Convert pixel position to offset in mesh's XY space
-            auto uOffset = u * sampleRate * normedX;
-            auto vOffset = v * sampleRate * normedY;
-
-            // Get t
-            auto a0 = origin_ + uOffset + vOffset;
-            auto a1 = zAxis_;
-            if (not useFirstIntersection_) {
-                a0 = a0 + zAxis_ * zLen;
-                a1 *= -1;
-            }
+    // Sample from an 8UC3 texture
+    auto texture = ColorConvertImage(QuantizeImage(inputTexture_, CV_8U), 3);
+    auto maxX = texture.cols - 1;
+    auto maxY = texture.rows - 1;
+
+    // Rays start on the sampling plane and are cast along the Z axis. If we
+    // want the last intersection, cast from the other side of the box.
+    auto rayStart = origin_;
+    auto rayDir = zAxis_;
+    if (not useFirstIntersection_) {
+        rayStart += zAxis_ * zLen;
+        rayDir *= -1;
+    }
+    auto du = sampleRate * normedX;
+    auto dv = sampleRate * normedY;
+
+    // Assign the color of the point with barycentric coordinates (bu, bv) in
+    // a face to output pixel (u, v). Barycentric coordinates are relative to
+    // the 2nd pt.
+    auto shade = [&](int v, int u, std::size_t face, double bu, double bv) {
+        // Get the UV position of the intersection point
+        const auto* uvs = &faceUVs[3 * face];
+        auto bw = 1 - bu - bv;
+        auto cU = bu * uvs[1][0] + bv * uvs[2][0] + bw * uvs[0][0];
+        auto cV = bu * uvs[1][1] + bv * uvs[2][1] + bw * uvs[0][1];
+
+        // Convert the UV position to pixel coordinates (in orig image)
+        auto x = static_cast<float>(cU * maxX);
+        auto y = static_cast<float>(cV * maxY);
+
+        // Bilinear interpolate color and assign to output
+        outputTexture_.at<cv::Vec3b>(v, u) = SampleBilinear(texture, x, y);
+    };
+
+    switch (sampleEngine_) {
+        case SamplingEngine::RayCast:
+            sample_ray_cast_(rayStart, du, dv, rayDir, zLen * 2, shade);
+            break;
+        case SamplingEngine::Rasterize:
+            sample_rasterize_(rayStart, du, dv, rayDir, zLen * 2, shade);
+            break;
+    }
+}
 
-            // Intersect a ray with the data structure
-            Vector3 start(a0[0], a0[1], a0[2]);
-            Vector3 dir(a1[0], a1[1], a1[2]);
-            Ray ray(start, dir, 0.0, zLen * 2);
-            auto hit = traverser.traverse(ray, intersector);
-            if (not hit) {
-                continue;
+template <typename ShadeFn>
+void ReorderUnorganizedTexture::sample_ray_cast_(
+    const cv::Vec3d& start,
+    const cv::Vec3d& du,
+    const cv::Vec3d& dv,
+    const cv::Vec3d& dir,
+    double tMax,
+    const ShadeFn& shade)
+{
+    auto rows = outputTexture_.rows;
+    auto cols = outputTexture_.cols;
+
+    // All rays are parallel, so cast them in square packets. Each thread
+    // handles a band of packet rows.
+    const auto& caster = accel_->rayCaster(dir);
+    constexpr auto Dim = ParallelRayCaster::PacketDim;
+    auto packetRows = (rows + Dim - 1) / Dim;
+    cv::parallel_for_(cv::Range(0, packetRows), [&](const cv::Range& range) {
+        std::array<ParallelRayCaster::Hit, Dim * Dim> hits;
+        for (auto pv = range.start; pv < range.end; pv++) {
+            auto v0 = pv * Dim;
+            auto nv = std::min(Dim, rows - v0);
+            for (auto u0 = 0; u0 < cols; u0 += Dim) {
+                auto nu = std::min(Dim, cols - u0);
+                auto origin = start + u0 * du + v0 * dv;
+                caster.cast(origin, du, dv, nu, nv, tMax, hits.data());
+
+                for (auto j = 0; j < nv; j++) {
+                    auto* depthRow = outputDepthMap_.ptr<float>(v0 + j);
+                    for (auto i = 0; i < nu; i++) {
+                        const auto& hit = hits[j * Dim + i];
+                        if (hit.face == ParallelRayCaster::NoHit) {
+                            continue;
+                        }
+
+                        // Assign distance to depth map
+                        depthRow[u0 + i] = hit.distance;
+                        shade(v0 + j, u0 + i, hit.face, hit.u, hit.v);
+                    }
+                }
             }
+        }
+    });
+}
 
-            // Assign distance to depth map
-            outputDepthMap_.at<float>(v, u) =
-                static_cast<float>(hit->distance());
-
-            // Cell info
-            auto cellId = hit->primitive_index;
-
-            // Get the 2D and 3D pts
-            std::vector<cv::Vec3d> uvPts;
-            for (const auto& uv : inputUV_.getFaceUVs(cellId)) {
-                uvPts.emplace_back(uv[0], uv[1], 0.0);
+template <typename ShadeFn>
+void ReorderUnorganizedTexture::sample_rasterize_(
+    const cv::Vec3d& start,
+    const cv::Vec3d& du,
+    const cv::Vec3d& dv,
+    const cv::Vec3d& dir,
+    double tMax,
+    const ShadeFn& shade)
+{
+    // Z-buffer the mesh into the sampling plane
+    cv::Mat faceIds(outputDepthMap_.size(), CV_32SC1);
+    std::vector<ProjectedFace> faces;
+    RasterizeMesh(
+        *accel_, start, du, dv, dir, tMax, outputDepthMap_, faceIds, faces);
+
+    // Shade the covered pixels
+    cv::parallel_for_(
+        cv::Range(0, outputDepthMap_.rows), [&](const cv::Range& range) {
+            for (auto v = range.start; v < range.end; v++) {
+                auto* depthRow = outputDepthMap_.ptr<float>(v);
+                const auto* faceRow = faceIds.ptr<int>(v);
+                for (auto u = 0; u < outputDepthMap_.cols; u++) {
+                    if (faceRow[u] < 0) {
+                        depthRow[u] = 0;
+                        continue;
+                    }
+                    auto face = static_cast<std::size_t>(faceRow[u]);
+                    cv::Vec2d p{
+                        static_cast<double>(u), static_cast<double>(v)};
+                    cv::Vec3d w;
+                    FaceBarycentric(faces[face], p, w);
+                    shade(v, u, face, w[1], w[2]);
+                }
             }
-
-            // Intersection point
-            auto inter = hit->intersection;
-            cv::Vec3d bCoord{inter.u, inter.v, 1 - inter.u - inter.v};
-
-            // Get the UV position of the intersection point
-            // Inexplicably, bvh barycentric coordinates are relative to the 2nd
-            // pt?
-            auto cPoint = BaryToXYZ(bCoord, uvPts[1], uvPts[2], uvPts[0]);
-
-            // Convert the UV position to pixel coordinates (in orig image)
-            auto x = static_cast<float>(cPoint[0] * (inputTexture_.cols - 1));
-            auto y = static_cast<float>(cPoint[1] * (inputTexture_.rows - 1));
-
-            // Bilinear interpolate color and assign to output
-            cv::Mat subRect;
-            cv::getRectSubPix(inputTexture_, {1, 1}, {x, y}, subRect);
-            outputTexture_.at<cv::Vec3b>(v, u) = subRect.at<cv::Vec3b>(0, 0);
-        }  // u
-    }      // v
+        });
 }
 
 // Generate a new UV map using the aligned mesh
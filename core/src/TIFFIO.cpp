@@ -1,6 +1,15 @@
 #include "rt/io/TIFFIO.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
 #include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
+#include <vector>
 
 #include <opencv2/imgproc.hpp>
 
@@ -16,6 +25,9 @@ namespace lt
 using namespace rt;
 namespace fs = rt::filesystem;
 
+// Owning libtiff handle
+using TIFFHandle = std::unique_ptr<lt::TIFF, decltype(&lt::TIFFClose)>;
+
 // Return a CV Mat type using TIF type (signed, unsigned, float),
 // bit-depth, and number of channels
 static auto GetCVMatType(
@@ -41,93 +53,18 @@ static auto GetCVMatType(
             } else {
                 return CV_MAKETYPE(CV_32F, channels);
             }
+        case 64:
+            return CV_MAKETYPE(CV_64F, channels);
         default:
             return CV_8UC3;
     }
 }
 
-// Read a TIFF strip
-auto io::ReadRawTIFF(const fs::path& path, int offset) -> cv::Mat
+// Get the TIFF sample format and bits per sample for a CV depth
+static void GetTIFFSampleFormat(
+    int depth, int& sampleFormat, int& bitsPerSample)
 {
-    // Make sure input file exists
-    if (!fs::exists(path)) {
-        throw std::runtime_error("File does not exist");
-    }
-
-    // Setup output
-    cv::Mat output;
-
-    // Open the file read-only
-    lt::TIFF* tif = lt::TIFFOpen(path.c_str(), "r");
-    if (tif == nullptr) {
-        throw std::runtime_error("Failed to open tif");
-    }
-
-    // Get metadata
-    uint32_t width = 0;
-    uint32_t height = 0;
-    uint16_t type = 1;
-    uint16_t depth = 1;
-    uint16_t channels = 1;
-    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
-    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
-    TIFFGetField(tif, TIFFTAG_SAMPLEFORMAT, &type);
-    TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &depth);
-    TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &channels);
-    auto cvType = GetCVMatType(type, depth, channels);
-
-    // Apply offset to first strip
-    if (offset != 0) {
-        uint32_t* offsets{nullptr};
-        TIFFGetField(tif, TIFFTAG_STRIPOFFSETS, &offsets);
-        offsets[0] += offset;
-        TIFFSetField(tif, TIFFTAG_STRIPOFFSETS, offsets);
-    }
-
-    // Read only the first strip
-    uint32_t* bc{nullptr};
-    lt::tstrip_t strip = 0;
-    TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &bc);
-    uint32_t stripsize = bc[strip];
-    lt::tdata_t buf = lt::_TIFFmalloc(stripsize);
-    TIFFReadRawStrip(tif, strip, buf, bc[strip]);
-
-    // Put into the cv::Mat
-    auto h = static_cast<int>(height);
-    auto w = static_cast<int>(width);
-    output = cv::Mat(h, w, cvType, buf);
-
-    lt::_TIFFfree(buf);
-    lt::TIFFClose(tif);
-
-    return output;
-}
-
-// Write a TIFF to a file. This implementation heavily borrows from how OpenCV's
-// TIFFEncoder writes to the TIFF
-void io::WriteTIFF(const fs::path& path, const cv::Mat& img)
-{
-    // Safety checks
-    if (img.channels() < 1 or img.channels() > 4) {
-        throw std::runtime_error("Unsupported number of channels");
-    }
-
-    auto ext = path.extension().string();
-    to_upper(ext);
-    if (ext != ".TIF" && ext != ".TIFF") {
-        throw std::runtime_error("Invalid file extension " + ext);
-    }
-
-    // Image metadata
-    auto channels = img.channels();
-    auto width = static_cast<unsigned>(img.cols);
-    auto height = static_cast<unsigned>(img.rows);
-    auto rowsPerStrip = height;
-
-    // Sample format
-    int bitsPerSample{-1};
-    int sampleFormat{-1};
-    switch (img.depth()) {
+    switch (depth) {
         case CV_8U:
             sampleFormat = SAMPLEFORMAT_UINT;
             bitsPerSample = 8;
@@ -159,24 +96,508 @@ void io::WriteTIFF(const fs::path& path, const cv::Mat& img)
         default:
             throw std::runtime_error("Unsupported image depth");
     }
+}
 
-    // Photometric Interpretation
-    int photometric{-1};
+// Get the TIFF photometric interpretation for a number of channels
+static auto GetTIFFPhotometric(int channels) -> int
+{
     switch (channels) {
         case 1:
         case 2:
-            photometric = PHOTOMETRIC_MINISBLACK;
-            break;
+            return PHOTOMETRIC_MINISBLACK;
         case 3:
         case 4:
-            photometric = PHOTOMETRIC_RGB;
-            break;
+            return PHOTOMETRIC_RGB;
         default:
             throw std::runtime_error("Unsupported number of channels");
     }
+}
+
+// Get the libtiff compression scheme
+static auto GetTIFFCompression(io::TIFFCompression c) -> int
+{
+    int code{COMPRESSION_NONE};
+    switch (c) {
+        case io::TIFFCompression::None:
+            return COMPRESSION_NONE;
+        case io::TIFFCompression::LZW:
+            code = COMPRESSION_LZW;
+            break;
+        case io::TIFFCompression::Deflate:
+            code = COMPRESSION_ADOBE_DEFLATE;
+            break;
+        case io::TIFFCompression::ZSTD:
+#ifdef COMPRESSION_ZSTD
+            code = COMPRESSION_ZSTD;
+            break;
+#else
+            throw std::invalid_argument("libtiff does not support ZSTD");
+#endif
+    }
+    if (lt::TIFFIsCODECConfigured(static_cast<uint16_t>(code)) == 0) {
+        throw std::invalid_argument(
+            "Compression scheme not configured in libtiff");
+    }
+    return code;
+}
+
+// Get the libtiff predictor for an image depth
+static auto GetTIFFPredictor(io::TIFFPredictor p, int depth) -> int
+{
+    auto isFloat = depth == CV_32F or depth == CV_64F;
+    switch (p) {
+        case io::TIFFPredictor::None:
+            return PREDICTOR_NONE;
+        case io::TIFFPredictor::Horizontal:
+            if (isFloat) {
+                throw std::invalid_argument(
+                    "Horizontal predictor requires an integer image");
+            }
+            return PREDICTOR_HORIZONTAL;
+        case io::TIFFPredictor::FloatingPoint:
+            if (not isFloat) {
+                throw std::invalid_argument(
+                    "Floating point predictor requires a floating point "
+                    "image");
+            }
+            return PREDICTOR_FLOATINGPOINT;
+    }
+    return PREDICTOR_NONE;
+}
+
+// libtiff write mode for an image with the given uncompressed size. Uses
+// BigTIFF if the file might not fit in a classic TIFF's 4GB.
+static auto GetTIFFWriteMode(uint64_t bytes) -> const char*
+{
+    constexpr uint64_t BIGTIFF_THRESHOLD{3ULL << 30};
+    return bytes > BIGTIFF_THRESHOLD ? "w8" : "w";
+}
+
+// Set the pixel format and compression tags
+static void SetPixelTags(
+    lt::TIFF* tif, int type, int compression, int predictor)
+{
+    int bitsPerSample{-1};
+    int sampleFormat{-1};
+    GetTIFFSampleFormat(CV_MAT_DEPTH(type), sampleFormat, bitsPerSample);
+    auto channels = CV_MAT_CN(type);
+    lt::TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, GetTIFFPhotometric(channels));
+    lt::TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    lt::TIFFSetField(tif, TIFFTAG_COMPRESSION, compression);
+    if (compression != COMPRESSION_NONE and predictor != PREDICTOR_NONE) {
+        lt::TIFFSetField(tif, TIFFTAG_PREDICTOR, predictor);
+    }
+    lt::TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, sampleFormat);
+    lt::TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, bitsPerSample);
+    lt::TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, channels);
+
+    // Add alpha tag data
+    if (channels == 2 or channels == 4) {
+        std::array<uint16_t, 1> tag{EXTRASAMPLE_UNASSALPHA};
+        lt::TIFFSetField(tif, TIFFTAG_EXTRASAMPLES, 1, tag.data());
+    }
+}
+
+// In-memory file used to compress tiles with libtiff
+struct MemoryFile {
+    std::vector<char> data;
+    std::size_t pos{0};
+};
+
+static auto MemRead(lt::thandle_t h, lt::tdata_t buf, lt::tmsize_t size)
+    -> lt::tmsize_t
+{
+    auto* f = static_cast<MemoryFile*>(h);
+    auto avail = f->data.size() - std::min(f->pos, f->data.size());
+    auto n = std::min(static_cast<std::size_t>(size), avail);
+    std::memcpy(buf, f->data.data() + f->pos, n);
+    f->pos += n;
+    return static_cast<lt::tmsize_t>(n);
+}
+
+static auto MemWrite(lt::thandle_t h, lt::tdata_t buf, lt::tmsize_t size)
+    -> lt::tmsize_t
+{
+    auto* f = static_cast<MemoryFile*>(h);
+    auto n = static_cast<std::size_t>(size);
+    if (f->pos + n > f->data.size()) {
+        f->data.resize(f->pos + n);
+    }
+    std::memcpy(f->data.data() + f->pos, buf, n);
+    f->pos += n;
+    return size;
+}
+
+static auto MemSeek(lt::thandle_t h, lt::toff_t off, int whence) -> lt::toff_t
+{
+    auto* f = static_cast<MemoryFile*>(h);
+    switch (whence) {
+        case SEEK_SET:
+            f->pos = static_cast<std::size_t>(off);
+            break;
+        case SEEK_CUR:
+            f->pos += static_cast<std::size_t>(off);
+            break;
+        case SEEK_END:
+            f->pos = f->data.size() + static_cast<std::size_t>(off);
+            break;
+        default:
+            break;
+    }
+    return f->pos;
+}
+
+static auto MemClose(lt::thandle_t /*unused*/) -> int { return 0; }
+
+static auto MemSize(lt::thandle_t h) -> lt::toff_t
+{
+    return static_cast<MemoryFile*>(h)->data.size();
+}
+
+static auto MemMap(
+    lt::thandle_t /*unused*/, lt::tdata_t* /*unused*/, lt::toff_t* /*unused*/)
+    -> int
+{
+    return 0;
+}
+
+static void MemUnmap(
+    lt::thandle_t /*unused*/, lt::tdata_t /*unused*/, lt::toff_t /*unused*/)
+{
+}
+
+// Compress a tile by encoding it into an in-memory, single tile TIFF with
+// the same pixel and compression tags. Returns the compressed tile data.
+static auto CompressTile(
+    const cv::Mat& tile, int type, int compression, int predictor)
+    -> std::vector<char>
+{
+    MemoryFile mem;
+    std::unique_ptr<lt::TIFF, decltype(&lt::TIFFCleanup)> tif(
+        lt::TIFFClientOpen(
+            "tile", "w", &mem, MemRead, MemWrite, MemSeek, MemClose, MemSize,
+            MemMap, MemUnmap),
+        &lt::TIFFCleanup);
+    if (tif == nullptr) {
+        throw std::runtime_error("Failed to create tile encoder");
+    }
+    lt::TIFFSetField(tif.get(), TIFFTAG_IMAGEWIDTH, tile.cols);
+    lt::TIFFSetField(tif.get(), TIFFTAG_IMAGELENGTH, tile.rows);
+    lt::TIFFSetField(tif.get(), TIFFTAG_TILEWIDTH, tile.cols);
+    lt::TIFFSetField(tif.get(), TIFFTAG_TILELENGTH, tile.rows);
+    SetPixelTags(tif.get(), type, compression, predictor);
+
+    auto bytes = static_cast<lt::tmsize_t>(tile.total() * tile.elemSize());
+    if (lt::TIFFWriteEncodedTile(tif.get(), 0, tile.data, bytes) < 0) {
+        throw std::runtime_error("Failed to compress tile");
+    }
+
+    uint64_t* offsets{nullptr};
+    uint64_t* byteCounts{nullptr};
+    lt::TIFFGetField(tif.get(), TIFFTAG_TILEOFFSETS, &offsets);
+    lt::TIFFGetField(tif.get(), TIFFTAG_TILEBYTECOUNTS, &byteCounts);
+    if (offsets == nullptr or byteCounts == nullptr or
+        offsets[0] + byteCounts[0] > mem.data.size()) {
+        throw std::runtime_error("Failed to compress tile");
+    }
+    auto* begin = mem.data.data() + offsets[0];
+    return {begin, begin + byteCounts[0]};
+}
+
+// Halve an image by averaging each 2x2 block of pixels. On odd edges, only
+// the pixels inside the image are averaged.
+static auto AreaDownsample(const cv::Mat& src) -> cv::Mat
+{
+    cv::Mat padded;
+    cv::copyMakeBorder(
+        src, padded, 0, src.rows % 2, 0, src.cols % 2, cv::BORDER_REPLICATE);
+
+    // INTER_AREA does not support every depth
+    auto depth = src.depth();
+    auto supported = depth == CV_8U or depth == CV_16U or depth == CV_16S or
+                     depth == CV_32F or depth == CV_64F;
+    if (not supported) {
+        padded.convertTo(padded, CV_64F);
+    }
+
+    cv::Mat dst;
+    cv::Size half{padded.cols / 2, padded.rows / 2};
+    cv::resize(padded, dst, half, 0, 0, cv::INTER_AREA);
+    if (not supported) {
+        dst.convertTo(dst, depth);
+    }
+    return dst;
+}
+
+// Convert between OpenCV's BGR(A) order and TIFF's RGB(A) order
+static auto SwapRedBlue(const cv::Mat& img) -> cv::Mat
+{
+    cv::Mat out;
+    if (img.channels() == 3) {
+        cv::cvtColor(img, out, cv::COLOR_BGR2RGB);
+    } else if (img.channels() == 4) {
+        cv::cvtColor(img, out, cv::COLOR_BGRA2RGBA);
+    } else {
+        out = img;
+    }
+    return out;
+}
+
+// Strip layout of a TIFF read as raw binary data
+struct RawLayout {
+    cv::Size size;
+    int type{-1};
+    int rowsPerStrip{0};
+    std::vector<int64_t> offsets;
+    std::vector<uint64_t> byteCounts;
+};
+
+// Read the strip layout of a TIFF, shifting every strip offset
+static auto ReadRawLayout(const fs::path& path, int offset) -> RawLayout
+{
+    // Make sure input file exists
+    if (!fs::exists(path)) {
+        throw std::runtime_error("File does not exist");
+    }
+
+    // Open the file read-only
+    TIFFHandle tif(lt::TIFFOpen(path.c_str(), "r"), &lt::TIFFClose);
+    if (tif == nullptr) {
+        throw std::runtime_error("Failed to open tif");
+    }
+
+    // Get metadata
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint16_t type = 1;
+    uint16_t depth = 1;
+    uint16_t channels = 1;
+    uint32_t rowsPerStrip = 0;
+    lt::TIFFGetField(tif.get(), TIFFTAG_IMAGEWIDTH, &width);
+    lt::TIFFGetField(tif.get(), TIFFTAG_IMAGELENGTH, &height);
+    lt::TIFFGetField(tif.get(), TIFFTAG_SAMPLEFORMAT, &type);
+    lt::TIFFGetField(tif.get(), TIFFTAG_BITSPERSAMPLE, &depth);
+    lt::TIFFGetField(tif.get(), TIFFTAG_SAMPLESPERPIXEL, &channels);
+    lt::TIFFGetFieldDefaulted(tif.get(), TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+    rowsPerStrip = std::max(std::min(rowsPerStrip, height), 1U);
+
+    RawLayout layout;
+    layout.size = {static_cast<int>(width), static_cast<int>(height)};
+    layout.type = GetCVMatType(type, depth, channels);
+    layout.rowsPerStrip = static_cast<int>(rowsPerStrip);
+
+    // Get the strip locations. libtiff 4 reports 64-bit values for both
+    // classic and BigTIFF files.
+    uint64_t* offsets{nullptr};
+    uint64_t* byteCounts{nullptr};
+    if (lt::TIFFGetField(tif.get(), TIFFTAG_STRIPOFFSETS, &offsets) == 0 or
+        lt::TIFFGetField(tif.get(), TIFFTAG_STRIPBYTECOUNTS, &byteCounts) ==
+            0) {
+        throw std::runtime_error("Missing strip offsets");
+    }
+    auto strips = std::min<std::size_t>(
+        lt::TIFFNumberOfStrips(tif.get()),
+        (height + rowsPerStrip - 1) / rowsPerStrip);
+    for (std::size_t i = 0; i < strips; i++) {
+        layout.offsets.push_back(static_cast<int64_t>(offsets[i]) + offset);
+        layout.byteCounts.push_back(byteCounts[i]);
+    }
+    return layout;
+}
+
+// Read up to maxBytes of a raw strip into dst. Returns the number of bytes
+// read.
+static auto ReadRawStrip(
+    std::ifstream& file,
+    int64_t start,
+    uint64_t count,
+    char* dst,
+    std::size_t maxBytes) -> std::size_t
+{
+    auto bytes = std::min<uint64_t>(count, maxBytes);
+    file.clear();
+    file.seekg(start);
+    file.read(dst, static_cast<std::streamsize>(bytes));
+    return static_cast<std::size_t>(std::max<std::streamsize>(
+        file.gcount(), 0));
+}
+
+auto io::ReadRawTIFF(const fs::path& path, int offset) -> cv::Mat
+{
+    auto layout = ReadRawLayout(path, offset);
+
+    // Read each strip directly into its rows of the output image. Pixels not
+    // covered by a strip are zero.
+    cv::Mat output = cv::Mat::zeros(layout.size, layout.type);
+    auto rowBytes = static_cast<std::size_t>(output.cols) * output.elemSize();
+    std::ifstream file(path.string(), std::ios::binary);
+    std::size_t total{0};
+    for (std::size_t i = 0; i < layout.offsets.size(); i++) {
+        auto row = static_cast<int>(i) * layout.rowsPerStrip;
+        auto rows = std::min(layout.rowsPerStrip, output.rows - row);
+        total += ReadRawStrip(
+            file, layout.offsets[i], layout.byteCounts[i],
+            reinterpret_cast<char*>(output.ptr(row)), rows * rowBytes);
+    }
+    if (total == 0) {
+        throw std::runtime_error("Failed to read strip");
+    }
+
+    return output;
+}
+
+void io::ConvertRawTIFF(
+    const fs::path& input,
+    const fs::path& output,
+    int offset,
+    TIFFCompression compression,
+    TIFFPredictor predictor)
+{
+    auto layout = ReadRawLayout(input, offset);
+    auto ext = output.extension().string();
+    to_upper(ext);
+    if (ext != ".TIF" && ext != ".TIFF") {
+        throw std::invalid_argument("Invalid file extension " + ext);
+    }
+    auto channels = CV_MAT_CN(layout.type);
+    if (channels < 1 or channels > 4) {
+        throw std::runtime_error("Unsupported number of channels");
+    }
+    auto tiffCompression = GetTIFFCompression(compression);
+    auto tiffPredictor = GetTIFFPredictor(predictor, CV_MAT_DEPTH(layout.type));
+
+    auto rowBytes = static_cast<std::size_t>(layout.size.width) *
+                    CV_ELEM_SIZE(layout.type);
+    auto bytes = static_cast<uint64_t>(rowBytes) * layout.size.height;
+    const auto* mode = GetTIFFWriteMode(bytes);
+
+    TIFFHandle out(lt::TIFFOpen(output.c_str(), mode), &lt::TIFFClose);
+    if (out == nullptr) {
+        throw std::runtime_error("Failed to open file for writing");
+    }
+    lt::TIFFSetField(out.get(), TIFFTAG_IMAGEWIDTH, layout.size.width);
+    lt::TIFFSetField(out.get(), TIFFTAG_IMAGELENGTH, layout.size.height);
+    lt::TIFFSetField(out.get(), TIFFTAG_ROWSPERSTRIP, layout.rowsPerStrip);
+    SetPixelTags(out.get(), layout.type, tiffCompression, tiffPredictor);
+    lt::TIFFSetField(
+        out.get(), TIFFTAG_SOFTWARE, ProjectInfo::NameAndVersion().c_str());
+
+    // Stream each strip from the input to the encoder. Raw strips are
+    // already in the file's sample order, so no channel swap is needed.
+    auto strips = static_cast<std::size_t>(
+        (layout.size.height + layout.rowsPerStrip - 1) / layout.rowsPerStrip);
+    std::vector<char> buffer(rowBytes * layout.rowsPerStrip);
+    std::ifstream file(input.string(), std::ios::binary);
+    std::size_t total{0};
+    for (std::size_t i = 0; i < strips; i++) {
+        auto row = static_cast<int>(i) * layout.rowsPerStrip;
+        auto rows = std::min(layout.rowsPerStrip, layout.size.height - row);
+        auto stripBytes = rows * rowBytes;
+        std::fill(buffer.begin(), buffer.end(), 0);
+        if (i < layout.offsets.size()) {
+            total += ReadRawStrip(
+                file, layout.offsets[i], layout.byteCounts[i], buffer.data(),
+                stripBytes);
+        }
+        auto idx = static_cast<uint32_t>(i);
+        auto size = static_cast<lt::tmsize_t>(stripBytes);
+        if (lt::TIFFWriteEncodedStrip(out.get(), idx, buffer.data(), size) <
+            0) {
+            throw std::runtime_error(
+                "Failed to write strip " + std::to_string(i));
+        }
+    }
+    if (total == 0) {
+        throw std::runtime_error("Failed to read strip");
+    }
+}
+
+// Write a TIFF to a file. This implementation heavily borrows from how OpenCV's
+// TIFFEncoder writes to the TIFF
+void io::WriteTIFF(
+    const fs::path& path, const cv::Mat& img, const TIFFWriteOptions& options)
+{
+    // Safety checks
+    if (img.channels() < 1 or img.channels() > 4) {
+        throw std::runtime_error("Unsupported number of channels");
+    }
+
+    auto ext = path.extension().string();
+    to_upper(ext);
+    if (ext != ".TIF" && ext != ".TIFF") {
+        throw std::runtime_error("Invalid file extension " + ext);
+    }
+
+    if (options.pyramidLevels < 0) {
+        throw std::invalid_argument("Pyramid levels must be non-negative");
+    }
+
+    // Write tiles in parallel. Each tile is also downsampled into the next
+    // pyramid level, which is written after the current level.
+    if (options.tiled or options.pyramidLevels > 0) {
+        auto levels = static_cast<std::size_t>(options.pyramidLevels);
+        TIFFTileWriter writer(
+            path, img.size(), img.type(), options.tileSize,
+            options.compression, options.predictor, levels);
+        const auto& ts = options.tileSize;
+        auto level = img;
+        for (std::size_t l = 0; l <= levels; l++) {
+            cv::Rect bounds{{0, 0}, level.size()};
+            std::vector<cv::Rect> tiles;
+            for (int y = 0; y < level.rows; y += ts.height) {
+                for (int x = 0; x < level.cols; x += ts.width) {
+                    tiles.emplace_back(cv::Rect{{x, y}, ts} & bounds);
+                }
+            }
+
+            // Tile origins are even, so each tile maps to a disjoint region
+            // of the next level
+            cv::Mat next;
+            if (l < levels) {
+                cv::Size half{(level.cols + 1) / 2, (level.rows + 1) / 2};
+                next = cv::Mat(half, level.type());
+            }
+            std::vector<std::exception_ptr> errors(tiles.size());
+            auto range = cv::Range(0, static_cast<int>(tiles.size()));
+            cv::parallel_for_(range, [&](const cv::Range& r) {
+                for (auto i = r.start; i < r.end; i++) {
+                    try {
+                        const auto& t = tiles[i];
+                        writer.writeTile(level(t), t.tl());
+                        if (not next.empty()) {
+                            auto reduced = AreaDownsample(level(t));
+                            cv::Rect dst{{t.x / 2, t.y / 2}, reduced.size()};
+                            reduced.copyTo(next(dst));
+                        }
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+                }
+            });
+            for (const auto& e : errors) {
+                if (e) {
+                    std::rethrow_exception(e);
+                }
+            }
+            if (l < levels) {
+                writer.startSubIFD();
+                level = next;
+            }
+        }
+        writer.close();
+        return;
+    }
+
+    // Image metadata
+    auto width = static_cast<unsigned>(img.cols);
+    auto height = static_cast<unsigned>(img.rows);
+    auto rowsPerStrip = height;
+    auto compression = GetTIFFCompression(options.compression);
+    auto predictor = GetTIFFPredictor(options.predictor, img.depth());
 
     // Open the file
-    auto* out = lt::TIFFOpen(path.c_str(), "w");
+    auto bytes = static_cast<uint64_t>(img.total()) * img.elemSize();
+    auto* out = lt::TIFFOpen(path.c_str(), GetTIFFWriteMode(bytes));
     if (out == nullptr) {
         throw std::runtime_error("Failed to open file for writing");
     }
@@ -184,21 +605,10 @@ void io::WriteTIFF(const fs::path& path, const cv::Mat& img)
     // Encoding parameters
     lt::TIFFSetField(out, TIFFTAG_IMAGEWIDTH, width);
     lt::TIFFSetField(out, TIFFTAG_IMAGELENGTH, height);
-    lt::TIFFSetField(out, TIFFTAG_PHOTOMETRIC, photometric);
-    lt::TIFFSetField(out, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-    lt::TIFFSetField(out, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
-    lt::TIFFSetField(out, TIFFTAG_SAMPLEFORMAT, sampleFormat);
-    lt::TIFFSetField(out, TIFFTAG_BITSPERSAMPLE, bitsPerSample);
-    lt::TIFFSetField(out, TIFFTAG_SAMPLESPERPIXEL, channels);
     lt::TIFFSetField(out, TIFFTAG_ROWSPERSTRIP, rowsPerStrip);
-
-    // Add alpha tag data
-    // TODO: Let user decide associated/unassociated tag
+    // TODO: Let user decide associated/unassociated alpha tag
     // See TIFF 6.0 spec, section 18
-    if (channels == 2 or channels == 4) {
-        std::array<uint16_t, 1> tag{EXTRASAMPLE_UNASSALPHA};
-        lt::TIFFSetField(out, TIFFTAG_EXTRASAMPLES, 1, tag.data());
-    }
+    SetPixelTags(out, img.type(), compression, predictor);
 
     // Metadata
     lt::TIFFSetField(
@@ -210,14 +620,7 @@ void io::WriteTIFF(const fs::path& path, const cv::Mat& img)
     std::vector<char> buffer(bufferSize + 32);
 
     // Get working copy with converted channels if an RGB-type image
-    cv::Mat imgCopy;
-    if (img.channels() == 3) {
-        cv::cvtColor(img, imgCopy, cv::COLOR_BGR2RGB);
-    } else if (img.channels() == 4) {
-        cv::cvtColor(img, imgCopy, cv::COLOR_BGRA2RGBA);
-    } else {
-        imgCopy = img;
-    }
+    auto imgCopy = SwapRedBlue(img);
 
     // For each row
     for (unsigned row = 0; row < height; row++) {
@@ -232,4 +635,496 @@ void io::WriteTIFF(const fs::path& path, const cv::Mat& img)
 
     // Close the tiff
     lt::TIFFClose(out);
-}
\ No newline at end of file
+}
+
+// Open a TIFF for reading and get its header
+static auto OpenTIFF(
+    const fs::path& path, io::TIFFHeader& header, std::size_t level = 0)
+    -> TIFFHandle
+{
+    // Make sure input file exists
+    if (!fs::exists(path)) {
+        throw std::runtime_error("File does not exist");
+    }
+
+    TIFFHandle tif(lt::TIFFOpen(path.c_str(), "r"), &lt::TIFFClose);
+    if (tif == nullptr) {
+        throw std::runtime_error("Failed to open tif");
+    }
+
+    // Select a reduced-resolution subIFD
+    uint16_t numSubIFDs{0};
+    uint64_t* subIFDs{nullptr};
+    if (lt::TIFFGetField(tif.get(), TIFFTAG_SUBIFD, &numSubIFDs, &subIFDs) ==
+        0) {
+        numSubIFDs = 0;
+    }
+    header.subIFDs = numSubIFDs;
+    if (level > 0) {
+        if (level > numSubIFDs) {
+            throw std::runtime_error(
+                "TIFF does not have subIFD " + std::to_string(level));
+        }
+        auto offset = subIFDs[level - 1];
+        if (lt::TIFFSetSubDirectory(tif.get(), offset) == 0) {
+            throw std::runtime_error(
+                "Failed to read subIFD " + std::to_string(level));
+        }
+    }
+
+    // Get metadata
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint16_t type = SAMPLEFORMAT_UINT;
+    uint16_t depth = 1;
+    uint16_t channels = 1;
+    uint16_t planar = PLANARCONFIG_CONTIG;
+    uint16_t photometric = PHOTOMETRIC_MINISBLACK;
+    uint16_t compression = COMPRESSION_NONE;
+    lt::TIFFGetField(tif.get(), TIFFTAG_IMAGEWIDTH, &width);
+    lt::TIFFGetField(tif.get(), TIFFTAG_IMAGELENGTH, &height);
+    lt::TIFFGetFieldDefaulted(tif.get(), TIFFTAG_SAMPLEFORMAT, &type);
+    lt::TIFFGetFieldDefaulted(tif.get(), TIFFTAG_BITSPERSAMPLE, &depth);
+    lt::TIFFGetFieldDefaulted(tif.get(), TIFFTAG_SAMPLESPERPIXEL, &channels);
+    lt::TIFFGetFieldDefaulted(tif.get(), TIFFTAG_PLANARCONFIG, &planar);
+    lt::TIFFGetField(tif.get(), TIFFTAG_PHOTOMETRIC, &photometric);
+    lt::TIFFGetFieldDefaulted(tif.get(), TIFFTAG_COMPRESSION, &compression);
+
+    if (channels < 1 or channels > 4) {
+        throw std::runtime_error("Unsupported number of channels");
+    }
+    if (depth != 8 and depth != 16 and depth != 32 and depth != 64) {
+        throw std::runtime_error("Unsupported bit depth");
+    }
+    if (planar != PLANARCONFIG_CONTIG) {
+        throw std::runtime_error("Unsupported planar configuration");
+    }
+    // Samples are returned as stored, so only accept interpretations which
+    // need no conversion. libtiff converts JPEG-compressed YCbCr below.
+    auto jpegYCbCr = compression == COMPRESSION_JPEG and
+                     photometric == PHOTOMETRIC_YCBCR;
+    if (photometric != PHOTOMETRIC_MINISBLACK and
+        photometric != PHOTOMETRIC_RGB and not jpegYCbCr) {
+        throw std::runtime_error("Unsupported photometric interpretation");
+    }
+
+    // Have libtiff convert JPEG-compressed YCbCr to RGB
+    if (jpegYCbCr) {
+        lt::TIFFSetField(tif.get(), TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB);
+    }
+
+    header.size = {static_cast<int>(width), static_cast<int>(height)};
+    header.type = GetCVMatType(type, depth, channels);
+    header.tiled = lt::TIFFIsTiled(tif.get()) != 0;
+    header.bigTIFF = lt::TIFFIsBigTIFF(tif.get()) != 0;
+    if (header.tiled) {
+        uint32_t tw{0};
+        uint32_t th{0};
+        lt::TIFFGetField(tif.get(), TIFFTAG_TILEWIDTH, &tw);
+        lt::TIFFGetField(tif.get(), TIFFTAG_TILELENGTH, &th);
+        header.chunkSize = {static_cast<int>(tw), static_cast<int>(th)};
+    } else {
+        uint32_t rps{0};
+        lt::TIFFGetFieldDefaulted(tif.get(), TIFFTAG_ROWSPERSTRIP, &rps);
+        rps = std::min(rps, height);
+        header.chunkSize = {static_cast<int>(width), static_cast<int>(rps)};
+    }
+    if (header.chunkSize.width <= 0 or header.chunkSize.height <= 0) {
+        throw std::runtime_error("Invalid strip or tile size");
+    }
+    return tif;
+}
+
+// Copy the part of a decoded strip or tile which overlaps the output region
+static void CopyChunk(
+    const char* chunk,
+    const cv::Rect& chunkRect,
+    std::size_t chunkStride,
+    const cv::Rect& roi,
+    cv::Mat& out)
+{
+    auto overlap = chunkRect & roi;
+    auto elemSize = out.elemSize();
+    auto bytes = static_cast<std::size_t>(overlap.width) * elemSize;
+    for (auto y = overlap.y; y < overlap.br().y; y++) {
+        const auto* src = chunk + (y - chunkRect.y) * chunkStride +
+                          (overlap.x - chunkRect.x) * elemSize;
+        auto* dst = out.ptr(y - roi.y) + (overlap.x - roi.x) * elemSize;
+        std::memcpy(dst, src, bytes);
+    }
+}
+
+auto io::ReadTIFFHeader(const fs::path& path, std::size_t level)
+    -> TIFFHeader
+{
+    TIFFHeader header;
+    OpenTIFF(path, header, level);
+    return header;
+}
+
+// A strip or tile and the image region it covers
+struct Chunk {
+    uint32_t index;
+    cv::Rect rect;
+};
+
+// Size in bytes of a decoded strip or tile
+static auto ChunkBytes(lt::TIFF* tif, bool tiled) -> std::size_t
+{
+    auto size = tiled ? lt::TIFFTileSize(tif) : lt::TIFFStripSize(tif);
+    return static_cast<std::size_t>(size);
+}
+
+// Decode a single strip or tile into buffer
+static void DecodeChunk(
+    lt::TIFF* tif, bool tiled, uint32_t index, std::vector<char>& buffer)
+{
+    if (tiled) {
+        if (lt::TIFFReadEncodedTile(tif, index, buffer.data(), -1) < 0) {
+            throw std::runtime_error(
+                "Failed to read tile " + std::to_string(index));
+        }
+    } else {
+        if (lt::TIFFReadEncodedStrip(tif, index, buffer.data(), -1) < 0) {
+            throw std::runtime_error(
+                "Failed to read strip " + std::to_string(index));
+        }
+    }
+}
+
+// Decode a range of chunks with one handle
+static void DecodeChunks(
+    lt::TIFF* tif,
+    bool tiled,
+    const Chunk* begin,
+    const Chunk* end,
+    std::size_t stride,
+    const cv::Rect& roi,
+    cv::Mat& out)
+{
+    std::vector<char> buffer(ChunkBytes(tif, tiled));
+    for (const auto* c = begin; c != end; c++) {
+        DecodeChunk(tif, tiled, c->index, buffer);
+        CopyChunk(buffer.data(), c->rect, stride, roi, out);
+    }
+}
+
+// List every strip or tile which overlaps a region inside the image. Sets
+// stride to the row stride of a decoded chunk.
+static auto ListChunks(
+    lt::TIFF* tif,
+    const io::TIFFHeader& header,
+    const cv::Rect& roi,
+    std::size_t& stride) -> std::vector<Chunk>
+{
+    if (roi.empty() or (roi & cv::Rect({0, 0}, header.size)) != roi) {
+        throw std::runtime_error("Region is not inside the image");
+    }
+
+    std::vector<Chunk> chunks;
+    const auto& cs = header.chunkSize;
+    if (header.tiled) {
+        stride = static_cast<std::size_t>(cs.width) *
+                 static_cast<std::size_t>(CV_ELEM_SIZE(header.type));
+        for (auto y = roi.y / cs.height * cs.height; y < roi.br().y;
+             y += cs.height) {
+            for (auto x = roi.x / cs.width * cs.width; x < roi.br().x;
+                 x += cs.width) {
+                auto tile = lt::TIFFComputeTile(tif, x, y, 0, 0);
+                chunks.push_back({tile, {x, y, cs.width, cs.height}});
+            }
+        }
+    } else {
+        stride = static_cast<std::size_t>(lt::TIFFScanlineSize(tif));
+        auto first = roi.y / cs.height * cs.height;
+        for (auto y = first; y < roi.br().y; y += cs.height) {
+            auto strip = lt::TIFFComputeStrip(tif, y, 0);
+            auto rows = std::min(cs.height, header.size.height - y);
+            chunks.push_back({strip, {0, y, header.size.width, rows}});
+        }
+    }
+    return chunks;
+}
+
+auto io::ReadTIFFRegion(
+    const fs::path& path, const cv::Rect& roi, std::size_t level) -> cv::Mat
+{
+    TIFFHeader header;
+    auto tif = OpenTIFF(path, header, level);
+
+    // List every strip or tile which overlaps the region
+    std::size_t stride{0};
+    auto chunks = ListChunks(tif.get(), header, roi, stride);
+    cv::Mat output(roi.size(), header.type);
+
+    // Decode the chunks in parallel, in contiguous groups. libtiff handles
+    // are not thread safe, so each group opens its own handle. Groups write
+    // to disjoint parts of the output.
+    auto groups = std::min<std::size_t>(
+        chunks.size(), std::max(1, cv::getNumThreads()));
+    if (groups <= 1) {
+        DecodeChunks(
+            tif.get(), header.tiled, chunks.data(),
+            chunks.data() + chunks.size(), stride, roi, output);
+    } else {
+        tif.reset();
+        auto groupBegin = [&](std::size_t g) {
+            return chunks.data() + g * chunks.size() / groups;
+        };
+        std::vector<std::exception_ptr> errors(groups);
+        auto decodeGroups = [&](const cv::Range& r) {
+            for (auto g = r.start; g < r.end; g++) {
+                auto idx = static_cast<std::size_t>(g);
+                try {
+                    TIFFHeader h;
+                    auto handle = OpenTIFF(path, h, level);
+                    DecodeChunks(
+                        handle.get(), header.tiled, groupBegin(idx),
+                        groupBegin(idx + 1), stride, roi, output);
+                } catch (...) {
+                    errors[idx] = std::current_exception();
+                }
+            }
+        };
+        auto range = cv::Range(0, static_cast<int>(groups));
+        cv::parallel_for_(range, decodeGroups, static_cast<double>(groups));
+        for (const auto& e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+
+    // RGB -> BGR
+    return SwapRedBlue(output);
+}
+
+auto io::ReadTIFF(const fs::path& path, std::size_t level) -> cv::Mat
+{
+    auto header = ReadTIFFHeader(path, level);
+    return ReadTIFFRegion(path, {{0, 0}, header.size}, level);
+}
+
+io::TIFFRegionReader::TIFFRegionReader(
+    const fs::path& path, std::size_t level)
+    : path_{path}, level_{level}
+{
+    OpenTIFF(path_, header_, level_);
+}
+
+auto io::TIFFRegionReader::header() const -> const TIFFHeader&
+{
+    return header_;
+}
+
+auto io::TIFFRegionReader::read(const cv::Rect& roi) -> cv::Mat
+{
+    TIFFHeader h;
+    auto tif = OpenTIFF(path_, h, level_);
+    std::size_t stride{0};
+    auto chunks = ListChunks(tif.get(), header_, roi, stride);
+
+    cv::Mat output(roi.size(), header_.type);
+    for (const auto& c : chunks) {
+        auto decoded = chunk_(tif.get(), c.index);
+        CopyChunk(decoded->data(), c.rect, stride, roi, output);
+    }
+
+    // RGB -> BGR
+    return SwapRedBlue(output);
+}
+
+void io::TIFFRegionReader::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.clear();
+}
+
+auto io::TIFFRegionReader::chunksDecoded() const -> std::size_t
+{
+    return decoded_;
+}
+
+auto io::TIFFRegionReader::chunk_(void* tif, std::uint32_t index) -> Buffer
+{
+    // Claim the chunk, or wait for the thread which already claimed it
+    std::promise<Buffer> promise;
+    std::shared_future<Buffer> future;
+    bool claimed{false};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(index);
+        if (it == cache_.end()) {
+            future = promise.get_future().share();
+            cache_.emplace(index, future);
+            claimed = true;
+        } else {
+            future = it->second;
+        }
+    }
+
+    if (claimed) {
+        try {
+            auto* t = static_cast<lt::TIFF*>(tif);
+            auto bytes = ChunkBytes(t, header_.tiled);
+            auto buffer = std::make_shared<std::vector<char>>(bytes);
+            DecodeChunk(t, header_.tiled, index, *buffer);
+            decoded_++;
+            promise.set_value(buffer);
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    }
+    return future.get();
+}
+
+io::TIFFTileWriter::TIFFTileWriter(
+    const fs::path& path,
+    const cv::Size& size,
+    int type,
+    const cv::Size& tileSize,
+    TIFFCompression compression,
+    TIFFPredictor predictor,
+    std::size_t subIFDs)
+    : size_{size}
+    , type_{type}
+    , tileSize_{tileSize}
+    , compression_{GetTIFFCompression(compression)}
+    , predictor_{GetTIFFPredictor(predictor, CV_MAT_DEPTH(type))}
+    , subIFDs_{subIFDs}
+{
+    // Safety checks
+    auto channels = CV_MAT_CN(type);
+    if (channels < 1 or channels > 4) {
+        throw std::invalid_argument("Unsupported number of channels");
+    }
+    if (tileSize.width <= 0 or tileSize.height <= 0 or
+        tileSize.width % 16 != 0 or tileSize.height % 16 != 0) {
+        throw std::invalid_argument("Tile size must be a multiple of 16");
+    }
+    if (subIFDs > std::numeric_limits<uint16_t>::max()) {
+        throw std::invalid_argument("Too many subIFDs");
+    }
+
+    auto ext = path.extension().string();
+    to_upper(ext);
+    if (ext != ".TIF" && ext != ".TIFF") {
+        throw std::invalid_argument("Invalid file extension " + ext);
+    }
+
+    // Pyramid levels add up to a third of the full image size
+    auto bytes = static_cast<uint64_t>(size.width) *
+                 static_cast<uint64_t>(size.height) * CV_ELEM_SIZE(type);
+    if (subIFDs > 0) {
+        bytes += bytes / 3;
+    }
+
+    auto* out = lt::TIFFOpen(path.c_str(), GetTIFFWriteMode(bytes));
+    if (out == nullptr) {
+        throw std::runtime_error("Failed to open file for writing");
+    }
+    tif_ = out;
+    setTags_();
+
+    // The next subIFDs directories written are linked from this one
+    if (subIFDs > 0) {
+        std::vector<uint64_t> offsets(subIFDs, 0);
+        lt::TIFFSetField(
+            out, TIFFTAG_SUBIFD, static_cast<uint16_t>(subIFDs),
+            offsets.data());
+    }
+}
+
+void io::TIFFTileWriter::setTags_()
+{
+    auto* out = static_cast<lt::TIFF*>(tif_);
+
+    // Encoding parameters
+    lt::TIFFSetField(out, TIFFTAG_IMAGEWIDTH, size_.width);
+    lt::TIFFSetField(out, TIFFTAG_IMAGELENGTH, size_.height);
+    lt::TIFFSetField(out, TIFFTAG_TILEWIDTH, tileSize_.width);
+    lt::TIFFSetField(out, TIFFTAG_TILELENGTH, tileSize_.height);
+    SetPixelTags(out, type_, compression_, predictor_);
+
+    // Metadata
+    lt::TIFFSetField(
+        out, TIFFTAG_SOFTWARE, ProjectInfo::NameAndVersion().c_str());
+}
+
+io::TIFFTileWriter::~TIFFTileWriter() { close(); }
+
+auto io::TIFFTileWriter::size() const -> cv::Size { return size_; }
+
+auto io::TIFFTileWriter::tileSize() const -> cv::Size { return tileSize_; }
+
+void io::TIFFTileWriter::writeTile(const cv::Mat& tile, const cv::Point& origin)
+{
+    if (tile.type() != type_) {
+        throw std::invalid_argument("Tile type does not match image type");
+    }
+    if (origin.x < 0 or origin.y < 0 or origin.x % tileSize_.width != 0 or
+        origin.y % tileSize_.height != 0) {
+        throw std::invalid_argument("Tile origin is not on the tile grid");
+    }
+    cv::Rect expected{origin, tileSize_};
+    expected &= cv::Rect({0, 0}, size_);
+    if (expected.size() != tile.size()) {
+        throw std::invalid_argument("Tile size does not match the tile grid");
+    }
+
+    // Edge tiles are padded to the full tile size
+    cv::Mat buffer;
+    if (tile.size() == tileSize_) {
+        buffer = SwapRedBlue(tile);
+    } else {
+        buffer = cv::Mat::zeros(tileSize_, type_);
+        tile.copyTo(buffer(cv::Rect({0, 0}, tile.size())));
+        buffer = SwapRedBlue(buffer);
+    }
+    // libtiff's predictors may modify the buffer in place
+    if (not buffer.isContinuous() or buffer.data == tile.data) {
+        buffer = buffer.clone();
+    }
+
+    // Compress on this thread, then write
+    auto data = CompressTile(buffer, type_, compression_, predictor_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tif_ == nullptr) {
+        throw std::runtime_error("TIFF is not open for writing");
+    }
+    auto* out = static_cast<lt::TIFF*>(tif_);
+    auto idx = lt::TIFFComputeTile(out, origin.x, origin.y, 0, 0);
+    auto bytes = static_cast<lt::tmsize_t>(data.size());
+    if (lt::TIFFWriteRawTile(out, idx, data.data(), bytes) < 0) {
+        throw std::runtime_error("Failed to write tile " + std::to_string(idx));
+    }
+}
+
+void io::TIFFTileWriter::startSubIFD()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tif_ == nullptr) {
+        throw std::runtime_error("TIFF is not open for writing");
+    }
+    if (level_ >= subIFDs_) {
+        throw std::runtime_error("All subIFDs have already been started");
+    }
+
+    auto* out = static_cast<lt::TIFF*>(tif_);
+    if (lt::TIFFWriteDirectory(out) == 0) {
+        throw std::runtime_error("Failed to write TIFF directory");
+    }
+    level_++;
+    size_ = {(size_.width + 1) / 2, (size_.height + 1) / 2};
+    setTags_();
+    lt::TIFFSetField(out, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
+}
+
+void io::TIFFTileWriter::close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tif_ != nullptr) {
+        lt::TIFFClose(static_cast<lt::TIFF*>(tif_));
+        tif_ = nullptr;
+    }
+}
@@ -0,0 +1,364 @@
+#include "rt/TransformMapper.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <itkBSplineTransform.h>
+#include <itkIdentityTransform.h>
+#include <itkMatrixOffsetTransformBase.h>
+#include <opencv2/core/hal/intrin.hpp>
+
+using namespace rt;
+
+using BSpline = itk::BSplineTransform<double, 2, 3>;
+using MatrixOffset = itk::MatrixOffsetTransformBase<double, 2, 2>;
+using Identity = itk::IdentityTransform<double, 2>;
+
+namespace
+{
+// A single native evaluation step
+struct Stage {
+    enum class Kind { Affine, BSpline };
+    Kind kind{Kind::Affine};
+
+    // Affine: row-major matrix and offset
+    double matrix[4]{1, 0, 0, 1};
+    double offset[2]{0, 0};
+
+    // B-spline: coefficient grid and physical point to index mapping
+    const double* coeffs[2]{nullptr, nullptr};
+    long gridSize[2]{0, 0};
+    long gridStart[2]{0, 0};
+    double origin[2]{0, 0};
+    double toIndex[4]{1, 0, 0, 1};
+};
+
+// Cubic B-spline kernel, as in itk::BSplineKernelFunction<3>
+inline auto CubicKernel(double u) -> double
+{
+    const auto a = std::abs(u);
+    const auto s = u * u;
+    if (a < 1.0) {
+        return (4.0 - 6.0 * s + 3.0 * s * a) / 6.0;
+    }
+    if (a < 2.0) {
+        return (8.0 - 12.0 * a + 6.0 * s - s * a) / 6.0;
+    }
+    return 0.0;
+}
+
+// Support start and 1D weights for a continuous grid index, as in
+// itk::BSplineInterpolationWeightFunction
+inline void CubicWeights(double c, long& start, double* w)
+{
+    start = static_cast<long>(std::floor(c - 1.0));
+    auto x = c - static_cast<double>(start);
+    for (int k = 0; k < 4; k++) {
+        w[k] = CubicKernel(x);
+        x -= 1.0;
+    }
+}
+
+// Whether a continuous grid index has full support, as in
+// itk::BSplineTransform::InsideValidRegion
+inline auto InsideGrid(double c, long size) -> bool
+{
+    return c >= 1.0 and c < static_cast<double>(size) - 1.0 - 1.0;
+}
+
+// Correlate the 4x4 coefficient support with the separable weights
+inline void Correlate(
+    const Stage& s,
+    long sx,
+    long sy,
+    const double* wx,
+    const double* wy,
+    double& dx,
+    double& dy)
+{
+    dx = 0.0;
+    dy = 0.0;
+    for (int ky = 0; ky < 4; ky++) {
+        auto row = (sy + ky - s.gridStart[1]) * s.gridSize[0] + sx -
+                   s.gridStart[0];
+        for (int kx = 0; kx < 4; kx++) {
+            auto w = wx[kx] * wy[ky];
+            dx += w * s.coeffs[0][row + kx];
+            dy += w * s.coeffs[1][row + kx];
+        }
+    }
+}
+
+// Apply an affine stage in place. Pairs of points are evaluated with
+// OpenCV's universal intrinsics, using the same operation order as the scalar
+// loop. This file is built without FMA contraction so both loops round alike.
+// Results can still differ from ITK's in the last bits.
+void ApplyAffine(const Stage& s, double* xs, double* ys, int n)
+{
+    const auto* m = s.matrix;
+    int i{0};
+#if CV_SIMD128_64F
+    const auto m0 = cv::v_setall_f64(m[0]);
+    const auto m1 = cv::v_setall_f64(m[1]);
+    const auto m2 = cv::v_setall_f64(m[2]);
+    const auto m3 = cv::v_setall_f64(m[3]);
+    const auto o0 = cv::v_setall_f64(s.offset[0]);
+    const auto o1 = cv::v_setall_f64(s.offset[1]);
+    constexpr int step = cv::v_float64x2::nlanes;
+    for (; i + step <= n; i += step) {
+        auto x = cv::v_load(xs + i);
+        auto y = cv::v_load(ys + i);
+        auto ox = m0 * x + m1 * y;
+        auto oy = m2 * x + m3 * y;
+        cv::v_store(xs + i, ox + o0);
+        cv::v_store(ys + i, oy + o1);
+    }
+#endif
+    for (; i < n; i++) {
+        auto x = xs[i];
+        auto y = ys[i];
+        auto ox = 0.0;
+        ox += m[0] * x;
+        ox += m[1] * y;
+        auto oy = 0.0;
+        oy += m[2] * x;
+        oy += m[3] * y;
+        xs[i] = ox + s.offset[0];
+        ys[i] = oy + s.offset[1];
+    }
+}
+
+// Apply a B-spline stage in place, evaluating the weights at every point
+void ApplyBSpline(const Stage& s, double* xs, double* ys, int n)
+{
+    const auto* m = s.toIndex;
+    for (int i = 0; i < n; i++) {
+        auto px = xs[i] - s.origin[0];
+        auto py = ys[i] - s.origin[1];
+        auto cx = 0.0;
+        cx += m[0] * px;
+        cx += m[1] * py;
+        auto cy = 0.0;
+        cy += m[2] * px;
+        cy += m[3] * py;
+        if (not InsideGrid(cx, s.gridSize[0]) or
+            not InsideGrid(cy, s.gridSize[1])) {
+            continue;
+        }
+
+        long sx{0};
+        long sy{0};
+        double wx[4];
+        double wy[4];
+        CubicWeights(cx, sx, wx);
+        CubicWeights(cy, sy, wy);
+
+        double dx{0};
+        double dy{0};
+        Correlate(s, sx, sy, wx, wy, dx, dy);
+        xs[i] = dx + xs[i];
+        ys[i] = dy + ys[i];
+    }
+}
+
+// Flatten a transform into native stages in the order they are applied.
+// Returns false if any transform is unsupported.
+auto CollectStages(const Transform* t, std::vector<Stage>& stages) -> bool
+{
+    if (t == nullptr) {
+        return false;
+    }
+
+    // CompositeTransform applies its last transform first
+    if (const auto* c = dynamic_cast<const CompositeTransform*>(t)) {
+        for (auto i = c->GetNumberOfTransforms(); i > 0; i--) {
+            const auto* sub = c->GetNthTransformConstPointer(i - 1);
+            if (not CollectStages(sub, stages)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (dynamic_cast<const Identity*>(t) != nullptr) {
+        return true;
+    }
+
+    if (const auto* a = dynamic_cast<const MatrixOffset*>(t)) {
+        Stage s;
+        s.kind = Stage::Kind::Affine;
+        const auto& m = a->GetMatrix();
+        const auto& o = a->GetOffset();
+        s.matrix[0] = m(0, 0);
+        s.matrix[1] = m(0, 1);
+        s.matrix[2] = m(1, 0);
+        s.matrix[3] = m(1, 1);
+        s.offset[0] = o[0];
+        s.offset[1] = o[1];
+        stages.push_back(s);
+        return true;
+    }
+
+    if (const auto* b = dynamic_cast<const BSpline*>(t)) {
+        const auto& imgs = b->GetCoefficientImages();
+        // ITK returns the input point if there are no coefficients
+        if (imgs[0]->GetBufferPointer() == nullptr) {
+            return true;
+        }
+        Stage s;
+        s.kind = Stage::Kind::BSpline;
+        const auto& region = imgs[0]->GetBufferedRegion();
+        const auto& origin = imgs[0]->GetOrigin();
+        const auto& toIndex = imgs[0]->GetPhysicalPointToIndexMatrix();
+        for (int d = 0; d < 2; d++) {
+            s.coeffs[d] = imgs[d]->GetBufferPointer();
+            s.gridSize[d] = static_cast<long>(region.GetSize()[d]);
+            s.gridStart[d] = static_cast<long>(region.GetIndex()[d]);
+            s.origin[d] = origin[d];
+        }
+        s.toIndex[0] = toIndex(0, 0);
+        s.toIndex[1] = toIndex(0, 1);
+        s.toIndex[2] = toIndex(1, 0);
+        s.toIndex[3] = toIndex(1, 1);
+        stages.push_back(s);
+        return true;
+    }
+
+    return false;
+}
+
+// Precomputed B-spline support along one output axis
+struct AxisWeights {
+    std::vector<char> inside;
+    std::vector<long> start;
+    std::vector<double> weights;
+
+    AxisWeights(int n, double origin, double scale, long size)
+        : inside(n), start(n), weights(4 * n)
+    {
+        for (int i = 0; i < n; i++) {
+            auto c = 0.0;
+            c += scale * (static_cast<double>(i) - origin);
+            inside[i] = static_cast<char>(InsideGrid(c, size));
+            if (inside[i] != 0) {
+                CubicWeights(c, start[i], &weights[4 * i]);
+            }
+        }
+    }
+};
+}  // namespace
+
+struct TransformMapper::Impl {
+    /** Stages in the order they are applied */
+    std::vector<Stage> stages;
+    /** Separable weights for the first stage, if it is a grid-aligned
+     * B-spline */
+    std::unique_ptr<AxisWeights> cols;
+    std::unique_ptr<AxisWeights> rows;
+
+    void mapRow(int y, int x0, int n, double* xs, double* ys) const
+    {
+        std::size_t first{0};
+        if (cols) {
+            mapSeparableRow(y, x0, n, xs, ys);
+            first = 1;
+        } else {
+            for (int i = 0; i < n; i++) {
+                xs[i] = static_cast<double>(x0 + i);
+                ys[i] = static_cast<double>(y);
+            }
+        }
+
+        for (auto s = first; s < stages.size(); s++) {
+            if (stages[s].kind == Stage::Kind::Affine) {
+                ApplyAffine(stages[s], xs, ys, n);
+            } else {
+                ApplyBSpline(stages[s], xs, ys, n);
+            }
+        }
+    }
+
+    void mapSeparableRow(int y, int x0, int n, double* xs, double* ys) const
+    {
+        const auto& s = stages.front();
+        const auto py = static_cast<double>(y);
+        const auto rowInside = rows->inside[y] != 0;
+        const auto sy = rows->start[y];
+        const auto* wy = &rows->weights[4 * y];
+        for (int i = 0; i < n; i++) {
+            const auto x = x0 + i;
+            const auto px = static_cast<double>(x);
+            xs[i] = px;
+            ys[i] = py;
+            if (not rowInside or cols->inside[x] == 0) {
+                continue;
+            }
+            double dx{0};
+            double dy{0};
+            Correlate(
+                s, cols->start[x], sy, &cols->weights[4 * x], wy, dx, dy);
+            xs[i] = dx + px;
+            ys[i] = dy + py;
+        }
+    }
+};
+
+TransformMapper::TransformMapper(
+    const Transform::Pointer& transform, const cv::Size& s)
+    : transform_{transform}, size_{s}
+{
+    if (not transform) {
+        throw std::invalid_argument("transform is nullptr");
+    }
+
+    // Chains without a B-spline are left to ResampleImageFilter, which
+    // evaluates affine transforms incrementally along each row
+    std::vector<Stage> stages;
+    if (not CollectStages(transform.GetPointer(), stages)) {
+        return;
+    }
+    auto isBSpline = [](const Stage& st) {
+        return st.kind == Stage::Kind::BSpline;
+    };
+    if (std::none_of(stages.begin(), stages.end(), isBSpline)) {
+        return;
+    }
+
+    impl_ = std::make_unique<Impl>();
+    impl_->stages = std::move(stages);
+
+    // The first B-spline sees the regular output grid. If its grid is axis
+    // aligned, each weight depends on only one of x or y.
+    const auto& first = impl_->stages.front();
+    if (first.kind == Stage::Kind::BSpline and first.toIndex[1] == 0.0 and
+        first.toIndex[2] == 0.0) {
+        impl_->cols = std::make_unique<AxisWeights>(
+            s.width, first.origin[0], first.toIndex[0], first.gridSize[0]);
+        impl_->rows = std::make_unique<AxisWeights>(
+            s.height, first.origin[1], first.toIndex[3], first.gridSize[1]);
+    }
+}
+
+TransformMapper::~TransformMapper() = default;
+
+auto TransformMapper::size() const -> cv::Size { return size_; }
+
+auto TransformMapper::isNative() const -> bool { return impl_ != nullptr; }
+
+void TransformMapper::mapRow(int y, int x0, int n, double* xs, double* ys) const
+{
+    if (impl_) {
+        impl_->mapRow(y, x0, n, xs, ys);
+        return;
+    }
+
+    Transform::InputPointType p;
+    p[1] = static_cast<double>(y);
+    for (int i = 0; i < n; i++) {
+        p[0] = static_cast<double>(x0 + i);
+        auto o = transform_->TransformPoint(p);
+        xs[i] = o[0];
+        ys[i] = o[1];
+    }
+}
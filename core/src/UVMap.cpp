@@ -1,5 +1,9 @@
 #include "rt/types/UVMap.hpp"
 
+#include <stdexcept>
+#include <string>
+#include <utility>
+
 using namespace rt;
 
 /** Top-left UV Origin */
@@ -15,9 +19,36 @@ static auto GetOriginVector(const UVMap::Origin& o) -> cv::Vec2d;
 
 UVMap::UVMap(UVMap::Origin o) : origin_{o} {}
 
+UVMap::UVMap(
+    std::vector<cv::Vec2d> uvs,
+    std::vector<Face> faces,
+    std::vector<bool> hasFace,
+    Origin o)
+    : uvs_{std::move(uvs)}
+    , faces_{std::move(faces)}
+    , hasFace_{std::move(hasFace)}
+    , origin_{o}
+{
+    if (faces_.size() != hasFace_.size()) {
+        throw std::invalid_argument("faces and hasFace differ in size");
+    }
+    for (std::size_t idx = 0; idx < faces_.size(); idx++) {
+        if (not hasFace_[idx]) {
+            continue;
+        }
+        for (const auto& uvIdx : faces_[idx].val) {
+            if (uvIdx >= uvs_.size()) {
+                throw std::invalid_argument(
+                    "face references missing uv: " + std::to_string(idx));
+            }
+        }
+        numFaces_++;
+    }
+}
+
 auto UVMap::size() const -> size_t { return uvs_.size(); }
 
-auto UVMap::size_faces() const -> size_t { return faces_.size(); }
+auto UVMap::size_faces() const -> size_t { return numFaces_; }
 
 auto UVMap::empty() const -> bool { return uvs_.empty(); }
 
@@ -25,9 +56,20 @@ auto UVMap::uvs_as_vector() const -> std::vector<cv::Vec2d> { return uvs_; }
 
 auto UVMap::faces_as_map() const -> std::unordered_map<std::size_t, UVMap::Face>
 {
-    return faces_;
+    std::unordered_map<std::size_t, Face> faces;
+    faces.reserve(numFaces_);
+    for (std::size_t idx = 0; idx < faces_.size(); idx++) {
+        if (hasFace_[idx]) {
+            faces.emplace(idx, faces_[idx]);
+        }
+    }
+    return faces;
 }
 
+auto UVMap::uvs() const -> Span<const cv::Vec2d> { return uvs_; }
+
+auto UVMap::faces() const -> Span<const UVMap::Face> { return faces_; }
+
 void UVMap::setOrigin(const UVMap::Origin& o) { origin_ = o; }
 
 auto UVMap::origin() const -> UVMap::Origin { return origin_; }
@@ -71,33 +113,52 @@ auto UVMap::getUV(size_t id) const -> cv::Vec2d { return getUV(id, origin_); }
 
 auto UVMap::addFace(std::size_t idx, const Face& f) -> size_t
 {
+    if (idx >= faces_.size()) {
+        faces_.resize(idx + 1);
+        hasFace_.resize(idx + 1, false);
+    }
+    if (not hasFace_[idx]) {
+        hasFace_[idx] = true;
+        numFaces_++;
+    }
     faces_[idx] = f;
     return idx;
 }
 
 auto UVMap::addFace(size_t a, size_t b, size_t c) -> size_t
 {
-    auto idx = faces_.size();
-    while (faces_.count(idx) > 0) {
+    auto idx = numFaces_;
+    while (hasFace(idx)) {
         idx++;
     }
-    faces_[idx] = {a, b, c};
-    return idx;
+    return addFace(idx, {a, b, c});
 }
 
 auto UVMap::hasFace(std::size_t idx) const -> bool
 {
-    return faces_.count(idx) > 0;
+    return idx < hasFace_.size() and hasFace_[idx];
 }
 
-auto UVMap::getFace(size_t id) const -> UVMap::Face { return faces_.at(id); }
+auto UVMap::getFace(size_t id) const -> UVMap::Face
+{
+    if (not hasFace(id)) {
+        throw std::out_of_range("face not in uv map: " + std::to_string(id));
+    }
+    return faces_[id];
+}
 
 auto UVMap::getFaceUVs(std::size_t id) const -> std::vector<cv::Vec2d>
 {
-    auto f = faces_.at(id);
+    auto f = getFace(id);
     return {uvs_.at(f[0]), uvs_.at(f[1]), uvs_.at(f[2])};
 }
 
+auto UVMap::faceUVs(std::size_t id) const -> std::array<cv::Vec2d, 3>
+{
+    const auto& f = faces_[id];
+    return {uvs_[f[0]], uvs_[f[1]], uvs_[f[2]]};
+}
+
 auto GetOriginVector(const UVMap::Origin& o) -> cv::Vec2d
 {
     switch (o) {
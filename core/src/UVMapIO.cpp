@@ -1,14 +1,163 @@
 #include "rt/io/UVMapIO.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
-#include <regex>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "rt/types/Exceptions.hpp"
 #include "rt/util/String.hpp"
 
+using namespace rt;
+
 namespace fs = rt::filesystem;
 
+// Current file version
+constexpr static int VERSION = 2;
+
+// Blocks are stored as raw size_t values
+static_assert(
+    sizeof(UVMap::Face) == 3 * sizeof(std::uint64_t),
+    "UVMap files require 64-bit face indices");
+
+namespace
+{
+// Parsed UVMap header
+struct Header {
+    std::string fileType;
+    int version{0};
+    std::string type;
+    std::size_t size{0};
+    double width{0};
+    double height{0};
+    int origin{-1};
+    std::size_t faces{0};
+    std::size_t faceCapacity{0};
+    // Offset of the data blocks from the start of the file
+    std::size_t dataOffset{0};
+};
+
+// Locations of the data blocks in a mapped file
+struct Blocks {
+    const char* uvs{nullptr};
+    const char* faces{nullptr};
+    const char* hasFace{nullptr};
+};
+}  // namespace
+
+// Round a byte count up to a multiple of 8
+static auto Pad8(std::size_t n) -> std::size_t
+{
+    return (n + 7) & ~std::size_t{7};
+}
+
+// Number of words in a face validity bitmap
+static auto BitmapWords(std::size_t numFaces) -> std::size_t
+{
+    return (numFaces + 63) / 64;
+}
+
+// Parse and validate the text header at the start of a mapped file
+static auto ParseHeader(std::string_view data) -> Header
+{
+    Header h;
+    std::size_t pos{0};
+    while (true) {
+        auto eol = data.find('\n', pos);
+        if (eol == std::string_view::npos) {
+            throw IOException("UVMap header is not terminated");
+        }
+        std::string line(data.substr(pos, eol - pos));
+        pos = eol + 1;
+        trim(line);
+
+        // End of the header
+        if (line == "<>") {
+            break;
+        }
+
+        // Skip comments and anything which isn't a key: value pair
+        auto colon = line.find(':');
+        if (line.empty() or line.front() == '#' or
+            colon == std::string::npos) {
+            continue;
+        }
+        auto key = line.substr(0, colon);
+        auto val = line.substr(colon + 1);
+        trim(key);
+        trim(val);
+
+        if (key == "filetype") {
+            h.fileType = val;
+        } else if (key == "version") {
+            h.version = std::stoi(val);
+        } else if (key == "type") {
+            h.type = val;
+        } else if (key == "size") {
+            h.size = std::stoul(val);
+        } else if (key == "width") {
+            h.width = std::stod(val);
+        } else if (key == "height") {
+            h.height = std::stod(val);
+        } else if (key == "origin") {
+            h.origin = std::stoi(val);
+        } else if (key == "faces") {
+            h.faces = std::stoul(val);
+        } else if (key == "face_capacity") {
+            h.faceCapacity = std::stoul(val);
+        }
+    }
+    h.dataOffset = (h.version >= 2) ? Pad8(pos) : pos;
+
+    // Sanity check. Do we have a valid UVMap header?
+    if (h.fileType.empty()) {
+        throw IOException("Must provide file type");
+    } else if (h.fileType != "uvmap") {
+        throw IOException("File is not a UVMap");
+    } else if (h.version != 1 and h.version != VERSION) {
+        auto msg = "Version mismatch. UVMap file version is " +
+                   std::to_string(h.version) + ", processing version is " +
+                   std::to_string(VERSION) + ".";
+        throw IOException(msg);
+    } else if (h.type.empty()) {
+        throw IOException("Must provide UVMap type");
+    } else if (h.type != "per-face") {
+        throw IOException("UVMap type not supported: " + h.type);
+    } else if (h.width == 0 or h.height == 0) {
+        throw IOException("UVMap cannot have dimensions == 0");
+    } else if (h.origin == -1) {
+        throw IOException("UVMap file does not contain origin");
+    }
+    return h;
+}
+
+// Locate the data blocks of a version 2 file
+static auto FindBlocks(const io::MemoryMappedFile& file, const Header& h)
+    -> Blocks
+{
+    // Check sizes without overflowing
+    auto remaining = file.size() - std::min(h.dataOffset, file.size());
+    auto take = [&](std::size_t count, std::size_t size) {
+        if (count > remaining / size) {
+            throw IOException("UVMap file is truncated");
+        }
+        remaining -= count * size;
+    };
+    take(h.size, sizeof(cv::Vec2d));
+    take(h.faceCapacity, sizeof(UVMap::Face));
+    take(BitmapWords(h.faceCapacity), sizeof(std::uint64_t));
+
+    Blocks b;
+    b.uvs = file.data() + h.dataOffset;
+    b.faces = b.uvs + h.size * sizeof(cv::Vec2d);
+    b.hasFace = b.faces + h.faceCapacity * sizeof(UVMap::Face);
+    return b;
+}
+
 void rt::WriteUVMap(const fs::path& path, const UVMap& uvMap)
 {
     std::ofstream ofs{path.string(), std::ios::binary};
@@ -17,172 +166,211 @@ void rt::WriteUVMap(const fs::path& path, const UVMap& uvMap)
         throw IOException(msg);
     }
 
+    auto uvs = uvMap.uvs();
+    auto faces = uvMap.faces();
+
     // Header
     std::stringstream ss;
     ss << "filetype: uvmap" << std::endl;
-    ss << "version: 1" << std::endl;
+    ss << "version: " << VERSION << std::endl;
     ss << "type: per-face" << std::endl;
     ss << "size: " << uvMap.size() << std::endl;
     ss << "width: " << uvMap.ratio().width << std::endl;
     ss << "height: " << uvMap.ratio().height << std::endl;
     ss << "origin: " << static_cast<int>(uvMap.origin()) << std::endl;
     ss << "faces: " << uvMap.size_faces() << std::endl;
+    ss << "face_capacity: " << faces.size() << std::endl;
     ss << "<>" << std::endl;
-    ofs << ss.rdbuf();
 
-    // Write the UV coords
-    for (const auto& uv : uvMap.uvs_as_vector()) {
-        ofs.write(reinterpret_cast<const char*>(uv.val), 2 * sizeof(double));
-    }
+    // Pad so that the blocks are aligned in a mapped file
+    auto header = ss.str();
+    header.resize(Pad8(header.size()), '\0');
+    ofs.write(header.data(), static_cast<std::streamsize>(header.size()));
 
-    // Write the faces
-    for (const auto& f : uvMap.faces_as_map()) {
-        ofs.write(reinterpret_cast<const char*>(&f.first), sizeof(size_t));
-        ofs.write(
-            reinterpret_cast<const char*>(f.second.val), 3 * sizeof(size_t));
+    // Write the UV block
+    ofs.write(
+        reinterpret_cast<const char*>(uvs.data()),
+        static_cast<std::streamsize>(uvs.size() * sizeof(cv::Vec2d)));
+
+    // Write the face block
+    ofs.write(
+        reinterpret_cast<const char*>(faces.data()),
+        static_cast<std::streamsize>(faces.size() * sizeof(UVMap::Face)));
+
+    // Write the face validity bitmap
+    std::vector<std::uint64_t> bitmap(BitmapWords(faces.size()), 0);
+    for (std::size_t idx = 0; idx < faces.size(); idx++) {
+        if (uvMap.hasFace(idx)) {
+            bitmap[idx / 64] |= std::uint64_t{1} << (idx % 64);
+        }
     }
+    ofs.write(
+        reinterpret_cast<const char*>(bitmap.data()),
+        static_cast<std::streamsize>(bitmap.size() * sizeof(std::uint64_t)));
 
     ofs.close();
 }
 
-auto rt::ReadUVMap(const fs::path& path) -> rt::UVMap
+// Read the version 1 layout: UVs, then (index, face) records
+static void ReadV1(
+    const io::MemoryMappedFile& file,
+    const Header& h,
+    std::vector<cv::Vec2d>& uvs,
+    std::vector<UVMap::Face>& faces,
+    std::vector<bool>& hasFace)
 {
-    std::ifstream ifs{path.string(), std::ios::binary};
-    if (!ifs.is_open()) {
-        auto msg = "could not open file '" + path.string() + "'";
-        throw IOException(msg);
+    constexpr auto recordSize = sizeof(std::size_t) + sizeof(UVMap::Face);
+    auto remaining = file.size() - std::min(h.dataOffset, file.size());
+    if (h.size > remaining / sizeof(cv::Vec2d) or
+        h.faces > (remaining - h.size * sizeof(cv::Vec2d)) / recordSize) {
+        throw IOException("UVMap file is truncated");
     }
+    const auto* data = file.data() + h.dataOffset;
 
-    struct Header {
-        std::string fileType;
-        int version;
-        std::string type;
-        size_t size;
-        double width{0};
-        double height{0};
-        int origin{-1};
-        size_t faces;
-    };
-
-    // Regexes
-    std::regex comments{"^#"};
-    std::regex fileType{"^filetype"};
-    std::regex version{"^version"};
-    std::regex type{"^type"};
-    std::regex size{"^size"};
-    std::regex width{"^width"};
-    std::regex height{"^height"};
-    std::regex origin{"^origin"};
-    std::regex faces{"^faces"};
-    std::regex headerTerminator{"^<>$"};
+    // Version 1 readers inserted the stored values relative to the file's
+    // origin, so apply the same transform
+    UVMap transformed(static_cast<UVMap::Origin>(h.origin));
+    for (std::size_t i = 0; i < h.size; i++) {
+        cv::Vec2d uv;
+        std::memcpy(uv.val, data, sizeof(cv::Vec2d));
+        transformed.addUV(uv);
+        data += sizeof(cv::Vec2d);
+    }
+    uvs = transformed.uvs_as_vector();
 
-    Header h;
-    std::string line;
-    while (std::getline(ifs, line)) {
-        trim(line);
-        auto strs = split(line, ':');
-        std::for_each(
-            std::begin(strs), std::end(strs), [](auto& t) { trim(t); });
-
-        // Comments: look like:
-        // # This is a comment
-        //    # This is another comment
-        if (std::regex_match(strs[0], comments)) {
-            continue;
+    for (std::size_t i = 0; i < h.faces; i++) {
+        std::size_t idx{0};
+        std::memcpy(&idx, data, sizeof(std::size_t));
+        if (idx >= faces.size()) {
+            faces.resize(idx + 1);
+            hasFace.resize(idx + 1, false);
         }
+        std::memcpy(
+            faces[idx].val, data + sizeof(std::size_t), sizeof(UVMap::Face));
+        hasFace[idx] = true;
+        data += recordSize;
+    }
+}
 
-        // File type
-        else if (std::regex_match(strs[0], fileType)) {
-            h.fileType = strs[1];
+// Read the version 2 layout by copying each block
+static void ReadV2(
+    const io::MemoryMappedFile& file,
+    const Header& h,
+    std::vector<cv::Vec2d>& uvs,
+    std::vector<UVMap::Face>& faces,
+    std::vector<bool>& hasFace)
+{
+    auto blocks = FindBlocks(file, h);
+    uvs.resize(h.size);
+    std::memcpy(uvs.data(), blocks.uvs, h.size * sizeof(cv::Vec2d));
+    faces.resize(h.faceCapacity);
+    std::memcpy(
+        faces.data(), blocks.faces, h.faceCapacity * sizeof(UVMap::Face));
+    hasFace.resize(h.faceCapacity);
+    std::uint64_t word{0};
+    for (std::size_t idx = 0; idx < h.faceCapacity; idx++) {
+        if (idx % 64 == 0) {
+            std::memcpy(
+                &word, blocks.hasFace + (idx / 64) * sizeof(std::uint64_t),
+                sizeof(std::uint64_t));
         }
+        hasFace[idx] = ((word >> (idx % 64)) & 1U) != 0;
+    }
+}
 
-        // Version
-        else if (std::regex_match(strs[0], version)) {
-            h.version = std::stoi(strs[1]);
-        }
+auto rt::ReadUVMap(const fs::path& path) -> rt::UVMap
+{
+    io::MemoryMappedFile file(path);
+    auto h = ParseHeader(file.view());
 
-        // Type
-        else if (std::regex_match(strs[0], type)) {
-            h.type = strs[1];
-        }
+    std::vector<cv::Vec2d> uvs;
+    std::vector<UVMap::Face> faces;
+    std::vector<bool> hasFace;
+    if (h.version == 1) {
+        ReadV1(file, h, uvs, faces, hasFace);
+    } else {
+        ReadV2(file, h, uvs, faces, hasFace);
+    }
 
-        // Size
-        else if (std::regex_match(strs[0], size)) {
-            h.size = std::stoul(strs[1]);
-        }
+    // Construct the UVMap
+    UVMap map;
+    try {
+        map = UVMap(
+            std::move(uvs), std::move(faces), std::move(hasFace),
+            static_cast<UVMap::Origin>(h.origin));
+    } catch (const std::invalid_argument& e) {
+        throw IOException(e.what());
+    }
+    map.ratio(h.width, h.height);
+    return map;
+}
 
-        // Width
-        else if (std::regex_match(strs[0], width)) {
-            h.width = std::stod(strs[1]);
-        }
+UVMapView::UVMapView(const fs::path& path) : file_{path}
+{
+    auto h = ParseHeader(file_.view());
+    if (h.version != VERSION) {
+        throw IOException("UVMapView requires a version 2 UVMap file");
+    }
 
-        // Height
-        else if (std::regex_match(strs[0], height)) {
-            h.height = std::stod(strs[1]);
-        }
+    auto blocks = FindBlocks(file_, h);
+    uvs_ = {reinterpret_cast<const cv::Vec2d*>(blocks.uvs), h.size};
+    faces_ = {
+        reinterpret_cast<const UVMap::Face*>(blocks.faces), h.faceCapacity};
+    hasFace_ = {
+        reinterpret_cast<const std::uint64_t*>(blocks.hasFace),
+        BitmapWords(h.faceCapacity)};
+    numFaces_ = h.faces;
+    origin_ = static_cast<UVMap::Origin>(h.origin);
+    ratio_.width = h.width;
+    ratio_.height = h.height;
+    ratio_.aspect = h.width / h.height;
 
-        // Origin
-        else if (std::regex_match(strs[0], origin)) {
-            h.origin = std::stoi(strs[1]);
+    // Validate the face references once so that faceUVs() can skip it
+    for (std::size_t idx = 0; idx < faces_.size(); idx++) {
+        if (not hasFace(idx)) {
+            continue;
         }
-
-        // Faces
-        else if (std::regex_match(strs[0], faces)) {
-            h.faces = std::stoul(strs[1]);
+        for (const auto& uvIdx : faces_[idx].val) {
+            if (uvIdx >= uvs_.size()) {
+                throw IOException("UVMap face references missing UV");
+            }
         }
+    }
+}
 
-        // End of the header
-        else if (std::regex_match(line, headerTerminator)) {
-            break;
-        }
+auto UVMapView::size() const -> std::size_t { return uvs_.size(); }
 
-        // Ignore everything else
-        else {
-            continue;
-        }
-    }
+auto UVMapView::size_faces() const -> std::size_t { return numFaces_; }
 
-    // Sanity check. Do we have a valid UVMap header?
-    if (h.fileType.empty()) {
-        throw IOException("Must provide file type");
-    } else if (h.fileType != "uvmap") {
-        throw IOException("File is not a UVMap");
-    } else if (h.version != 1) {
-        auto msg = "Version mismatch. UVMap file version is " +
-                   std::to_string(h.version) + ", processing version is 1.";
-        throw IOException(msg);
-    } else if (h.type.empty()) {
-        throw IOException("Must provide UVMap type");
-    } else if (h.type != "per-face") {
-        throw IOException("UVMap type not supported: " + h.type);
-    } else if (h.width == 0 or h.height == 0) {
-        throw IOException("UVMap cannot have dimensions == 0");
-    } else if (h.origin == -1) {
-        throw IOException("UVMap file does not contain origin");
-    }
+auto UVMapView::origin() const -> UVMap::Origin { return origin_; }
 
-    // Construct the UVMap
-    UVMap map;
-    map.setOrigin(static_cast<UVMap::Origin>(h.origin));
-    map.ratio(h.width, h.height);
+auto UVMapView::ratio() const -> UVMap::Ratio { return ratio_; }
 
-    // Read all of the points
-    for (size_t i = 0; i < h.size; i++) {
-        std::ignore = i;
-        cv::Vec2d uv;
-        ifs.read(reinterpret_cast<char*>(uv.val), 2 * sizeof(double));
-        map.addUV(uv);
-    }
+auto UVMapView::uvs() const -> Span<const cv::Vec2d> { return uvs_; }
 
-    // Read all of the faces
-    for (size_t i = 0; i < h.faces; i++) {
-        std::ignore = i;
-        std::size_t idx{0};
-        ifs.read(reinterpret_cast<char*>(&idx), sizeof(size_t));
-        UVMap::Face f;
-        ifs.read(reinterpret_cast<char*>(f.val), 3 * sizeof(size_t));
-        map.addFace(idx, f);
-    }
+auto UVMapView::faces() const -> Span<const UVMap::Face> { return faces_; }
 
+auto UVMapView::hasFace(std::size_t idx) const -> bool
+{
+    return idx < faces_.size() and ((hasFace_[idx / 64] >> (idx % 64)) & 1U);
+}
+
+auto UVMapView::faceUVs(std::size_t id) const -> std::array<cv::Vec2d, 3>
+{
+    const auto& f = faces_[id];
+    return {uvs_[f[0]], uvs_[f[1]], uvs_[f[2]]};
+}
+
+auto UVMapView::toUVMap() const -> UVMap
+{
+    std::vector<bool> hasFaceVec(faces_.size());
+    for (std::size_t idx = 0; idx < faces_.size(); idx++) {
+        hasFaceVec[idx] = hasFace(idx);
+    }
+    UVMap map(
+        std::vector<cv::Vec2d>(uvs_.begin(), uvs_.end()),
+        std::vector<UVMap::Face>(faces_.begin(), faces_.end()),
+        std::move(hasFaceVec), origin_);
+    map.ratio(ratio_.width, ratio_.height);
     return map;
 }
@@ -11,6 +11,7 @@
 #include "graph/LandmarkRegistration.hpp"
 #include "graph/MeshIO.hpp"
 #include "graph/MeshOps.hpp"
+#include "graph/Scheduler.hpp"
 #include "graph/Transforms.hpp"
 
 namespace rt::graph
@@ -2,6 +2,8 @@
 
 /** @file */
 
+#include <vector>
+
 #include <opencv2/core.hpp>
 #include <smgl/Node.hpp>
 #include <smgl/Ports.hpp>
@@ -37,6 +39,16 @@ public:
     smgl::InputPort<int> iterations;
     /** @copydoc DeformableRegistration::setReportMetrics(bool) */
     smgl::InputPort<bool> reportMetrics;
+    /** @copydoc DeformableRegistration::setNumberOfLevels(size_t) */
+    smgl::InputPort<std::size_t> levels;
+    /** @copydoc DeformableRegistration::setIterationSchedule() */
+    smgl::InputPort<std::vector<std::size_t>> iterationSchedule;
+    /** @copydoc DeformableRegistration::setSamplingSchedule() */
+    smgl::InputPort<std::vector<double>> samplingSchedule;
+    /** @copydoc DeformableRegistration::setFramework() */
+    smgl::InputPort<DeformableRegistration::Framework> framework;
+    /** @copydoc DeformableRegistration::setNumberOfThreads() */
+    smgl::InputPort<unsigned> threads;
     /**@}*/
 
     /** @name Output Ports */
@@ -7,6 +7,7 @@
 #include <smgl/Ports.hpp>
 
 #include "rt/filesystem.hpp"
+#include "rt/io/TIFFIO.hpp"
 
 namespace rt::graph
 {
@@ -63,6 +64,8 @@ public:
     smgl::InputPort<filesystem::path> path{&path_};
     /** @brief Image port */
     smgl::InputPort<cv::Mat> image{&img_};
+    /** @brief TIFF layout and compression options port */
+    smgl::InputPort<io::TIFFWriteOptions> tiffOptions{&tiffOptions_};
     /**@}*/
 
 private:
@@ -70,6 +73,8 @@ private:
     filesystem::path path_;
     /** Image to write */
     cv::Mat img_;
+    /** TIFF options */
+    io::TIFFWriteOptions tiffOptions_;
     /** Graph serialize */
     smgl::Metadata serialize_(
         bool /*unused*/, const filesystem::path& /*unused*/) override;
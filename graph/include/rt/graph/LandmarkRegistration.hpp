@@ -22,6 +22,15 @@ namespace rt::graph
 class LandmarkDetectorNode : public smgl::Node
 {
 public:
+    /** @see LandmarkDetector::DetectionMode */
+    using DetectionMode = LandmarkDetector::DetectionMode;
+    /** @see LandmarkDetector::MatcherType */
+    using MatcherType = LandmarkDetector::MatcherType;
+    /** @see LandmarkDetector::GeometricModel */
+    using GeometricModel = LandmarkDetector::GeometricModel;
+    /** @see LandmarkDetector::RobustEstimator */
+    using RobustEstimator = LandmarkDetector::RobustEstimator;
+
     /** Default constructor */
     LandmarkDetectorNode();
 
@@ -34,6 +43,45 @@ public:
     /** @copydoc LandmarkDetector::setMatchRatio(float) */
     smgl::InputPort<float> matchRatio{
         &detector_, &LandmarkDetector::setMatchRatio};
+    /**
+     * @brief Feature cache directory port
+     *
+     * If set, detected features are persisted to this directory and reused
+     * by later runs. See FeatureCache.
+     */
+    smgl::InputPort<filesystem::path> featureCacheDir{&featureCacheDir_};
+    /** @copydoc LandmarkDetector::setDetectionMode(DetectionMode) */
+    smgl::InputPort<DetectionMode> detectionMode{
+        &detector_, &LandmarkDetector::setDetectionMode};
+    /** @copydoc LandmarkDetector::setTileSize(int) */
+    smgl::InputPort<int> tileSize{&detector_, &LandmarkDetector::setTileSize};
+    /** @copydoc LandmarkDetector::setTileOverlap(int) */
+    smgl::InputPort<int> tileOverlap{
+        &detector_, &LandmarkDetector::setTileOverlap};
+    /** @copydoc LandmarkDetector::setCoarseScale(double) */
+    smgl::InputPort<double> coarseScale{
+        &detector_, &LandmarkDetector::setCoarseScale};
+    /** @copydoc LandmarkDetector::setRefineRadius(int) */
+    smgl::InputPort<int> refineRadius{
+        &detector_, &LandmarkDetector::setRefineRadius};
+    /** @copydoc LandmarkDetector::setMatcherType(MatcherType) */
+    smgl::InputPort<MatcherType> matcherType{
+        &detector_, &LandmarkDetector::setMatcherType};
+    /** @copydoc LandmarkDetector::setSearchRadius(float) */
+    smgl::InputPort<float> searchRadius{
+        &detector_, &LandmarkDetector::setSearchRadius};
+    /** @copydoc LandmarkDetector::setGeometricModel(GeometricModel) */
+    smgl::InputPort<GeometricModel> geometricModel{
+        &detector_, &LandmarkDetector::setGeometricModel};
+    /** @copydoc LandmarkDetector::setRobustEstimator(RobustEstimator) */
+    smgl::InputPort<RobustEstimator> robustEstimator{
+        &detector_, &LandmarkDetector::setRobustEstimator};
+    /** @copydoc LandmarkDetector::setInlierThreshold(double) */
+    smgl::InputPort<double> inlierThreshold{
+        &detector_, &LandmarkDetector::setInlierThreshold};
+    /** @copydoc LandmarkDetector::setMaxLandmarks(std::size_t) */
+    smgl::InputPort<std::size_t> maxLandmarks{
+        &detector_, &LandmarkDetector::setMaxLandmarks};
     /**@}*/
 
     /** @name Output Ports */
@@ -51,6 +99,8 @@ private:
     cv::Mat fixedImg_;
     /** Moving image */
     cv::Mat movingImg_;
+    /** Feature cache directory */
+    filesystem::path featureCacheDir_;
     /** Detected fixed landmarks */
     LandmarkContainer fixedLdm_;
     /** Detected moving landmarks */
@@ -17,7 +17,14 @@ namespace graph
 
 /**
  * @brief Mesh File Reader
+ *
+ * Reads OBJ files and binary mesh files (.rtmesh). When the graph is
+ * serialized with caching enabled, the loaded mesh is cached as a binary
+ * mesh, so deserializing the graph does not reparse the source file. The
+ * cache references the source texture image rather than copying it.
+ *
  * @see OBJReader
+ * @see io::ReadBinaryMesh
  */
 class MeshReadNode : public smgl::Node
 {
@@ -50,18 +57,27 @@ private:
     cv::Mat img_;
     /** Loaded UV map */
     UVMap uv_;
+    /** Loaded texture image path */
+    filesystem::path texturePath_;
+    /** Load the outputs from a binary mesh file */
+    void read_binary_(const filesystem::path& file);
     /** Graph serialize */
     smgl::Metadata serialize_(
-        bool /*unused*/, const filesystem::path& /*unused*/) override;
+        bool useCache, const filesystem::path& cacheDir) override;
     /** Graph deserialize */
     void deserialize_(
-        const smgl::Metadata& meta,
-        const filesystem::path& /*unused*/) override;
+        const smgl::Metadata& meta, const filesystem::path& cacheDir) override;
 };
 
 /**
  * @brief Mesh File Writer
+ *
+ * Writes an OBJ file, or a binary mesh file if the path has the .rtmesh
+ * extension. In both cases the texture image is written beside the mesh as
+ * a TIFF.
+ *
  * @see OBJWriter
+ * @see io::WriteBinaryMesh
  */
 class MeshWriteNode : public smgl::Node
 {
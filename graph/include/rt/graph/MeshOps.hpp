@@ -22,6 +22,8 @@ public:
     using SamplingOrigin = ReorderUnorganizedTexture::SamplingOrigin;
     /** @see ReorderUnorganizedTexture::SamplingMode */
     using SamplingMode = ReorderUnorganizedTexture::SamplingMode;
+    /** @see ReorderUnorganizedTexture::SamplingEngine */
+    using SamplingEngine = ReorderUnorganizedTexture::SamplingEngine;
 
     /** Default constructor */
     ReorderTextureNode();
@@ -38,6 +40,8 @@ public:
     smgl::InputPort<SamplingOrigin> samplingOrigin;
     /** @copydoc ReorderUnorganizedTexture::samplingMode() */
     smgl::InputPort<SamplingMode> samplingMode;
+    /** @copydoc ReorderUnorganizedTexture::samplingEngine() */
+    smgl::InputPort<SamplingEngine> samplingEngine;
     /** @copydoc ReorderUnorganizedTexture::setSampleRate() */
     smgl::InputPort<double> sampleRate;
     /** @copydoc ReorderUnorganizedTexture::setSampleDim() */
@@ -0,0 +1,33 @@
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+
+#include <smgl/Graph.hpp>
+
+namespace rt::graph
+{
+
+/**
+ * @brief Update a graph, running independent nodes concurrently
+ *
+ * Equivalent to smgl::Graph::update(), except that nodes are run on a
+ * work-stealing thread pool. A node is started once every node connected to
+ * its input ports has finished, so independent branches of the graph (e.g.
+ * reading two images, or writing two results) run at the same time.
+ *
+ * If caching is enabled, the graph cache is written once, after all nodes
+ * have finished, rather than after each node. So if the process crashes
+ * during the update, none of the update's results are cached.
+ *
+ * If a node throws, no further nodes are started. Once the running nodes
+ * finish, the first exception is rethrown.
+ *
+ * @param graph Graph to update
+ * @param maxConcurrency Maximum number of nodes to run at once. If 0, use the
+ * number of hardware threads. If 1, calls smgl::Graph::update().
+ */
+void UpdateGraph(smgl::Graph& graph, std::size_t maxConcurrency = 0);
+
+}  // namespace rt::graph
@@ -6,6 +6,7 @@
 #include <smgl/Node.hpp>
 #include <smgl/Ports.hpp>
 
+#include "rt/ITKImageTypes.hpp"
 #include "rt/LandmarkRegistrationBase.hpp"
 #include "rt/filesystem.hpp"
 #include "rt/types/Transforms.hpp"
@@ -180,11 +181,56 @@ private:
         const smgl::Metadata& meta, const filesystem::path& cacheDir) override;
 };
 
+/**
+ * @brief Bake a transform into a deformation field
+ *
+ * Evaluates the transform at every pixel of the fixed image. Connect the
+ * result to ImageResampleNode::deformationField to resample many images
+ * without re-evaluating the transform.
+ *
+ * @see BakeDeformationField
+ */
+class DeformationFieldNode : public smgl::Node
+{
+public:
+    /** Default constructor */
+    DeformationFieldNode();
+
+    /** @name Input Ports */
+    /**@{*/
+    /** @brief Fixed image port */
+    smgl::InputPort<cv::Mat> fixedImage{&fixed_};
+    /** @brief Transform port */
+    smgl::InputPort<Transform::Pointer> transform{&tfm_};
+    /**@}*/
+
+    /** @name Output Ports */
+    /**@{*/
+    /** @brief Deformation field port */
+    smgl::OutputPort<DeformationField::Pointer> field{&field_};
+    /**@}*/
+
+private:
+    /** Fixed image */
+    cv::Mat fixed_;
+    /** Transform */
+    Transform::Pointer tfm_;
+    /** Deformation field */
+    DeformationField::Pointer field_;
+    /** Graph serialize */
+    smgl::Metadata serialize_(
+        bool useCache, const filesystem::path& cacheDir) override;
+    /** Graph deserialize */
+    void deserialize_(
+        const smgl::Metadata& meta, const filesystem::path& cacheDir) override;
+};
+
 /**
  * @brief Resample an image using a transform
  *
  * Creates a new image the same size as the provided fixed image, then uses
  * the provided transform to map the moving image into this new image space.
+ * If a deformation field is connected, it is used instead of the transform.
  *
  * @see ImageTransformResampler
  */
@@ -209,6 +255,15 @@ public:
      * moving image does not have one.
      */
     smgl::InputPort<bool> forceAlpha{&forceAlpha_};
+    /**
+     * @brief Baked deformation field port
+     *
+     * If set, the image is resampled from this field rather than the
+     * transform.
+     *
+     * @see DeformationFieldNode
+     */
+    smgl::InputPort<DeformationField::Pointer> deformationField{&field_};
     /**@}*/
 
     /** @name Output Ports */
@@ -226,6 +281,8 @@ private:
     cv::Mat moving_;
     /** Transform */
     Transform::Pointer tfm_;
+    /** Deformation field */
+    DeformationField::Pointer field_;
     /** Resampled image */
     cv::Mat resampled_;
     /** Graph serialize */
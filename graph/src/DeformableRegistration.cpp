@@ -5,6 +5,18 @@ namespace fs = rt::filesystem;
 
 using Meta = smgl::Metadata;
 
+// Enum conversions
+namespace rt
+{
+// clang-format off
+using Framework = DeformableRegistration::Framework;
+NLOHMANN_JSON_SERIALIZE_ENUM(Framework, {
+    {Framework::ITKv3, "itkv3"},
+    {Framework::ITKv4, "itkv4"}
+})
+// clang-format on
+}  // namespace rt
+
 rtg::DeformableRegistrationNode::DeformableRegistrationNode()
     : Node{true}
     , fixedImage{&reg_, &DeformableRegistration::setFixedImage}
@@ -13,6 +25,11 @@ rtg::DeformableRegistrationNode::DeformableRegistrationNode()
     , gradientTolerance{&reg_, &DeformableRegistration::setGradientMagnitudeTolerance}
     , iterations{&iters_}
     , reportMetrics{&reg_, &DeformableRegistration::setReportMetrics}
+    , levels{&reg_, &DeformableRegistration::setNumberOfLevels}
+    , iterationSchedule{&reg_, &DeformableRegistration::setIterationSchedule}
+    , samplingSchedule{&reg_, &DeformableRegistration::setSamplingSchedule}
+    , framework{&reg_, &DeformableRegistration::setFramework}
+    , threads{&reg_, &DeformableRegistration::setNumberOfThreads}
     , transform{&tfm_}
 {
     registerInputPort("fixedImage", fixedImage);
@@ -21,6 +38,11 @@ rtg::DeformableRegistrationNode::DeformableRegistrationNode()
     registerInputPort("meshFillSize", meshFillSize);
     registerInputPort("gradientTolerance", gradientTolerance);
     registerInputPort("reportMetrics", reportMetrics);
+    registerInputPort("levels", levels);
+    registerInputPort("iterationSchedule", iterationSchedule);
+    registerInputPort("samplingSchedule", samplingSchedule);
+    registerInputPort("framework", framework);
+    registerInputPort("threads", threads);
     registerOutputPort("transform", transform);
 
     compute = [=]() {
@@ -38,6 +60,11 @@ auto rtg::DeformableRegistrationNode::serialize_(
     m["meshFillSize"] = reg_.getMeshFillSize();
     m["gradientTolerance"] = reg_.getGradientMagnitudeTolerance();
     m["reportMetrics"] = reg_.getReportMetrics();
+    m["levels"] = reg_.getNumberOfLevels();
+    m["iterationSchedule"] = reg_.getIterationSchedule();
+    m["samplingSchedule"] = reg_.getSamplingSchedule();
+    m["framework"] = reg_.getFramework();
+    m["threads"] = reg_.getNumberOfThreads();
     if (useCache and tfm_) {
         WriteTransform(cacheDir / "deformable.tfm", tfm_);
         m["transform"] = "deformable.tfm";
@@ -52,6 +79,17 @@ void rtg::DeformableRegistrationNode::deserialize_(
     reg_.setMeshFillSize(meta["meshFillSize"].get<unsigned>());
     reg_.setGradientMagnitudeTolerance(meta["gradientTolerance"].get<double>());
     reg_.setReportMetrics(meta["reportMetrics"].get<bool>());
+    if (meta.contains("levels")) {
+        reg_.setNumberOfLevels(meta["levels"].get<std::size_t>());
+        reg_.setIterationSchedule(
+            meta["iterationSchedule"].get<std::vector<std::size_t>>());
+        reg_.setSamplingSchedule(
+            meta["samplingSchedule"].get<std::vector<double>>());
+    }
+    if (meta.contains("framework")) {
+        reg_.setFramework(meta["framework"].get<Framework>());
+        reg_.setNumberOfThreads(meta["threads"].get<unsigned>());
+    }
     if (meta.contains("transform")) {
         auto file = meta["transform"].get<std::string>();
         tfm_ = ReadTransform(cacheDir / file);
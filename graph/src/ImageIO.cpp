@@ -5,6 +5,44 @@
 namespace rtg = rt::graph;
 namespace fs = rt::filesystem;
 
+// TIFF option conversions
+namespace rt::io
+{
+// clang-format off
+NLOHMANN_JSON_SERIALIZE_ENUM(TIFFCompression, {
+    {TIFFCompression::None, "none"},
+    {TIFFCompression::LZW, "lzw"},
+    {TIFFCompression::Deflate, "deflate"},
+    {TIFFCompression::ZSTD, "zstd"}
+})
+
+NLOHMANN_JSON_SERIALIZE_ENUM(TIFFPredictor, {
+    {TIFFPredictor::None, "none"},
+    {TIFFPredictor::Horizontal, "horizontal"},
+    {TIFFPredictor::FloatingPoint, "floating-point"}
+})
+// clang-format on
+
+static void to_json(smgl::Metadata& j, const TIFFWriteOptions& o)
+{
+    j["tiled"] = o.tiled;
+    j["tileSize"] = {o.tileSize.width, o.tileSize.height};
+    j["compression"] = o.compression;
+    j["predictor"] = o.predictor;
+    j["pyramidLevels"] = o.pyramidLevels;
+}
+
+static void from_json(const smgl::Metadata& j, TIFFWriteOptions& o)
+{
+    o.tiled = j["tiled"].get<bool>();
+    o.tileSize.width = j["tileSize"][0].get<int>();
+    o.tileSize.height = j["tileSize"][1].get<int>();
+    o.compression = j["compression"].get<TIFFCompression>();
+    o.predictor = j["predictor"].get<TIFFPredictor>();
+    o.pyramidLevels = j["pyramidLevels"].get<int>();
+}
+}  // namespace rt::io
+
 rtg::ImageReadNode::ImageReadNode()
 {
     registerInputPort("path", path);
@@ -28,16 +66,20 @@ rtg::ImageWriteNode::ImageWriteNode()
 {
     registerInputPort("path", path);
     registerInputPort("image", image);
-    compute = [this]() { WriteImage(path_, img_); };
+    registerInputPort("tiffOptions", tiffOptions);
+    compute = [this]() { WriteImage(path_, img_, tiffOptions_); };
 }
 
 smgl::Metadata rtg::ImageWriteNode::serialize_(bool, const fs::path&)
 {
-    return {{"path", path_.string()}};
+    return {{"path", path_.string()}, {"tiffOptions", tiffOptions_}};
 }
 
 void rtg::ImageWriteNode::deserialize_(
     const smgl::Metadata& meta, const fs::path&)
 {
     path_ = meta["path"].get<std::string>();
+    if (meta.contains("tiffOptions")) {
+        tiffOptions_ = meta["tiffOptions"].get<io::TIFFWriteOptions>();
+    }
 }
\ No newline at end of file
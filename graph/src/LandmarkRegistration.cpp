@@ -5,17 +5,70 @@
 namespace rtg = rt::graph;
 namespace fs = rt::filesystem;
 
+// Enum conversions
+namespace rt
+{
+// clang-format off
+using DetectionMode = LandmarkDetector::DetectionMode;
+NLOHMANN_JSON_SERIALIZE_ENUM(DetectionMode, {
+    {DetectionMode::Full, "full"},
+    {DetectionMode::Tiled, "tiled"},
+    {DetectionMode::CoarseToFine, "coarse-to-fine"}
+})
+
+using MatcherType = LandmarkDetector::MatcherType;
+NLOHMANN_JSON_SERIALIZE_ENUM(MatcherType, {
+    {MatcherType::BruteForce, "brute-force"},
+    {MatcherType::LSH, "lsh"},
+    {MatcherType::HierarchicalClustering, "hierarchical-clustering"}
+})
+
+using GeometricModel = LandmarkDetector::GeometricModel;
+NLOHMANN_JSON_SERIALIZE_ENUM(GeometricModel, {
+    {GeometricModel::None, "none"},
+    {GeometricModel::Affine, "affine"},
+    {GeometricModel::Homography, "homography"}
+})
+
+using RobustEstimator = LandmarkDetector::RobustEstimator;
+NLOHMANN_JSON_SERIALIZE_ENUM(RobustEstimator, {
+    {RobustEstimator::RANSAC, "ransac"},
+    {RobustEstimator::PROSAC, "prosac"},
+    {RobustEstimator::MAGSAC, "magsac"}
+})
+// clang-format on
+}  // namespace rt
+
 rtg::LandmarkDetectorNode::LandmarkDetectorNode() : Node{true}
 {
     registerInputPort("fixedImage", fixedImage);
     registerInputPort("movingImage", movingImage);
+    registerInputPort("featureCacheDir", featureCacheDir);
+    registerInputPort("detectionMode", detectionMode);
+    registerInputPort("tileSize", tileSize);
+    registerInputPort("tileOverlap", tileOverlap);
+    registerInputPort("coarseScale", coarseScale);
+    registerInputPort("refineRadius", refineRadius);
+    registerInputPort("matcherType", matcherType);
+    registerInputPort("searchRadius", searchRadius);
+    registerInputPort("geometricModel", geometricModel);
+    registerInputPort("robustEstimator", robustEstimator);
+    registerInputPort("inlierThreshold", inlierThreshold);
+    registerInputPort("maxLandmarks", maxLandmarks);
     registerOutputPort("fixedLandmarks", fixedLandmarks);
     registerOutputPort("movingLandmarks", movingLandmarks);
     compute = [this]() {
         std::cout << "Detecting landmarks..." << std::endl;
         detector_.setFixedImage(fixedImg_);
         detector_.setMovingImage(movingImg_);
+        auto cache = detector_.featureCache();
+        if (featureCacheDir_.empty()) {
+            detector_.setFeatureCache(nullptr);
+        } else if (not cache or cache->directory() != featureCacheDir_) {
+            detector_.setFeatureCache(FeatureCache::New(featureCacheDir_));
+        }
         detector_.compute();
+        std::cout << detector_.matchReport() << std::endl;
         fixedLdm_ = detector_.getFixedLandmarks();
         movingLdm_ = detector_.getMovingLandmarks();
     };
@@ -25,6 +78,18 @@ smgl::Metadata rtg::LandmarkDetectorNode::serialize_(
     bool useCache, const fs::path& cacheDir)
 {
     smgl::Metadata m{{"matchRatio", detector_.matchRatio()}};
+    m["featureCacheDir"] = featureCacheDir_.string();
+    m["detectionMode"] = detector_.detectionMode();
+    m["tileSize"] = detector_.tileSize();
+    m["tileOverlap"] = detector_.tileOverlap();
+    m["coarseScale"] = detector_.coarseScale();
+    m["refineRadius"] = detector_.refineRadius();
+    m["matcherType"] = detector_.matcherType();
+    m["searchRadius"] = detector_.searchRadius();
+    m["geometricModel"] = detector_.geometricModel();
+    m["robustEstimator"] = detector_.robustEstimator();
+    m["inlierThreshold"] = detector_.inlierThreshold();
+    m["maxLandmarks"] = detector_.maxLandmarks();
     if (useCache) {
         LandmarkWriter writer;
         writer.setPath(cacheDir / "landmarks.ldm");
@@ -41,6 +106,29 @@ void rtg::LandmarkDetectorNode::deserialize_(
     const smgl::Metadata& meta, const fs::path& cacheDir)
 {
     detector_.setMatchRatio(meta["matchRatio"].get<float>());
+    if (meta.contains("featureCacheDir")) {
+        featureCacheDir_ = meta["featureCacheDir"].get<std::string>();
+    }
+    if (meta.contains("detectionMode")) {
+        detector_.setDetectionMode(
+            meta["detectionMode"].get<DetectionMode>());
+        detector_.setTileSize(meta["tileSize"].get<int>());
+        detector_.setTileOverlap(meta["tileOverlap"].get<int>());
+        detector_.setCoarseScale(meta["coarseScale"].get<double>());
+        detector_.setRefineRadius(meta["refineRadius"].get<int>());
+    }
+    if (meta.contains("matcherType")) {
+        detector_.setMatcherType(meta["matcherType"].get<MatcherType>());
+        detector_.setSearchRadius(meta["searchRadius"].get<float>());
+    }
+    if (meta.contains("geometricModel")) {
+        detector_.setGeometricModel(
+            meta["geometricModel"].get<GeometricModel>());
+        detector_.setRobustEstimator(
+            meta["robustEstimator"].get<RobustEstimator>());
+        detector_.setInlierThreshold(meta["inlierThreshold"].get<double>());
+        detector_.setMaxLandmarks(meta["maxLandmarks"].get<std::size_t>());
+    }
     if (meta.contains("landmarks")) {
         auto file = meta["landmarks"].get<std::string>();
         LandmarkReader reader;
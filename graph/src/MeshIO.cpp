@@ -1,14 +1,23 @@
 #include "rt/graph/MeshIO.hpp"
 
+#include "rt/io/BinaryMeshIO.hpp"
+#include "rt/io/ImageIO.hpp"
 #include "rt/io/OBJReader.hpp"
 #include "rt/io/OBJWriter.hpp"
+#include "rt/types/Exceptions.hpp"
 
 using namespace rt;
 
 namespace fs = rt::filesystem;
 namespace rtg = rt::graph;
 
-rtg::MeshReadNode::MeshReadNode()
+// Whether a path names a binary mesh file
+static auto IsBinaryMesh(const fs::path& p) -> bool
+{
+    return p.extension() == io::BINARY_MESH_EXTENSION;
+}
+
+rtg::MeshReadNode::MeshReadNode() : Node{true}
 {
     registerInputPort("path", path);
     registerOutputPort("mesh", mesh);
@@ -16,24 +25,53 @@ rtg::MeshReadNode::MeshReadNode()
     registerOutputPort("uvMap", uvMap);
     compute = [this]() {
         std::cout << "Reading mesh..." << std::endl;
+        if (IsBinaryMesh(path_)) {
+            read_binary_(path_);
+            return;
+        }
         io::OBJReader r;
         r.setPath(path_);
         mesh_ = r.read();
         img_ = r.getTextureMat();
         uv_ = r.getUVMap();
+        texturePath_ = r.getTexturePath();
     };
 }
 
-smgl::Metadata rtg::MeshReadNode::serialize_(bool, const fs::path&)
+void rtg::MeshReadNode::read_binary_(const fs::path& file)
 {
-    return {{"path", path_.string()}};
+    auto result = io::ReadBinaryMesh(file);
+    if (result.texturePath.empty() or not fs::exists(result.texturePath)) {
+        throw IOException("Invalid or unset texture image path");
+    }
+    mesh_ = result.mesh;
+    uv_ = result.uvMap;
+    texturePath_ = result.texturePath;
+    img_ = ReadImage(texturePath_);
+}
+
+smgl::Metadata rtg::MeshReadNode::serialize_(
+    bool useCache, const fs::path& cacheDir)
+{
+    smgl::Metadata m{{"path", path_.string()}};
+    if (useCache and mesh_) {
+        // The texture is referenced, not copied
+        io::WriteBinaryMesh(
+            cacheDir / "mesh.rtmesh", mesh_, uv_, fs::absolute(texturePath_));
+        m["mesh"] = "mesh.rtmesh";
+    }
+    return m;
 }
 
 void rtg::MeshReadNode::deserialize_(
-    const smgl::Metadata& meta, const fs::path&)
+    const smgl::Metadata& meta, const fs::path& cacheDir)
 {
     path_ = meta["path"].get<std::string>();
-    compute();
+    if (meta.contains("mesh")) {
+        read_binary_(cacheDir / meta["mesh"].get<std::string>());
+    } else {
+        compute();
+    }
 }
 
 rtg::MeshWriteNode::MeshWriteNode()
@@ -44,6 +82,16 @@ rtg::MeshWriteNode::MeshWriteNode()
     registerInputPort("uvMap", uvMap);
     compute = [this]() {
         std::cout << "Writing mesh..." << std::endl;
+        if (IsBinaryMesh(path_)) {
+            // Write the texture beside the mesh, like OBJWriter
+            fs::path texture;
+            if (not img_.empty()) {
+                texture = path_.stem().string() + ".tif";
+                WriteImage(path_.parent_path() / texture, img_);
+            }
+            io::WriteBinaryMesh(path_, mesh_, uv_, texture);
+            return;
+        }
         io::OBJWriter w;
         w.setPath(path_);
         w.setMesh(mesh_);
@@ -27,6 +27,12 @@ NLOHMANN_JSON_SERIALIZE_ENUM(SamplingMode, {
     {SamplingMode::OutputHeight, "height"},
     {SamplingMode::AutoUV, "auto"},
 })
+
+using SamplingEngine = rtg::ReorderTextureNode::SamplingEngine;
+NLOHMANN_JSON_SERIALIZE_ENUM(SamplingEngine, {
+    {SamplingEngine::RayCast, "ray-cast"},
+    {SamplingEngine::Rasterize, "rasterize"}
+})
 // clang-format on
 }  // namespace rt
 
@@ -37,6 +43,7 @@ rtg::ReorderTextureNode::ReorderTextureNode()
     , uvMapIn{&reorder_, &ReorderUnorganizedTexture::setUVMap}
     , samplingOrigin{&reorder_, &ReorderUnorganizedTexture::setSamplingOrigin}
     , samplingMode{&reorder_, &ReorderUnorganizedTexture::setSamplingMode}
+    , samplingEngine{&reorder_, &ReorderUnorganizedTexture::setSamplingEngine}
     , sampleRate{&reorder_, &ReorderUnorganizedTexture::setSampleRate}
     , sampleDim{&reorder_, &ReorderUnorganizedTexture::setSampleDim}
     , useFirstIntersection{&reorder_, &ReorderUnorganizedTexture::setUseFirstIntersection}
@@ -49,6 +56,7 @@ rtg::ReorderTextureNode::ReorderTextureNode()
     registerInputPort("uvMapIn", uvMapIn);
     registerInputPort("samplingOrigin", samplingOrigin);
     registerInputPort("samplingMode", samplingMode);
+    registerInputPort("samplingEngine", samplingEngine);
     registerInputPort("sampleRate", sampleRate);
     registerInputPort("sampleDim", sampleDim);
     registerInputPort("useFirstIntersection", useFirstIntersection);
@@ -69,6 +77,7 @@ auto rtg::ReorderTextureNode::serialize_(
     smgl::Metadata m{
         {"samplingOrigin", reorder_.samplingOrigin()},
         {"samplingMode", reorder_.samplingMode()},
+        {"samplingEngine", reorder_.samplingEngine()},
         {"sampleRate", reorder_.sampleRate()},
         {"sampleDim", reorder_.sampleDim()},
         {"useFirstIntersection", reorder_.useFirstIntersection()},
@@ -93,6 +102,10 @@ void rtg::ReorderTextureNode::deserialize_(
 {
     reorder_.setSamplingOrigin(meta["samplingOrigin"].get<SamplingOrigin>());
     reorder_.setSamplingMode(meta["samplingMode"].get<SamplingMode>());
+    if (meta.contains("samplingEngine")) {
+        reorder_.setSamplingEngine(
+            meta["samplingEngine"].get<SamplingEngine>());
+    }
     reorder_.setSampleRate(meta["sampleRate"].get<double>());
     reorder_.setSampleDim(meta["sampleDim"].get<std::size_t>());
     reorder_.setUseFirstIntersection(meta["useFirstIntersection"].get<bool>());
@@ -0,0 +1,207 @@
+#include "rt/graph/Scheduler.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <smgl/Node.hpp>
+
+namespace rtg = rt::graph;
+
+namespace
+{
+
+// Fixed-size pool of worker threads. Each worker has its own queue and runs
+// its newest task first. Idle workers steal the oldest task from another
+// worker's queue.
+class WorkStealingPool
+{
+public:
+    // Task function. Called with the index of the worker running it.
+    using Task = std::function<void(std::size_t)>;
+
+    explicit WorkStealingPool(std::size_t workers) : queues_(workers)
+    {
+        for (std::size_t i = 0; i < workers; i++) {
+            workers_.emplace_back([this, i]() { run_(i); });
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        taskAdded_.notify_all();
+        for (auto& w : workers_) {
+            w.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    auto operator=(const WorkStealingPool&) -> WorkStealingPool& = delete;
+
+    // Add a task to a worker's queue
+    void submit(Task task, std::size_t worker)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queues_[worker % queues_.size()].push_back(std::move(task));
+            pending_++;
+        }
+        taskAdded_.notify_one();
+    }
+
+    // Wait until every submitted task, including tasks submitted by other
+    // tasks, has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        allDone_.wait(lock, [this]() { return pending_ == 0; });
+    }
+
+private:
+    // Take the worker's newest task, or steal another worker's oldest task.
+    // Requires mutex_.
+    auto take_(std::size_t worker, Task& task) -> bool
+    {
+        auto& own = queues_[worker];
+        if (not own.empty()) {
+            task = std::move(own.back());
+            own.pop_back();
+            return true;
+        }
+        for (std::size_t i = 1; i < queues_.size(); i++) {
+            auto& other = queues_[(worker + i) % queues_.size()];
+            if (not other.empty()) {
+                task = std::move(other.front());
+                other.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run_(std::size_t worker)
+    {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                taskAdded_.wait(
+                    lock, [&]() { return take_(worker, task) or stop_; });
+                if (not task) {
+                    return;
+                }
+            }
+            task(worker);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) {
+                allDone_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::deque<Task>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable taskAdded_;
+    std::condition_variable allDone_;
+    std::size_t pending_{0};
+    bool stop_{false};
+};
+
+}  // namespace
+
+void rtg::UpdateGraph(smgl::Graph& graph, std::size_t maxConcurrency)
+{
+    if (maxConcurrency == 0) {
+        maxConcurrency = std::max(1U, std::thread::hardware_concurrency());
+    }
+    if (maxConcurrency == 1) {
+        graph.update();
+        return;
+    }
+
+    // Count each node's upstream nodes
+    auto nodes = smgl::Graph::Schedule(graph);
+    if (nodes.empty()) {
+        return;
+    }
+    std::unordered_map<const smgl::Node*, std::size_t> index;
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        index[nodes[i].get()] = i;
+    }
+    std::vector<std::size_t> waiting(nodes.size(), 0);
+    std::vector<std::vector<std::size_t>> downstream(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        std::unordered_set<std::size_t> upstream;
+        for (const auto& c : nodes[i]->getInputConnections()) {
+            auto it = index.find(c.srcNode);
+            if (it != index.end() and it->second != i) {
+                upstream.insert(it->second);
+            }
+        }
+        waiting[i] = upstream.size();
+        for (auto u : upstream) {
+            downstream[u].push_back(i);
+        }
+    }
+
+    // Run each node once its upstream nodes have finished. Ready nodes are
+    // queued on the worker which finished their last upstream node.
+    WorkStealingPool pool(std::min(maxConcurrency, nodes.size()));
+    std::mutex mutex;
+    std::exception_ptr error;
+    std::function<void(std::size_t, std::size_t)> run =
+        [&](std::size_t idx, std::size_t worker) {
+            try {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (error) {
+                        return;
+                    }
+                }
+                nodes[idx]->update();
+                std::vector<std::size_t> ready;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (auto d : downstream[idx]) {
+                        if (--waiting[d] == 0) {
+                            ready.push_back(d);
+                        }
+                    }
+                }
+                for (auto d : ready) {
+                    auto task = [&run, d](std::size_t w) { run(d, w); };
+                    pool.submit(task, worker);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (not error) {
+                    error = std::current_exception();
+                }
+            }
+        };
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        if (waiting[i] == 0) {
+            pool.submit([&run, i](std::size_t w) { run(i, w); }, i);
+        }
+    }
+    pool.wait();
+
+    if (graph.cacheEnabled()) {
+        smgl::Graph::Save(graph.cacheFile(), graph, true);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -1,6 +1,7 @@
 #include "rt/graph/Transforms.hpp"
 
 #include "rt/ImageTransformResampler.hpp"
+#include "rt/io/DeformationFieldIO.hpp"
 #include "rt/io/ImageIO.hpp"
 #include "rt/io/LandmarkIO.hpp"
 #include "rt/io/UVMapIO.hpp"
@@ -121,11 +122,14 @@ rtg::TransformUVMapNode::TransformUVMapNode() : Node{true}
 
         cv::Vec2d fixedSize{fixed_.cols - 1, fixed_.rows - 1};
         cv::Vec2d movingSize{moving_.cols - 1, moving_.rows - 1};
-        for (const auto& [key, face] : uvIn_.faces_as_map()) {
+        for (std::size_t key = 0; key < uvIn_.faces().size(); key++) {
+            if (not uvIn_.hasFace(key)) {
+                continue;
+            }
             bool valid{true};
             UVMap::Face f;
             int fIdx{0};
-            for (const auto& uv : uvIn_.getFaceUVs(key)) {
+            for (const auto& uv : uvIn_.faceUVs(key)) {
                 // Transform the UV point
                 auto in = uv.mul(fixedSize);
                 auto out = tfm_->TransformPoint(in.val);
@@ -170,12 +174,45 @@ void rtg::TransformUVMapNode::deserialize_(
     }
 }
 
+rtg::DeformationFieldNode::DeformationFieldNode() : Node{true}
+{
+    registerInputPort("fixedImage", fixedImage);
+    registerInputPort("transform", transform);
+    registerOutputPort("field", field);
+
+    compute = [=]() {
+        std::cout << "Baking deformation field..." << std::endl;
+        field_ = BakeDeformationField(tfm_, fixed_.size());
+    };
+}
+
+smgl::Metadata rtg::DeformationFieldNode::serialize_(
+    bool useCache, const fs::path& cacheDir)
+{
+    smgl::Metadata m;
+    if (useCache and field_) {
+        WriteDeformationField(cacheDir / "field.dfield", field_);
+        m["field"] = "field.dfield";
+    }
+    return m;
+}
+
+void rtg::DeformationFieldNode::deserialize_(
+    const smgl::Metadata& meta, const fs::path& cacheDir)
+{
+    if (meta.contains("field")) {
+        auto file = meta["field"].get<std::string>();
+        field_ = ReadDeformationField(cacheDir / file);
+    }
+}
+
 rtg::ImageResampleNode::ImageResampleNode() : Node{true}
 {
     registerInputPort("fixedImage", fixedImage);
     registerInputPort("movingImage", movingImage);
     registerInputPort("transform", transform);
     registerInputPort("forceAlpha", forceAlpha);
+    registerInputPort("deformationField", deformationField);
     registerOutputPort("resampledImage", resampledImage);
 
     compute = [=]() {
@@ -187,7 +224,11 @@ rtg::ImageResampleNode::ImageResampleNode() : Node{true}
             tmp = moving_;
         }
         std::cout << "Resampling image..." << std::endl;
-        resampled_ = ImageTransformResampler(tmp, fixed_.size(), tfm_);
+        if (field_) {
+            resampled_ = ImageTransformResampler(tmp, field_);
+        } else {
+            resampled_ = ImageTransformResampler(tmp, fixed_.size(), tfm_);
+        }
     };
 }
 
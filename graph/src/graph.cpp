@@ -29,6 +29,7 @@ static auto RegisterNodesImpl() -> bool
 
     // Transforms
     registered &= smgl::RegisterNode<
+        DeformationFieldNode,
         ImageResampleNode,
         TransformLandmarksNode,
         WriteTransformNode,
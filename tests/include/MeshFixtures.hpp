@@ -0,0 +1,75 @@
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "rt/types/ITKMesh.hpp"
+#include "rt/types/UVMap.hpp"
+
+namespace rt::test
+{
+
+/** @brief Triangle mesh and its UV map */
+struct TestMesh {
+    /** Mesh */
+    ITKMesh::Pointer mesh;
+    /** UV map. Empty if the mesh was built without UVs. */
+    UVMap uv;
+};
+
+/**
+ * @brief Build a triangle mesh from vertex positions and faces
+ *
+ * If uvs is not empty, it holds one UV (top-left origin) per vertex, and
+ * every face gets a UV face with the same indices.
+ */
+inline auto MakeTestMesh(
+    const std::vector<cv::Vec3d>& vertices,
+    const std::vector<UVMap::Face>& faces,
+    const std::vector<cv::Vec2d>& uvs = {}) -> TestMesh
+{
+    TestMesh result{ITKMesh::New(), UVMap()};
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        ITKPoint p;
+        p[0] = vertices[i][0];
+        p[1] = vertices[i][1];
+        p[2] = vertices[i][2];
+        result.mesh->SetPoint(i, p);
+    }
+    for (const auto& uv : uvs) {
+        result.uv.addUV(uv);
+    }
+
+    for (std::size_t i = 0; i < faces.size(); i++) {
+        ITKCell::CellAutoPointer cell;
+        cell.TakeOwnership(new ITKTriangle);
+        for (int v = 0; v < 3; v++) {
+            cell->SetPointId(v, faces[i][v]);
+        }
+        result.mesh->SetCell(i, cell);
+        if (not uvs.empty()) {
+            result.uv.addFace(i, faces[i]);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Rectangle [0, width] x [0, height] in the plane at z
+ *
+ * Split into two triangles along the diagonal. The UV map covers the full
+ * texture.
+ */
+inline auto RectangleMesh(double width, double height, double z = 0)
+    -> TestMesh
+{
+    return MakeTestMesh(
+        {{0, 0, z}, {width, 0, z}, {width, height, z}, {0, height, z}},
+        {{0, 1, 2}, {0, 2, 3}}, {{0, 0}, {1, 0}, {1, 1}, {0, 1}});
+}
+
+}  // namespace rt::test
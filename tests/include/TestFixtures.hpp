@@ -0,0 +1,52 @@
+#pragma once
+
+/** @file */
+
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+namespace rt::test
+{
+
+/**
+ * @brief Smooth, textured test image with plenty of detectable features
+ *
+ * Bilinearly upsamples a grid of random values spaced step pixels apart. The
+ * grid is seeded, so the image is the same on every call.
+ */
+inline auto TestImage(int size = 256, int step = 6) -> cv::Mat
+{
+    cv::Mat grid(size / step + 2, size / step + 2, CV_32FC1);
+    cv::RNG rng(12345);
+    rng.fill(grid, cv::RNG::UNIFORM, 0, 255);
+
+    cv::Mat img(size, size, CV_8UC1);
+    for (int y = 0; y < size; y++) {
+        auto gy = y / step;
+        auto fy = static_cast<float>(y % step) / step;
+        for (int x = 0; x < size; x++) {
+            auto gx = x / step;
+            auto fx = static_cast<float>(x % step) / step;
+            auto top = (1 - fx) * grid.at<float>(gy, gx) +
+                       fx * grid.at<float>(gy, gx + 1);
+            auto bottom = (1 - fx) * grid.at<float>(gy + 1, gx) +
+                          fx * grid.at<float>(gy + 1, gx + 1);
+            img.at<std::uint8_t>(y, x) =
+                cv::saturate_cast<std::uint8_t>((1 - fy) * top + fy * bottom);
+        }
+    }
+    return img;
+}
+
+/** @brief Translate an image by whole pixels (dx, dy), filling with zeros */
+inline auto Shift(const cv::Mat& img, int dx, int dy) -> cv::Mat
+{
+    cv::Mat res = cv::Mat::zeros(img.size(), img.type());
+    cv::Rect bounds({0, 0}, img.size());
+    auto dst = bounds & (bounds + cv::Point(dx, dy));
+    img(dst - cv::Point(dx, dy)).copyTo(res(dst));
+    return res;
+}
+
+}  // namespace rt::test
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "rt/io/BinaryMeshIO.hpp"
+#include "rt/types/Exceptions.hpp"
+
+#include "MeshFixtures.hpp"
+
+using namespace rt;
+using namespace rt::test;
+
+// Build a small fan of triangles with normals and a partial UV map
+static auto FanMesh() -> TestMesh
+{
+    constexpr std::size_t numFaces{6};
+    std::vector<cv::Vec3d> vertices{{0, 0, 0}};
+    std::vector<UVMap::Face> faces;
+    for (std::size_t i = 0; i < numFaces; i++) {
+        auto angle = 2 * CV_PI * static_cast<double>(i) / numFaces;
+        vertices.emplace_back(
+            std::cos(angle), std::sin(angle), 0.25 * static_cast<double>(i));
+        faces.emplace_back(0, i + 1, (i + 1) % numFaces + 1);
+    }
+    auto fan = MakeTestMesh(vertices, faces);
+
+    fan.mesh->SetPointData(0, ITKPixel(1.0));
+    for (std::size_t i = 0; i < numFaces; i++) {
+        ITKPixel n;
+        n[0] = 0;
+        n[1] = 0;
+        n[2] = static_cast<double>(i);
+        fan.mesh->SetPointData(i + 1, n);
+    }
+
+    fan.uv = UVMap(UVMap::Origin::BottomLeft);
+    fan.uv.ratio(200, 100);
+    for (const auto& v : vertices) {
+        fan.uv.addUV({0.5 + 0.5 * v[0], 0.5 + 0.5 * v[1]});
+    }
+    // Skip one face to check sparse UV faces
+    for (std::size_t i = 0; i < numFaces; i++) {
+        if (i != 2) {
+            fan.uv.addFace(i, faces[i]);
+        }
+    }
+    return fan;
+}
+
+TEST(BinaryMeshIO, RoundTrip)
+{
+    auto [mesh, uv] = FanMesh();
+
+    EXPECT_NO_THROW(io::WriteBinaryMesh(
+        "TestBinaryMeshIO_RoundTrip.rtmesh", mesh, uv, "texture.tif"));
+
+    io::BinaryMesh result;
+    EXPECT_NO_THROW(
+        result = io::ReadBinaryMesh("TestBinaryMeshIO_RoundTrip.rtmesh"));
+    ASSERT_TRUE(result.mesh.IsNotNull());
+
+    // Texture paths are relative to the mesh file
+    EXPECT_EQ(result.texturePath.filename().string(), "texture.tif");
+
+    // Points and normals
+    ASSERT_EQ(result.mesh->GetNumberOfPoints(), mesh->GetNumberOfPoints());
+    for (std::size_t i = 0; i < mesh->GetNumberOfPoints(); i++) {
+        EXPECT_EQ(result.mesh->GetPoint(i), mesh->GetPoint(i));
+        ITKPixel expected;
+        ITKPixel actual;
+        ASSERT_TRUE(mesh->GetPointData(i, &expected));
+        ASSERT_TRUE(result.mesh->GetPointData(i, &actual));
+        EXPECT_EQ(actual, expected);
+    }
+
+    // Faces
+    ASSERT_EQ(result.mesh->GetNumberOfCells(), mesh->GetNumberOfCells());
+    ITKCell::CellAutoPointer expected;
+    ITKCell::CellAutoPointer actual;
+    for (std::size_t i = 0; i < mesh->GetNumberOfCells(); i++) {
+        ASSERT_TRUE(mesh->GetCell(i, expected));
+        ASSERT_TRUE(result.mesh->GetCell(i, actual));
+        for (unsigned v = 0; v < 3; v++) {
+            EXPECT_EQ(actual->GetPointIds()[v], expected->GetPointIds()[v]);
+        }
+    }
+
+    // UV map
+    EXPECT_EQ(result.uvMap.origin(), uv.origin());
+    EXPECT_EQ(result.uvMap.ratio().width, uv.ratio().width);
+    EXPECT_EQ(result.uvMap.ratio().height, uv.ratio().height);
+    EXPECT_EQ(result.uvMap.uvs_as_vector(), uv.uvs_as_vector());
+    ASSERT_EQ(result.uvMap.size_faces(), uv.size_faces());
+    for (const auto& [idx, resFace] : result.uvMap.faces_as_map()) {
+        auto origFace = uv.getFace(idx);
+        EXPECT_EQ(resFace[0], origFace[0]);
+        EXPECT_EQ(resFace[1], origFace[1]);
+        EXPECT_EQ(resFace[2], origFace[2]);
+    }
+}
+
+TEST(BinaryMeshIO, RejectsInvalidFiles)
+{
+    std::ofstream("TestBinaryMeshIO_Invalid.rtmesh") << "not a mesh";
+    EXPECT_THROW(
+        io::ReadBinaryMesh("TestBinaryMeshIO_Invalid.rtmesh"), IOException);
+
+    // Truncated file
+    auto [mesh, uv] = FanMesh();
+    io::WriteBinaryMesh("TestBinaryMeshIO_Full.rtmesh", mesh, uv);
+    std::ifstream ifs("TestBinaryMeshIO_Full.rtmesh", std::ios::binary);
+    std::string bytes{
+        std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    std::ofstream("TestBinaryMeshIO_Truncated.rtmesh", std::ios::binary)
+        << bytes.substr(0, bytes.size() / 2);
+    EXPECT_THROW(
+        io::ReadBinaryMesh("TestBinaryMeshIO_Truncated.rtmesh"), IOException);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include <opencv2/core.hpp>
+
+#include "rt/DeformableRegistration.hpp"
+#include "rt/ImageTransformResampler.hpp"
+
+#include "TestFixtures.hpp"
+
+using namespace rt;
+using namespace rt::test;
+
+// Mean absolute difference, ignoring a border
+static auto Error(const cv::Mat& a, const cv::Mat& b, int border) -> double
+{
+    cv::Rect roi{border, border, a.cols - 2 * border, a.rows - 2 * border};
+    cv::Mat diff;
+    cv::absdiff(a(roi), b(roi), diff);
+    return cv::mean(diff)[0];
+}
+
+// Register moving to fixed and return the error of the warped moving image
+static auto Register(const cv::Mat& fixed, const cv::Mat& moving, size_t levels)
+    -> double
+{
+    DeformableRegistration reg;
+    reg.setFixedImage(fixed);
+    reg.setMovingImage(moving);
+    reg.setMeshFillSize(4);
+    reg.setNumberOfIterations(50);
+    reg.setNumberOfLevels(levels);
+    reg.setSamplingSchedule({0.25, 0.25});
+    Transform::Pointer tfm = reg.compute().GetPointer();
+    auto warped = ImageTransformResampler(moving, fixed.size(), tfm);
+    return Error(fixed, warped, 16);
+}
+
+// Register moving to fixed and return the displacement recovered at the
+// center of the fixed image
+static auto Displacement(
+    const cv::Mat& fixed,
+    const cv::Mat& moving,
+    DeformableRegistration::Framework framework) -> cv::Vec2d
+{
+    DeformableRegistration reg;
+    reg.setFixedImage(fixed);
+    reg.setMovingImage(moving);
+    reg.setMeshFillSize(4);
+    reg.setNumberOfIterations(50);
+    reg.setSamplingSchedule({0.25});
+    reg.setFramework(framework);
+    reg.setNumberOfThreads(2);
+    auto tfm = reg.compute();
+
+    DeformableRegistration::Transform::InputPointType center;
+    center[0] = fixed.cols / 2.0;
+    center[1] = fixed.rows / 2.0;
+    auto mapped = tfm->TransformPoint(center);
+    return {mapped[0] - center[0], mapped[1] - center[1]};
+}
+
+TEST(DeformableRegistration, PyramidMatchesSingleLevel)
+{
+    auto fixed = TestImage(128, 8);
+    auto moving = Shift(fixed, 4, 3);
+    auto initial = Error(fixed, moving, 16);
+
+    auto single = Register(fixed, moving, 1);
+    auto pyramid = Register(fixed, moving, 2);
+    EXPECT_LT(single, initial);
+    EXPECT_LT(pyramid, initial);
+    EXPECT_LE(pyramid, single + 0.5);
+}
+
+TEST(DeformableRegistration, TooManyLevels)
+{
+    DeformableRegistration reg;
+    EXPECT_THROW(
+        reg.setNumberOfLevels(DeformableRegistration::MAX_LEVELS + 1),
+        std::invalid_argument);
+    reg.setNumberOfLevels(DeformableRegistration::MAX_LEVELS);
+    EXPECT_EQ(reg.getNumberOfLevels(), DeformableRegistration::MAX_LEVELS);
+}
+
+TEST(DeformableRegistration, ITKv4MatchesITKv3)
+{
+    using Framework = DeformableRegistration::Framework;
+    auto fixed = TestImage(128, 8);
+    auto moving = Shift(fixed, 4, 3);
+
+    auto v3 = Displacement(fixed, moving, Framework::ITKv3);
+    auto v4 = Displacement(fixed, moving, Framework::ITKv4);
+    EXPECT_NEAR(v4[0], v3[0], 1.0);
+    EXPECT_NEAR(v4[1], v3[1], 1.0);
+    EXPECT_NEAR(v4[0], 4.0, 1.0);
+    EXPECT_NEAR(v4[1], 3.0, 1.0);
+}
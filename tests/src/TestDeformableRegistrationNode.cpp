@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include "rt/graph/DeformableRegistration.hpp"
+
+using namespace rt;
+using namespace rt::graph;
+
+using Framework = DeformableRegistration::Framework;
+
+TEST(DeformableRegistrationNode, SerializeFramework)
+{
+    DeformableRegistrationNode node;
+    node.framework = Framework::ITKv4;
+    node.threads = 3U;
+    auto meta = node.serialize(false, {});
+    EXPECT_EQ(meta["data"]["framework"], "itkv4");
+    EXPECT_EQ(meta["data"]["threads"], 3U);
+
+    // Settings restored from the metadata are serialized again unchanged
+    DeformableRegistrationNode loaded;
+    loaded.deserialize(meta, {});
+    EXPECT_EQ(loaded.serialize(false, {})["data"], meta["data"]);
+}
+
+TEST(DeformableRegistrationNode, DeserializeWithoutFramework)
+{
+    // Graphs saved before the framework option default to ITKv3
+    DeformableRegistrationNode node;
+    node.framework = Framework::ITKv4;
+    auto meta = node.serialize(false, {});
+    meta["data"].erase("framework");
+    meta["data"].erase("threads");
+
+    DeformableRegistrationNode loaded;
+    loaded.deserialize(meta, {});
+    auto data = loaded.serialize(false, {})["data"];
+    EXPECT_EQ(data["framework"], "itkv3");
+    EXPECT_EQ(data["threads"], 0U);
+}
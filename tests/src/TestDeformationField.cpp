@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include <itkAffineTransform.h>
+
+#include "rt/ImageTransformResampler.hpp"
+#include "rt/io/DeformationFieldIO.hpp"
+
+using namespace rt;
+
+using Affine = itk::AffineTransform<double, 2>;
+
+static auto TestTransform() -> Transform::Pointer
+{
+    auto affine = Affine::New();
+    affine->Rotate2D(0.05);
+    Affine::OutputVectorType offset;
+    offset[0] = 2.25;
+    offset[1] = -1.75;
+    affine->Translate(offset);
+    return affine.GetPointer();
+}
+
+TEST(DeformationField, Bake)
+{
+    cv::Size s{64, 48};
+    auto tfm = TestTransform();
+    auto field = BakeDeformationField(tfm, s);
+
+    auto size = field->GetLargestPossibleRegion().GetSize();
+    EXPECT_EQ(size[0], s.width);
+    EXPECT_EQ(size[1], s.height);
+
+    const auto* disp = field->GetBufferPointer();
+    for (int y = 0; y < s.height; y++) {
+        for (int x = 0; x < s.width; x++) {
+            Transform::InputPointType p;
+            p[0] = x;
+            p[1] = y;
+            auto expected = tfm->TransformPoint(p);
+            const auto& d = disp[y * s.width + x];
+            EXPECT_NEAR(x + d[0], expected[0], 1e-9);
+            EXPECT_NEAR(y + d[1], expected[1], 1e-9);
+        }
+    }
+}
+
+TEST(DeformationField, Resample)
+{
+    cv::Size s{64, 48};
+    cv::Mat moving(s, CV_8UC3);
+    cv::randu(moving, 0, 255);
+
+    // Resampling from a field should match resampling from the transform
+    auto tfm = TestTransform();
+    auto field = BakeDeformationField(tfm, s);
+    auto expected = ImageTransformResampler(moving, s, tfm);
+    auto result = ImageTransformResampler(moving, field);
+    ASSERT_EQ(result.size(), expected.size());
+    ASSERT_EQ(result.type(), expected.type());
+    EXPECT_EQ(cv::countNonZero(result.reshape(1) != expected.reshape(1)), 0);
+}
+
+TEST(DeformationField, ResampleDouble)
+{
+    cv::Size s{64, 48};
+    cv::Mat moving8(s, CV_8UC4);
+    cv::randu(moving8, 0, 255);
+
+    // 3 and 4 channel double images have 24 and 32 byte pixels
+    auto field = BakeDeformationField(TestTransform(), s);
+    cv::Mat expected;
+    ImageTransformResampler(moving8, field).convertTo(expected, CV_64F);
+    cv::Mat moving;
+    moving8.convertTo(moving, CV_64F);
+    for (auto cn : {3, 4}) {
+        std::vector<int> fromTo{0, 0, 1, 1, 2, 2, 3, 3};
+        fromTo.resize(2 * cn);
+        cv::Mat m(s, CV_MAKETYPE(CV_64F, cn));
+        cv::Mat e(s, CV_MAKETYPE(CV_64F, cn));
+        cv::mixChannels(moving, m, fromTo);
+        cv::mixChannels(expected, e, fromTo);
+
+        auto result = ImageTransformResampler(m, field);
+        ASSERT_EQ(result.type(), m.type());
+        EXPECT_EQ(cv::norm(result, e, cv::NORM_INF), 0);
+    }
+}
+
+TEST(DeformationField, RoundTrip)
+{
+    auto orig = BakeDeformationField(TestTransform(), {32, 24});
+
+    EXPECT_NO_THROW(
+        WriteDeformationField("TestDeformationField_RoundTrip.dfield", orig));
+
+    DeformationField::Pointer result;
+    EXPECT_NO_THROW(
+        result =
+            ReadDeformationField("TestDeformationField_RoundTrip.dfield"));
+    ASSERT_TRUE(result);
+
+    auto size = orig->GetLargestPossibleRegion().GetSize();
+    ASSERT_EQ(result->GetLargestPossibleRegion().GetSize(), size);
+    const auto* a = orig->GetBufferPointer();
+    const auto* b = result->GetBufferPointer();
+    for (std::size_t i = 0; i < size[0] * size[1]; i++) {
+        EXPECT_EQ(a[i], b[i]);
+    }
+}
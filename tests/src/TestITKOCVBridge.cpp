@@ -143,4 +143,51 @@ INSTANTIATE_TEST_SUITE_P(
         CV_16UC4,
         CV_32FC1,
         CV_32FC3,
-        CV_32FC4));
\ No newline at end of file
+        CV_32FC4));
+
+TEST(ITKOCVBridgeView, SharesBuffer)
+{
+    cv::Mat img(64, 48, CV_8UC3);
+    cv::randu(img, cv::Scalar{0, 0, 0}, cv::Scalar{256, 256, 256});
+
+    // cv::Mat -> itk::Image shares the buffer
+    auto itkImage = CVMatToITKImageView<Image8UC3>(img);
+    EXPECT_EQ(
+        reinterpret_cast<uint8_t*>(itkImage->GetBufferPointer()), img.data);
+    EXPECT_TRUE(HasBGRChannelOrder(itkImage));
+
+    // Components are not swapped
+    typename Image8UC3::IndexType idx;
+    idx[0] = 5;
+    idx[1] = 7;
+    auto itkVal = itkImage->GetPixel(idx);
+    auto cvVal = img.at<cv::Vec3b>(7, 5);
+    for (int d = 0; d < 3; d++) {
+        EXPECT_EQ(itkVal[d], cvVal[d]);
+    }
+
+    // itk::Image -> cv::Mat shares the buffer
+    auto view = ITKImageToCVMatView(itkImage);
+    EXPECT_EQ(view.data, img.data);
+
+    // Copies are still in OpenCV order
+    cv::Mat copy = ITKImageToCVMat(itkImage);
+    EXPECT_NE(copy.data, img.data);
+    EXPECT_EQ(cv::norm(copy, img, cv::NORM_INF), 0);
+}
+
+TEST(ITKOCVBridgeView, NonContinuous)
+{
+    cv::Mat img(64, 64, CV_16UC1);
+    cv::randu(img, 0, 65536);
+    auto roi = img(cv::Rect{8, 8, 32, 16});
+
+    auto itkImage = CVMatToITKImageView<Image16UC1>(roi);
+    auto size = itkImage->GetBufferedRegion().GetSize();
+    EXPECT_EQ(size[0], 32);
+    EXPECT_EQ(size[1], 16);
+    EXPECT_FALSE(HasBGRChannelOrder(itkImage));
+
+    cv::Mat result = ITKImageToCVMat(itkImage);
+    EXPECT_EQ(cv::norm(result, roi, cv::NORM_INF), 0);
+}
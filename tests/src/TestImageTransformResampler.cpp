@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include <itkAffineTransform.h>
+#include <itkTranslationTransform.h>
+#include <opencv2/core.hpp>
+
+#include "rt/ImageTransformResampler.hpp"
+#include "rt/io/TIFFIO.hpp"
+
+using namespace rt;
+
+using Affine = itk::AffineTransform<double, 2>;
+
+TEST(ImageTransformResampler, Tiled)
+{
+    cv::Mat moving(120, 90, CV_16UC3);
+    cv::randu(moving, 0, 65535);
+    io::WriteTIFF("TestImageTransformResampler_Moving.tif", moving);
+
+    auto affine = Affine::New();
+    affine->Rotate2D(0.2);
+    Affine::OutputVectorType offset;
+    offset[0] = 10.25;
+    offset[1] = -4.5;
+    affine->Translate(offset);
+    Transform::Pointer tfm = affine.GetPointer();
+
+    cv::Size s{100, 80};
+    auto expected = ImageTransformResampler(moving, s, tfm);
+    TiledImageTransformResampler(
+        "TestImageTransformResampler_Moving.tif",
+        "TestImageTransformResampler_Tiled.tif", s, tfm, false, {32, 32});
+
+    auto result = io::ReadTIFFRegion(
+        "TestImageTransformResampler_Tiled.tif", {{0, 0}, s});
+    ASSERT_EQ(result.size(), expected.size());
+    ASSERT_EQ(result.type(), expected.type());
+    EXPECT_EQ(cv::countNonZero(result.reshape(1) != expected.reshape(1)), 0);
+}
+
+TEST(ImageTransformResampler, TiledHalfPixel)
+{
+    cv::Mat moving(70, 60, CV_8UC1);
+    cv::randu(moving, 0, 255);
+    io::WriteTIFF("TestImageTransformResampler_HalfMoving.tif", moving);
+
+    // Every sample lands exactly halfway between two moving pixels
+    auto translation = itk::TranslationTransform<double, 2>::New();
+    itk::TranslationTransform<double, 2>::OutputVectorType offset;
+    offset[0] = 3.5;
+    offset[1] = -2.5;
+    translation->Translate(offset);
+    Transform::Pointer tfm = translation.GetPointer();
+
+    cv::Size s{50, 60};
+    auto expected = ImageTransformResampler(moving, s, tfm);
+    TiledImageTransformResampler(
+        "TestImageTransformResampler_HalfMoving.tif",
+        "TestImageTransformResampler_HalfTiled.tif", s, tfm, false, {16, 16});
+    auto result = io::ReadTIFFRegion(
+        "TestImageTransformResampler_HalfTiled.tif", {{0, 0}, s});
+    ASSERT_EQ(result.size(), expected.size());
+    EXPECT_EQ(cv::countNonZero(result != expected), 0);
+
+    // Ties round up
+    for (int y = 2; y < s.height; y++) {
+        for (int x = 0; x < s.width; x++) {
+            ASSERT_EQ(
+                result.at<std::uint8_t>(y, x),
+                moving.at<std::uint8_t>(y - 2, x + 4));
+        }
+    }
+}
+
+TEST(ImageTransformResampler, MultiChannel)
+{
+    cv::Mat moving(60, 50, CV_32FC4);
+    cv::randu(moving, 0, 1);
+
+    // Not natively supported, so 1 channel images go through ITK
+    auto translation = itk::TranslationTransform<double, 2>::New();
+    itk::TranslationTransform<double, 2>::OutputVectorType offset;
+    offset[0] = 5.25;
+    offset[1] = -3.75;
+    translation->Translate(offset);
+    Transform::Pointer tfm = translation.GetPointer();
+
+    cv::Size s{55, 45};
+    auto result = ImageTransformResampler(moving, s, tfm);
+    ASSERT_EQ(result.size(), s);
+    ASSERT_EQ(result.type(), moving.type());
+
+    // Should match resampling each channel separately
+    std::vector<cv::Mat> cns;
+    std::vector<cv::Mat> resCns;
+    cv::split(moving, cns);
+    cv::split(result, resCns);
+    for (std::size_t c = 0; c < cns.size(); c++) {
+        auto expected = ImageTransformResampler(cns[c], s, tfm);
+        EXPECT_EQ(cv::countNonZero(resCns[c] != expected), 0);
+    }
+}
+
+TEST(ImageTransformResampler, MultiChannelHalfPixel)
+{
+    cv::Mat moving(64, 48, CV_8UC4);
+    cv::randu(moving, 0, 255);
+
+    // Every sample lands exactly halfway between two moving pixels
+    auto translation = itk::TranslationTransform<double, 2>::New();
+    itk::TranslationTransform<double, 2>::OutputVectorType offset;
+    offset[0] = -0.5;
+    offset[1] = 2.5;
+    translation->Translate(offset);
+    Transform::Pointer tfm = translation.GetPointer();
+
+    cv::Size s{40, 56};
+    auto result = ImageTransformResampler(moving, s, tfm);
+    ASSERT_EQ(result.type(), moving.type());
+
+    // Should match ITK resampling each channel separately
+    std::vector<cv::Mat> cns;
+    std::vector<cv::Mat> resCns;
+    cv::split(moving, cns);
+    cv::split(result, resCns);
+    for (std::size_t c = 0; c < cns.size(); c++) {
+        auto expected = ImageTransformResampler(cns[c], s, tfm);
+        EXPECT_EQ(cv::countNonZero(resCns[c] != expected), 0);
+    }
+}
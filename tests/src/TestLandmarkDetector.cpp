@@ -0,0 +1,342 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+
+#include "rt/LandmarkDetector.hpp"
+
+#include "TestFixtures.hpp"
+
+using namespace rt;
+using namespace rt::test;
+
+namespace fs = rt::filesystem;
+
+TEST(FeatureCache, Key)
+{
+    auto img = TestImage();
+    auto key = FeatureCache::Key(img, cv::Mat(), "params");
+    EXPECT_EQ(key.size(), 16u);
+    EXPECT_EQ(key, FeatureCache::Key(img.clone(), cv::Mat(), "params"));
+
+    // Content, mask, and parameters all change the key
+    cv::Mat changed = img.clone();
+    changed.at<std::uint8_t>(100, 100) ^= 1;
+    EXPECT_NE(key, FeatureCache::Key(changed, cv::Mat(), "params"));
+    cv::Mat mask = cv::Mat::ones(img.size(), CV_8UC1);
+    EXPECT_NE(key, FeatureCache::Key(img, mask, "params"));
+    EXPECT_NE(key, FeatureCache::Key(img, cv::Mat(), "other"));
+
+    // Only the viewed pixels are hashed
+    cv::Mat roi = img(cv::Rect(10, 10, 50, 50));
+    EXPECT_EQ(
+        FeatureCache::Key(roi, cv::Mat(), "params"),
+        FeatureCache::Key(roi.clone(), cv::Mat(), "params"));
+}
+
+TEST(FeatureCache, DiskRoundTrip)
+{
+    fs::path dir{"TestFeatureCache"};
+    fs::remove_all(dir);
+
+    ImageFeatures features;
+    features.keypoints.emplace_back(1.5F, 2.5F, 3.F, 45.F, 0.5F, 1, 7);
+    features.keypoints.emplace_back(10.F, 20.F, 4.F, 90.F, 0.25F, 2, 3);
+    features.descriptors = cv::Mat(2, 61, CV_8UC1);
+    cv::randu(features.descriptors, 0, 256);
+    cv::Mat img(48, 64, CV_8UC1);
+    FeatureCache::New(dir)->put("abc", img, features);
+
+    // A new cache loads the entry from disk
+    auto cache = FeatureCache::New(dir);
+    EXPECT_FALSE(cache->get("def", img));
+    auto result = cache->get("abc", img);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(result->keypoints.size(), features.keypoints.size());
+    for (std::size_t i = 0; i < features.keypoints.size(); i++) {
+        EXPECT_EQ(result->keypoints[i].pt, features.keypoints[i].pt);
+        EXPECT_EQ(result->keypoints[i].octave, features.keypoints[i].octave);
+        EXPECT_EQ(
+            result->keypoints[i].class_id, features.keypoints[i].class_id);
+    }
+    EXPECT_EQ(cv::norm(result->descriptors, features.descriptors), 0);
+}
+
+TEST(FeatureCache, ImageMismatch)
+{
+    fs::path dir{"TestFeatureCacheMismatch"};
+    fs::remove_all(dir);
+
+    ImageFeatures features;
+    features.keypoints.emplace_back(1.5F, 2.5F, 3.F);
+    cv::Mat img(48, 64, CV_8UC1);
+    FeatureCache::New(dir)->put("abc", img, features);
+
+    // Entries for an image of another size or type are missing, whether
+    // they are in memory or on disk
+    auto memory = FeatureCache::New();
+    memory->put("abc", img, features);
+    for (const auto& cache : {memory, FeatureCache::New(dir)}) {
+        EXPECT_FALSE(cache->get("abc", cv::Mat(64, 48, CV_8UC1)));
+        EXPECT_FALSE(cache->get("abc", cv::Mat(48, 64, CV_8UC3)));
+        EXPECT_TRUE(cache->get("abc", img));
+    }
+}
+
+TEST(LandmarkDetector, CachedCompute)
+{
+    auto fixed = TestImage();
+    auto moving = Shift(fixed, 5, -3);
+
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setMovingImage(moving);
+    auto expected = detector.compute();
+    ASSERT_FALSE(expected.empty());
+
+    // Cached features give identical results
+    detector.setFeatureCache(FeatureCache::New());
+    detector.compute();
+    auto result = detector.compute();
+    ASSERT_EQ(result.size(), expected.size());
+    for (std::size_t i = 0; i < result.size(); i++) {
+        EXPECT_EQ(result[i], expected[i]);
+    }
+}
+
+TEST(LandmarkDetector, ComputeBatch)
+{
+    auto fixed = TestImage();
+    std::vector<cv::Mat> moving{
+        Shift(fixed, 5, -3), Shift(fixed, -4, 2), Shift(fixed, 1, 8)};
+
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setFeatureCache(FeatureCache::New());
+    auto batch = detector.computeBatch(moving);
+    ASSERT_EQ(batch.size(), moving.size());
+
+    // Batch results match individual results
+    for (std::size_t i = 0; i < moving.size(); i++) {
+        detector.setMovingImage(moving[i]);
+        auto expected = detector.compute();
+        ASSERT_EQ(batch[i].size(), expected.size());
+        for (std::size_t j = 0; j < expected.size(); j++) {
+            EXPECT_EQ(batch[i][j], expected[j]);
+        }
+    }
+
+    // Mask count must match image count
+    EXPECT_THROW(
+        detector.computeBatch(moving, {cv::Mat()}), std::invalid_argument);
+}
+
+// Fraction of matches consistent with a translation of (dx, dy)
+static auto Consistent(
+    const std::vector<LandmarkPair>& matches, float dx, float dy) -> double
+{
+    std::size_t good{0};
+    for (const auto& [f, m] : matches) {
+        if (cv::norm(m - f - cv::Point2f(dx, dy)) < 1.F) {
+            good++;
+        }
+    }
+    return static_cast<double>(good) / static_cast<double>(matches.size());
+}
+
+TEST(LandmarkDetector, TiledDetection)
+{
+    auto fixed = TestImage();
+    auto moving = Shift(fixed, 5, -3);
+
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setMovingImage(moving);
+    auto expected = detector.compute();
+
+    // A single tile is equivalent to full detection
+    detector.setDetectionMode(LandmarkDetector::DetectionMode::Tiled);
+    detector.setTileSize(fixed.cols);
+    auto result = detector.compute();
+    ASSERT_EQ(result.size(), expected.size());
+    for (std::size_t i = 0; i < result.size(); i++) {
+        EXPECT_EQ(result[i], expected[i]);
+    }
+
+    // Overlapping tiles don't produce duplicate key points
+    detector.setTileSize(96);
+    detector.setTileOverlap(32);
+    result = detector.compute();
+    ASSERT_FALSE(result.empty());
+    std::set<std::pair<float, float>> fixedPts;
+    for (const auto& p : result) {
+        EXPECT_TRUE(fixedPts.emplace(p.first.x, p.first.y).second);
+    }
+    EXPECT_GT(Consistent(result, 5, -3), 0.9);
+
+    EXPECT_THROW(detector.setTileSize(0), std::invalid_argument);
+    EXPECT_THROW(detector.setTileOverlap(-1), std::invalid_argument);
+}
+
+TEST(LandmarkDetector, CoarseToFineDetection)
+{
+    auto fixed = TestImage(512);
+    auto moving = Shift(fixed, 7, 4);
+
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setMovingImage(moving);
+    detector.setDetectionMode(LandmarkDetector::DetectionMode::CoarseToFine);
+    detector.setCoarseScale(0.5);
+    detector.setRefineRadius(32);
+    auto result = detector.compute();
+    ASSERT_FALSE(result.empty());
+    EXPECT_GT(Consistent(result, 7, 4), 0.9);
+
+    EXPECT_THROW(detector.setCoarseScale(0), std::invalid_argument);
+    EXPECT_THROW(detector.setCoarseScale(1.5), std::invalid_argument);
+    EXPECT_THROW(detector.setRefineRadius(0), std::invalid_argument);
+}
+
+TEST(LandmarkDetector, ApproximateMatchers)
+{
+    using MatcherType = LandmarkDetector::MatcherType;
+    auto fixed = TestImage();
+    auto moving = Shift(fixed, 5, -3);
+
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setMovingImage(moving);
+    for (auto type : {MatcherType::LSH, MatcherType::HierarchicalClustering}) {
+        detector.setMatcherType(type);
+        auto result = detector.compute();
+        ASSERT_FALSE(result.empty());
+        EXPECT_GT(Consistent(result, 5, -3), 0.9);
+    }
+}
+
+TEST(LandmarkDetector, SpatialMatching)
+{
+    auto fixed = TestImage();
+    auto moving = Shift(fixed, 5, -3);
+
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setMovingImage(moving);
+    detector.compute();
+    auto report = detector.matchReport();
+    EXPECT_FALSE(report.spatiallyConstrained);
+
+    // Estimated prediction
+    detector.setSearchRadius(10);
+    auto result = detector.compute();
+    report = detector.matchReport();
+    EXPECT_TRUE(report.spatiallyConstrained);
+    ASSERT_FALSE(result.empty());
+    EXPECT_GT(Consistent(result, 5, -3), 0.9);
+
+    // Provided prediction
+    detector.setPredictedTransform(
+        (cv::Mat_<double>(2, 3) << 1, 0, 5, 0, 1, -3));
+    result = detector.compute();
+    report = detector.matchReport();
+    EXPECT_TRUE(report.spatiallyConstrained);
+    ASSERT_FALSE(result.empty());
+    for (const auto& [f, m] : result) {
+        EXPECT_LE(cv::norm(m - f - cv::Point2f(5, -3)), 10);
+    }
+
+    EXPECT_THROW(detector.setSearchRadius(-1), std::invalid_argument);
+    EXPECT_THROW(
+        detector.setPredictedTransform(cv::Mat::eye(3, 3, CV_64F)),
+        std::invalid_argument);
+}
+
+TEST(LandmarkDetector, MatchReport)
+{
+    auto fixed = TestImage();
+    auto moving = Shift(fixed, 5, -3);
+
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setMovingImage(moving);
+    auto result = detector.compute();
+    auto report = detector.matchReport();
+    EXPECT_GT(report.fixedKeypoints, 0u);
+    EXPECT_GT(report.movingKeypoints, 0u);
+    EXPECT_EQ(report.matches, result.size());
+    EXPECT_EQ(report.landmarks, result.size());
+    EXPECT_EQ(report.outliersRejected, 0u);
+    EXPECT_GE(report.detectSeconds, 0);
+    EXPECT_GE(report.matchSeconds, 0);
+
+    // Inliers are only counted when a model is fit
+    EXPECT_FALSE(report.verified);
+    EXPECT_EQ(report.inliers, 0u);
+    detector.setGeometricModel(LandmarkDetector::GeometricModel::Affine);
+    result = detector.compute();
+    report = detector.matchReport();
+    EXPECT_TRUE(report.verified);
+    EXPECT_EQ(report.inliers, result.size());
+    EXPECT_LE(report.inliers, report.matches);
+    EXPECT_GT(report.inlierRatio(), 0.9);
+}
+
+TEST(LandmarkDetector, GeometricVerification)
+{
+    using GeometricModel = LandmarkDetector::GeometricModel;
+    using RobustEstimator = LandmarkDetector::RobustEstimator;
+    auto fixed = TestImage();
+    auto moving = Shift(fixed, 5, -3);
+
+    // A permissive ratio produces some outliers
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setMovingImage(moving);
+    detector.setMatchRatio(0.9F);
+
+    for (auto model : {GeometricModel::Affine, GeometricModel::Homography}) {
+        for (auto est : {RobustEstimator::RANSAC, RobustEstimator::PROSAC,
+                         RobustEstimator::MAGSAC}) {
+            detector.setGeometricModel(model);
+            detector.setRobustEstimator(est);
+            detector.setInlierThreshold(2);
+            auto result = detector.compute();
+            auto report = detector.matchReport();
+            ASSERT_FALSE(result.empty());
+            EXPECT_EQ(report.landmarks, result.size());
+            EXPECT_EQ(report.matches - report.outliersRejected, result.size());
+            EXPECT_EQ(report.inliers, result.size());
+            EXPECT_GT(Consistent(result, 5, -3), 0.95);
+        }
+    }
+
+    EXPECT_THROW(detector.setInlierThreshold(0), std::invalid_argument);
+}
+
+TEST(LandmarkDetector, MaxLandmarks)
+{
+    auto fixed = TestImage();
+    auto moving = Shift(fixed, 5, -3);
+
+    LandmarkDetector detector;
+    detector.setFixedImage(fixed);
+    detector.setMovingImage(moving);
+    auto all = detector.compute();
+    ASSERT_GT(all.size(), 16u);
+
+    detector.setMaxLandmarks(16);
+    auto capped = detector.compute();
+    ASSERT_EQ(capped.size(), 16u);
+
+    // Capped landmarks are a subset of all landmarks, spread over the image
+    std::set<int> quadrants;
+    for (const auto& p : capped) {
+        EXPECT_NE(std::find(all.begin(), all.end(), p), all.end());
+        quadrants.insert(
+            2 * static_cast<int>(p.first.y >= fixed.rows / 2.F) +
+            static_cast<int>(p.first.x >= fixed.cols / 2.F));
+    }
+    EXPECT_EQ(quadrants.size(), 4u);
+}
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <array>
+
+#include "rt/MeshAccelerator.hpp"
+
+#include "MeshFixtures.hpp"
+
+using namespace rt;
+using namespace rt::test;
+
+TEST(MeshAccelerator, FlatArrays)
+{
+    auto [mesh, uv] = RectangleMesh(20, 10);
+    auto accel = MeshAccelerator::New(mesh, uv);
+
+    ASSERT_EQ(accel->vertices().size(), 4u);
+    ASSERT_EQ(accel->faces().size(), 2u);
+    ASSERT_EQ(accel->faceUVs().size(), 6u);
+    EXPECT_EQ(accel->vertices()[2], cv::Vec3d(20, 10, 0));
+    EXPECT_EQ(accel->faces()[1], MeshAccelerator::Face(0, 2, 3));
+    EXPECT_EQ(accel->faceUVs()[4], cv::Vec2d(1, 1));
+}
+
+TEST(MeshAccelerator, UVDensity)
+{
+    auto [mesh, uv] = RectangleMesh(20, 10);
+    auto accel = MeshAccelerator::New(mesh, uv);
+
+    // One mesh unit is two pixels along every edge
+    EXPECT_DOUBLE_EQ(accel->uvDensity({41, 21}), 0.5);
+    // Cached per size
+    EXPECT_DOUBLE_EQ(accel->uvDensity({21, 11}), 1.0);
+    EXPECT_DOUBLE_EQ(accel->uvDensity({41, 21}), 0.5);
+}
+
+TEST(MeshAccelerator, OBB)
+{
+    auto [mesh, uv] = RectangleMesh(20, 10);
+    auto obb = MeshAccelerator::New(mesh, uv)->obb();
+
+    EXPECT_NEAR(cv::norm(obb.xAxis), 20, 1e-6);
+    EXPECT_NEAR(cv::norm(obb.yAxis), 10, 1e-6);
+    EXPECT_NEAR(cv::norm(obb.zAxis), 0, 1e-6);
+}
+
+TEST(MeshAccelerator, RayCasterCache)
+{
+    auto [mesh, uv] = RectangleMesh(20, 10);
+    auto accel = MeshAccelerator::New(mesh, uv);
+
+    const auto& down = accel->rayCaster({0, 0, -1});
+    const auto& up = accel->rayCaster({0, 0, 1});
+    EXPECT_EQ(&down, &accel->rayCaster({0, 0, -1}));
+    EXPECT_NE(&down, &up);
+
+    // Both directions hit the shared BVH
+    std::array<ParallelRayCaster::Hit, 64> hits;
+    down.cast({15, 2, 1}, {1, 0, 0}, {0, 1, 0}, 1, 1, 5, hits.data());
+    EXPECT_EQ(hits[0].face, 0u);
+    up.cast({5, 8, -1}, {1, 0, 0}, {0, 1, 0}, 1, 1, 5, hits.data());
+    EXPECT_EQ(hits[0].face, 1u);
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "rt/io/OBJReader.hpp"
+#include "rt/io/OBJWriter.hpp"
+#include "rt/types/Exceptions.hpp"
+
+using namespace rt;
+
+// Write a dim x dim vertex grid with one UV per vertex
+static void WriteGridOBJ(const std::string& path, std::size_t dim)
+{
+    std::ofstream ofs(path);
+    ofs << "# Grid\n";
+    for (std::size_t y = 0; y < dim; y++) {
+        for (std::size_t x = 0; x < dim; x++) {
+            ofs << "v " << x << " " << y << " " << 0.5 * (x + y) << "\n";
+        }
+    }
+    auto maxIdx = static_cast<double>(dim - 1);
+    for (std::size_t y = 0; y < dim; y++) {
+        for (std::size_t x = 0; x < dim; x++) {
+            ofs << "vt " << x / maxIdx << " " << y / maxIdx << "\r\n";
+        }
+    }
+    for (std::size_t y = 0; y + 1 < dim; y++) {
+        for (std::size_t x = 0; x + 1 < dim; x++) {
+            auto a = y * dim + x + 1;
+            auto b = a + 1;
+            auto c = a + dim;
+            ofs << "f " << a << "/" << a << " " << b << "/" << b << " " << c
+                << "/" << c << "\n";
+        }
+    }
+}
+
+TEST(OBJReader, ReadGrid)
+{
+    // Large enough to be split into several chunks
+    constexpr std::size_t dim{300};
+    WriteGridOBJ("TestOBJReader_Grid.obj", dim);
+
+    io::OBJReader reader;
+    reader.setPath("TestOBJReader_Grid.obj");
+    ITKMesh::Pointer mesh;
+    ASSERT_NO_THROW(mesh = reader.read());
+    auto uv = reader.getUVMap();
+
+    ASSERT_EQ(mesh->GetNumberOfPoints(), dim * dim);
+    ASSERT_EQ(mesh->GetNumberOfCells(), (dim - 1) * (dim - 1));
+    EXPECT_EQ(uv.size(), dim * dim);
+    EXPECT_EQ(uv.size_faces(), (dim - 1) * (dim - 1));
+
+    // Vertices
+    for (std::size_t id : {std::size_t{0}, dim + 3, dim * dim - 1}) {
+        auto x = static_cast<double>(id % dim);
+        auto y = static_cast<double>(id / dim);
+        auto p = mesh->GetPoint(id);
+        EXPECT_DOUBLE_EQ(p[0], x);
+        EXPECT_DOUBLE_EQ(p[1], y);
+        EXPECT_DOUBLE_EQ(p[2], 0.5 * (x + y));
+
+        auto t = uv.getUV(id, UVMap::Origin::BottomLeft);
+        EXPECT_NEAR(t[0], x / (dim - 1), 1e-6);
+        EXPECT_NEAR(t[1], y / (dim - 1), 1e-6);
+    }
+
+    // Faces
+    ITKCell::CellAutoPointer cell;
+    auto lastID = (dim - 1) * (dim - 1) - 1;
+    ASSERT_TRUE(mesh->GetCell(lastID, cell));
+    const auto* ids = cell->GetPointIds();
+    auto a = (dim - 2) * dim + dim - 2;
+    EXPECT_EQ(ids[0], a);
+    EXPECT_EQ(ids[1], a + 1);
+    EXPECT_EQ(ids[2], a + dim);
+    auto uvFace = uv.getFace(lastID);
+    EXPECT_EQ(uvFace[0], a);
+    EXPECT_EQ(uvFace[1], a + 1);
+    EXPECT_EQ(uvFace[2], a + dim);
+}
+
+TEST(OBJReader, WriterRoundTrip)
+{
+    // Values which lose precision with default stream formatting
+    constexpr std::size_t dim{50};
+    auto mesh = ITKMesh::New();
+    for (std::size_t i = 0; i < dim * dim; i++) {
+        ITKPoint p;
+        p[0] = static_cast<double>(i % dim) / 3.0;
+        p[1] = static_cast<double>(i / dim) * 1e-7;
+        p[2] = 1e6 + 0.1 * static_cast<double>(i);
+        mesh->SetPoint(i, p);
+    }
+    ITKCell::CellAutoPointer cell;
+    std::size_t cid{0};
+    for (std::size_t y = 0; y + 1 < dim; y++) {
+        for (std::size_t x = 0; x + 1 < dim; x++) {
+            cell.TakeOwnership(new ITKTriangle);
+            cell->SetPointId(0, y * dim + x);
+            cell->SetPointId(1, y * dim + x + 1);
+            cell->SetPointId(2, (y + 1) * dim + x);
+            mesh->SetCell(cid++, cell);
+        }
+    }
+
+    io::OBJWriter writer;
+    writer.setPath("TestOBJReader_RoundTrip.obj");
+    writer.setMesh(mesh);
+    ASSERT_EQ(writer.write(), EXIT_SUCCESS);
+
+    io::OBJReader reader;
+    reader.setPath("TestOBJReader_RoundTrip.obj");
+    ITKMesh::Pointer result;
+    ASSERT_NO_THROW(result = reader.read());
+
+    ASSERT_EQ(result->GetNumberOfPoints(), mesh->GetNumberOfPoints());
+    for (std::size_t i = 0; i < mesh->GetNumberOfPoints(); i++) {
+        EXPECT_EQ(result->GetPoint(i), mesh->GetPoint(i));
+    }
+
+    ASSERT_EQ(result->GetNumberOfCells(), mesh->GetNumberOfCells());
+    ITKCell::CellAutoPointer expected;
+    ITKCell::CellAutoPointer actual;
+    for (std::size_t i = 0; i < mesh->GetNumberOfCells(); i++) {
+        ASSERT_TRUE(mesh->GetCell(i, expected));
+        ASSERT_TRUE(result->GetCell(i, actual));
+        for (unsigned v = 0; v < 3; v++) {
+            EXPECT_EQ(actual->GetPointIds()[v], expected->GetPointIds()[v]);
+        }
+    }
+}
+
+TEST(OBJReader, NonTriangularFace)
+{
+    std::ofstream("TestOBJReader_Quad.obj") << "v 0 0 0\nv 1 0 0\nv 1 1 0\n"
+                                               "v 0 1 0\nf 1 2 3 4\n";
+    io::OBJReader reader;
+    reader.setPath("TestOBJReader_Quad.obj");
+    EXPECT_THROW(reader.read(), IOException);
+}
+
+TEST(OBJReader, OutOfRangeReference)
+{
+    std::ofstream("TestOBJReader_Range.obj") << "v 0 0 0\nv 1 0 0\nf 1 2 3\n";
+    io::OBJReader reader;
+    reader.setPath("TestOBJReader_Range.obj");
+    EXPECT_THROW(reader.read(), IOException);
+}
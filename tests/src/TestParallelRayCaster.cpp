@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+#include "rt/ParallelRayCaster.hpp"
+
+#include "MeshFixtures.hpp"
+
+using namespace rt;
+using namespace rt::test;
+
+using Hit = ParallelRayCaster::Hit;
+constexpr auto Dim = ParallelRayCaster::PacketDim;
+
+TEST(ParallelRayCaster, Packet)
+{
+    auto mesh = RectangleMesh(10, 10, 2.0).mesh;
+    ParallelRayCaster caster(mesh, {0, 0, -1});
+
+    // 8x8 packet of rays from z = 5, every 1.5 units. Offset so that no ray
+    // hits the shared diagonal edge.
+    std::array<Hit, Dim * Dim> hits;
+    cv::Vec3d origin{-1, -0.75, 5};
+    cv::Vec3d du{1.5, 0, 0};
+    cv::Vec3d dv{0, 1.5, 0};
+    caster.cast(origin, du, dv, Dim, Dim, 10.0, hits.data());
+
+    for (int j = 0; j < Dim; j++) {
+        for (int i = 0; i < Dim; i++) {
+            auto x = -1.0 + 1.5 * i;
+            auto y = -0.75 + 1.5 * j;
+            const auto& hit = hits[j * Dim + i];
+            auto inside = x > 0 and x < 10 and y > 0 and y < 10;
+            if (not inside) {
+                EXPECT_EQ(hit.face, ParallelRayCaster::NoHit);
+                continue;
+            }
+
+            // Below the diagonal is the first face
+            ASSERT_NE(hit.face, ParallelRayCaster::NoHit);
+            EXPECT_EQ(hit.face, (x > y) ? 0u : 1u);
+            EXPECT_NEAR(hit.distance, 3.0, 1e-5);
+
+            // Reconstruct the hit point from the barycentric coordinates
+            std::array<cv::Vec2d, 4> c{{{0, 0}, {10, 0}, {10, 10}, {0, 10}}};
+            auto a = c[0];
+            auto b = (hit.face == 0) ? c[1] : c[2];
+            auto d = (hit.face == 0) ? c[2] : c[3];
+            auto p = (1.0 - hit.u - hit.v) * a + hit.u * b + hit.v * d;
+            EXPECT_NEAR(p[0], x, 1e-4);
+            EXPECT_NEAR(p[1], y, 1e-4);
+        }
+    }
+}
+
+TEST(ParallelRayCaster, PartialPacketAndRange)
+{
+    auto mesh = RectangleMesh(10, 10, 2.0).mesh;
+    ParallelRayCaster caster(mesh, {0, 0, -1});
+
+    // Only 3x2 rays are cast. Unused entries are left untouched.
+    std::array<Hit, Dim * Dim> hits;
+    Hit marker;
+    marker.face = 42;
+    hits.fill(marker);
+    cv::Vec3d origin{1, 1.5, 5};
+    cv::Vec3d du{1, 0, 0};
+    cv::Vec3d dv{0, 1, 0};
+    caster.cast(origin, du, dv, 3, 2, 10.0, hits.data());
+    for (int j = 0; j < Dim; j++) {
+        for (int i = 0; i < Dim; i++) {
+            const auto& hit = hits[j * Dim + i];
+            if (i < 3 and j < 2) {
+                EXPECT_NE(hit.face, ParallelRayCaster::NoHit);
+            } else {
+                EXPECT_EQ(hit.face, 42u);
+            }
+        }
+    }
+
+    // The mesh is out of range
+    caster.cast(origin, du, dv, 3, 2, 2.0, hits.data());
+    for (int j = 0; j < 2; j++) {
+        for (int i = 0; i < 3; i++) {
+            EXPECT_EQ(hits[j * Dim + i].face, ParallelRayCaster::NoHit);
+        }
+    }
+}
+
+TEST(ParallelRayCaster, ClosestHit)
+{
+    // Two stacked squares. Rays from above hit the top one first.
+    std::vector<cv::Vec3d> vertices{
+        {0, 0, 2}, {10, 0, 2}, {10, 10, 2}, {0, 10, 2},
+        {0, 0, 1}, {10, 0, 1}, {10, 10, 1}, {0, 10, 1}};
+    std::vector<UVMap::Face> faces{{0, 1, 2}, {0, 2, 3}, {4, 5, 6}, {4, 6, 7}};
+    auto mesh = MakeTestMesh(vertices, faces).mesh;
+
+    std::array<Hit, Dim * Dim> hits;
+    ParallelRayCaster down(mesh, {0, 0, -1});
+    down.cast({2, 5, 5}, {1, 0, 0}, {0, 1, 0}, 1, 1, 10.0, hits.data());
+    EXPECT_EQ(hits[0].face, 1u);
+    EXPECT_NEAR(hits[0].distance, 3.0, 1e-5);
+
+    // From below, the lower square is closer
+    ParallelRayCaster up(mesh, {0, 0, 1});
+    up.cast({2, 5, -5}, {1, 0, 0}, {0, 1, 0}, 1, 1, 10.0, hits.data());
+    EXPECT_EQ(hits[0].face, 3u);
+    EXPECT_NEAR(hits[0].distance, 6.0, 1e-5);
+}
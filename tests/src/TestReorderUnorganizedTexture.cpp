@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "rt/ReorderUnorganizedTexture.hpp"
+
+#include "MeshFixtures.hpp"
+
+using namespace rt;
+using namespace rt::test;
+
+using Engine = ReorderUnorganizedTexture::SamplingEngine;
+
+// 20x10 grid in the XY plane, bent along X so that depth varies. The UV map
+// covers the full texture.
+static auto BentGridMesh() -> TestMesh
+{
+    constexpr int cols{21};
+    constexpr int rows{11};
+    std::vector<cv::Vec3d> vertices;
+    std::vector<cv::Vec2d> uvs;
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            vertices.emplace_back(x, y, 0.5 * std::sin(0.3 * x));
+            uvs.emplace_back(x / 20.0, y / 10.0);
+        }
+    }
+
+    std::vector<UVMap::Face> faces;
+    for (int y = 0; y + 1 < rows; y++) {
+        for (int x = 0; x + 1 < cols; x++) {
+            auto i = static_cast<std::size_t>(y * cols + x);
+            faces.emplace_back(i, i + 1, i + cols + 1);
+            faces.emplace_back(i, i + cols + 1, i + cols);
+        }
+    }
+    return MakeTestMesh(vertices, faces, uvs);
+}
+
+// Smooth color gradient, so that small differences in the sampled position
+// only change colors by rounding
+static auto GradientTexture() -> cv::Mat
+{
+    cv::Mat img(256, 256, CV_8UC3);
+    for (int y = 0; y < img.rows; y++) {
+        for (int x = 0; x < img.cols; x++) {
+            img.at<cv::Vec3b>(y, x) = cv::Vec3b(x, y, (x + y) / 2);
+        }
+    }
+    return img;
+}
+
+struct Result {
+    cv::Mat texture;
+    cv::Mat depth;
+    UVMap uv;
+};
+
+static auto Reorder(Engine engine) -> Result
+{
+    auto [mesh, uv] = BentGridMesh();
+
+    ReorderUnorganizedTexture r;
+    r.setMesh(mesh);
+    r.setUVMap(uv);
+    r.setTextureMat(GradientTexture());
+    r.setSampleRate(0.37);
+    r.setSamplingEngine(engine);
+    r.compute();
+    return {r.getTextureMat(), r.getDepthMap(), r.getUVMap()};
+}
+
+TEST(ReorderUnorganizedTexture, RasterizeMatchesRayCast)
+{
+    auto rayCast = Reorder(Engine::RayCast);
+    auto raster = Reorder(Engine::Rasterize);
+    ASSERT_EQ(raster.texture.size(), rayCast.texture.size());
+    ASSERT_EQ(raster.depth.size(), rayCast.depth.size());
+    ASSERT_FALSE(rayCast.texture.empty());
+
+    // Pixels on the mesh boundary may be covered by only one of the engines
+    auto limit = static_cast<int>(rayCast.texture.total() / 100);
+
+    cv::Mat depthDiff;
+    cv::absdiff(raster.depth, rayCast.depth, depthDiff);
+    EXPECT_LE(cv::countNonZero(depthDiff > 1e-3), limit);
+
+    cv::Mat texDiff;
+    cv::absdiff(raster.texture, rayCast.texture, texDiff);
+    texDiff = texDiff.reshape(1);
+    EXPECT_LE(cv::countNonZero(texDiff > 1), limit);
+
+    // The UV map does not depend on the engine
+    ASSERT_EQ(raster.uv.size(), rayCast.uv.size());
+    ASSERT_EQ(raster.uv.size_faces(), rayCast.uv.size_faces());
+    for (std::size_t i = 0; i < rayCast.uv.size(); i++) {
+        EXPECT_EQ(raster.uv.getUV(i), rayCast.uv.getUV(i));
+    }
+    for (std::size_t i = 0; i < rayCast.uv.size_faces(); i++) {
+        EXPECT_EQ(raster.uv.getFace(i), rayCast.uv.getFace(i));
+    }
+}
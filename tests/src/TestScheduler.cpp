@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <smgl/Graph.hpp>
+#include <smgl/Node.hpp>
+#include <smgl/Ports.hpp>
+
+#include "rt/graph/Scheduler.hpp"
+
+using namespace rt::graph;
+
+namespace
+{
+// Start and end of every node run, in the order they happened
+class RunLog
+{
+public:
+    struct Run {
+        int start{-1};
+        int end{-1};
+        int count{0};
+    };
+
+    void start(const std::string& name)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            runs_[name].start = next_++;
+            runs_[name].count++;
+            running_++;
+            maxRunning_ = std::max(maxRunning_, running_);
+        }
+        changed_.notify_all();
+    }
+
+    void end(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        runs_[name].end = next_++;
+        running_--;
+    }
+
+    // Wait until n nodes have been running at once. Returns false on
+    // timeout.
+    auto waitForConcurrent(int n) -> bool
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return maxRunning_ >= n;
+        });
+    }
+
+    auto run(const std::string& name) -> Run
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return runs_[name];
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::map<std::string, Run> runs_;
+    int next_{0};
+    int running_{0};
+    int maxRunning_{0};
+};
+
+// Adds its inputs plus one. Optionally throws, or waits until another node
+// is running at the same time.
+class TestNode : public smgl::Node
+{
+public:
+    TestNode() : Node{false}
+    {
+        registerInputPort("a", a);
+        registerInputPort("b", b);
+        registerOutputPort("result", result);
+
+        compute = [this]() {
+            log->start(name);
+            if (waitForOther) {
+                overlapped = log->waitForConcurrent(2);
+            }
+            log->end(name);
+            if (fail) {
+                throw std::runtime_error(name + " failed");
+            }
+            result_ = a_ + b_ + 1;
+        };
+    }
+
+    smgl::InputPort<int> a{&a_};
+    smgl::InputPort<int> b{&b_};
+    smgl::OutputPort<int> result{&result_};
+
+    std::string name;
+    RunLog* log{nullptr};
+    bool fail{false};
+    bool waitForOther{false};
+    bool overlapped{false};
+
+private:
+    int a_{0};
+    int b_{0};
+    int result_{0};
+};
+
+auto AddNode(smgl::Graph& graph, RunLog& log, const std::string& name)
+    -> std::shared_ptr<TestNode>
+{
+    auto node = graph.insertNode<TestNode>();
+    node->name = name;
+    node->log = &log;
+    return node;
+}
+}  // namespace
+
+TEST(Scheduler, Diamond)
+{
+    RunLog log;
+    smgl::Graph graph;
+    auto top = AddNode(graph, log, "top");
+    auto left = AddNode(graph, log, "left");
+    auto right = AddNode(graph, log, "right");
+    auto bottom = AddNode(graph, log, "bottom");
+    left->a = top->result;
+    right->a = top->result;
+    bottom->a = left->result;
+    bottom->b = right->result;
+
+    UpdateGraph(graph, 4);
+
+    // Every node runs once, after its inputs
+    for (const auto* name : {"top", "left", "right", "bottom"}) {
+        EXPECT_EQ(log.run(name).count, 1) << name;
+    }
+    EXPECT_GT(log.run("left").start, log.run("top").end);
+    EXPECT_GT(log.run("right").start, log.run("top").end);
+    EXPECT_GT(log.run("bottom").start, log.run("left").end);
+    EXPECT_GT(log.run("bottom").start, log.run("right").end);
+}
+
+TEST(Scheduler, IndependentBranchesOverlap)
+{
+    RunLog log;
+    smgl::Graph graph;
+    auto first = AddNode(graph, log, "first");
+    auto second = AddNode(graph, log, "second");
+    first->waitForOther = true;
+    second->waitForOther = true;
+
+    UpdateGraph(graph, 2);
+    EXPECT_TRUE(first->overlapped);
+    EXPECT_TRUE(second->overlapped);
+}
+
+TEST(Scheduler, ThrowingNode)
+{
+    RunLog log;
+    smgl::Graph graph;
+    auto source = AddNode(graph, log, "source");
+    auto downstream = AddNode(graph, log, "downstream");
+    auto last = AddNode(graph, log, "last");
+    source->fail = true;
+    downstream->a = source->result;
+    last->a = downstream->result;
+
+    EXPECT_THROW(UpdateGraph(graph, 2), std::runtime_error);
+    EXPECT_EQ(log.run("source").count, 1);
+    EXPECT_EQ(log.run("downstream").count, 0);
+    EXPECT_EQ(log.run("last").count, 0);
+}
@@ -0,0 +1,401 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "rt/io/TIFFIO.hpp"
+
+using namespace rt;
+
+static void ExpectEqual(const cv::Mat& a, const cv::Mat& b)
+{
+    ASSERT_EQ(a.size(), b.size());
+    ASSERT_EQ(a.type(), b.type());
+    EXPECT_EQ(cv::countNonZero(a.reshape(1) != b.reshape(1)), 0);
+}
+
+static auto RandomImage(const cv::Size& s, int type) -> cv::Mat
+{
+    cv::Mat img(s, type);
+    cv::randu(img, 0, 255);
+    return img;
+}
+
+// Write an uncompressed, multi-strip, 8-bit grayscale TIFF by hand
+static void WriteStrippedTIFF(
+    const std::string& path,
+    const cv::Mat& img,
+    int rowsPerStrip,
+    bool big,
+    std::uint16_t photometric = 1)
+{
+    std::vector<std::uint8_t> bytes;
+    auto put = [&bytes](std::uint64_t v, int n) {
+        for (int i = 0; i < n; i++) {
+            bytes.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+        }
+    };
+    const int offSize = big ? 8 : 4;
+
+    // Header
+    bytes.push_back('I');
+    bytes.push_back('I');
+    if (big) {
+        put(43, 2);
+        put(8, 2);
+        put(0, 2);
+    } else {
+        put(42, 2);
+    }
+    auto ifdPtr = bytes.size();
+    put(0, offSize);
+
+    // Pixels
+    std::vector<std::uint64_t> offsets;
+    std::vector<std::uint64_t> counts;
+    for (int y = 0; y < img.rows; y += rowsPerStrip) {
+        auto rows = std::min(rowsPerStrip, img.rows - y);
+        offsets.push_back(bytes.size());
+        counts.push_back(static_cast<std::uint64_t>(rows * img.cols));
+        for (int r = y; r < y + rows; r++) {
+            bytes.insert(bytes.end(), img.ptr(r), img.ptr(r) + img.cols);
+        }
+    }
+
+    // Strip arrays
+    auto offsetsPos = bytes.size();
+    for (auto v : offsets) {
+        put(v, offSize);
+    }
+    auto countsPos = bytes.size();
+    for (auto v : counts) {
+        put(v, offSize);
+    }
+    while (bytes.size() % 2 != 0) {
+        bytes.push_back(0);
+    }
+
+    // IFD
+    constexpr std::uint16_t SHORT{3};
+    constexpr std::uint16_t LONG{4};
+    const std::uint16_t OFFSET = big ? 16 : LONG;
+    struct Entry {
+        std::uint16_t tag;
+        std::uint16_t type;
+        std::uint64_t count;
+        std::uint64_t value;
+    };
+    auto numStrips = static_cast<std::uint64_t>(offsets.size());
+    std::vector<Entry> entries{
+        {256, LONG, 1, static_cast<std::uint64_t>(img.cols)},
+        {257, LONG, 1, static_cast<std::uint64_t>(img.rows)},
+        {258, SHORT, 1, 8},
+        {259, SHORT, 1, 1},
+        {262, SHORT, 1, photometric},
+        {273, OFFSET, numStrips, numStrips == 1 ? offsets[0] : offsetsPos},
+        {277, SHORT, 1, 1},
+        {278, LONG, 1, static_cast<std::uint64_t>(rowsPerStrip)},
+        {279, OFFSET, numStrips, numStrips == 1 ? counts[0] : countsPos}};
+    auto ifdPos = bytes.size();
+    put(entries.size(), big ? 8 : 2);
+    for (const auto& e : entries) {
+        put(e.tag, 2);
+        put(e.type, 2);
+        put(e.count, offSize);
+        put(e.value, offSize);
+    }
+    put(0, offSize);
+    for (int i = 0; i < offSize; i++) {
+        bytes[ifdPtr + i] = static_cast<std::uint8_t>(ifdPos >> (8 * i));
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+TEST(TIFFIO, ReadStrippedRegion)
+{
+    auto orig = RandomImage({100, 75}, CV_16UC3);
+    io::WriteTIFF("TestTIFFIO_Stripped.tif", orig);
+
+    auto header = io::ReadTIFFHeader("TestTIFFIO_Stripped.tif");
+    EXPECT_EQ(header.size, orig.size());
+    EXPECT_EQ(header.type, orig.type());
+    EXPECT_FALSE(header.tiled);
+
+    cv::Rect roi{13, 21, 40, 30};
+    auto region = io::ReadTIFFRegion("TestTIFFIO_Stripped.tif", roi);
+    ExpectEqual(region, orig(roi));
+}
+
+TEST(TIFFIO, TileWriterRoundTrip)
+{
+    cv::Size s{100, 75};
+    cv::Size tileSize{32, 32};
+    auto orig = RandomImage(s, CV_8UC4);
+
+    {
+        io::TIFFTileWriter writer(
+            "TestTIFFIO_Tiled.tif", s, orig.type(), tileSize);
+        for (int y = 0; y < s.height; y += tileSize.height) {
+            for (int x = 0; x < s.width; x += tileSize.width) {
+                auto tile = cv::Rect{{x, y}, tileSize} & cv::Rect{{0, 0}, s};
+                writer.writeTile(orig(tile), tile.tl());
+            }
+        }
+    }
+
+    auto header = io::ReadTIFFHeader("TestTIFFIO_Tiled.tif");
+    EXPECT_EQ(header.size, s);
+    EXPECT_EQ(header.type, orig.type());
+    EXPECT_TRUE(header.tiled);
+
+    // Full image
+    auto full = io::ReadTIFFRegion("TestTIFFIO_Tiled.tif", {{0, 0}, s});
+    ExpectEqual(full, orig);
+
+    // Region crossing tile boundaries
+    cv::Rect roi{20, 30, 50, 40};
+    auto region = io::ReadTIFFRegion("TestTIFFIO_Tiled.tif", roi);
+    ExpectEqual(region, orig(roi));
+}
+
+TEST(TIFFIO, BadRegion)
+{
+    auto orig = RandomImage({16, 16}, CV_8UC1);
+    io::WriteTIFF("TestTIFFIO_BadRegion.tif", orig);
+    EXPECT_THROW(
+        io::ReadTIFFRegion("TestTIFFIO_BadRegion.tif", {8, 8, 16, 16}),
+        std::runtime_error);
+}
+
+TEST(TIFFIO, ReadMultiStrip)
+{
+    auto orig = RandomImage({97, 83}, CV_8UC1);
+    for (auto big : {false, true}) {
+        std::string path = big ? "TestTIFFIO_BigStrips.tif"
+                               : "TestTIFFIO_Strips.tif";
+        WriteStrippedTIFF(path, orig, 7, big);
+
+        auto header = io::ReadTIFFHeader(path);
+        EXPECT_EQ(header.size, orig.size());
+        EXPECT_EQ(header.type, orig.type());
+        EXPECT_FALSE(header.tiled);
+        EXPECT_EQ(header.bigTIFF, big);
+        EXPECT_EQ(header.chunkSize, cv::Size(97, 7));
+
+        ExpectEqual(io::ReadTIFF(path), orig);
+        cv::Rect roi{5, 12, 60, 50};
+        ExpectEqual(io::ReadTIFFRegion(path, roi), orig(roi));
+    }
+}
+
+TEST(TIFFIO, RegionReaderSharesChunks)
+{
+    auto orig = RandomImage({64, 48}, CV_8UC1);
+    cv::Size tile{16, 16};
+    for (auto rowsPerStrip : {48, 7}) {
+        std::string path{"TestTIFFIO_RegionReader.tif"};
+        WriteStrippedTIFF(path, orig, rowsPerStrip, false);
+
+        // Every strip is decoded once, however many regions sample it
+        io::TIFFRegionReader reader(path);
+        std::vector<std::thread> threads;
+        for (int y = 0; y < orig.rows; y += tile.height) {
+            for (int x = 0; x < orig.cols; x += tile.width) {
+                threads.emplace_back([&, x, y]() {
+                    cv::Rect roi{{x, y}, tile};
+                    ExpectEqual(reader.read(roi), orig(roi));
+                });
+            }
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        auto strips = static_cast<std::size_t>(
+            (orig.rows + rowsPerStrip - 1) / rowsPerStrip);
+        EXPECT_EQ(reader.chunksDecoded(), strips);
+
+        // Cleared chunks are decoded again
+        reader.clear();
+        cv::Rect roi{8, 8, 16, 16};
+        ExpectEqual(reader.read(roi), orig(roi));
+        auto again =
+            static_cast<std::size_t>(23 / rowsPerStrip - 8 / rowsPerStrip + 1);
+        EXPECT_EQ(reader.chunksDecoded(), strips + again);
+    }
+}
+
+TEST(TIFFIO, UnsupportedPhotometric)
+{
+    // MinIsWhite samples would be returned inverted. Rejecting the file lets
+    // ReadImage fall back to cv::imread.
+    auto orig = RandomImage({32, 24}, CV_8UC1);
+    std::string path{"TestTIFFIO_MinIsWhite.tif"};
+    WriteStrippedTIFF(path, orig, 8, false, 0);
+    EXPECT_THROW(io::ReadTIFFHeader(path), std::runtime_error);
+    EXPECT_THROW(io::ReadTIFF(path), std::runtime_error);
+}
+
+TEST(TIFFIO, ReadRawTIFF)
+{
+    auto orig = RandomImage({32, 24}, CV_8UC1);
+    WriteStrippedTIFF("TestTIFFIO_Raw.tif", orig, 8, false);
+
+    // Every strip is read
+    auto raw = io::ReadRawTIFF("TestTIFFIO_Raw.tif");
+    ExpectEqual(raw, orig);
+
+    // Offset the strips by one row. The last row is read from past the end
+    // of the pixel data.
+    raw = io::ReadRawTIFF("TestTIFFIO_Raw.tif", orig.cols);
+    ExpectEqual(raw.rowRange(0, 23), orig.rowRange(1, 24));
+}
+
+TEST(TIFFIO, ConvertRawTIFF)
+{
+    auto orig = RandomImage({32, 24}, CV_8UC1);
+    WriteStrippedTIFF("TestTIFFIO_RawIn.tif", orig, 7, false);
+
+    io::ConvertRawTIFF("TestTIFFIO_RawIn.tif", "TestTIFFIO_RawOut.tif");
+    auto header = io::ReadTIFFHeader("TestTIFFIO_RawOut.tif");
+    EXPECT_EQ(header.chunkSize, cv::Size(32, 7));
+    ExpectEqual(io::ReadTIFF("TestTIFFIO_RawOut.tif"), orig);
+
+    io::ConvertRawTIFF(
+        "TestTIFFIO_RawIn.tif", "TestTIFFIO_RawOut.tif", orig.cols,
+        io::TIFFCompression::Deflate, io::TIFFPredictor::Horizontal);
+    auto shifted = io::ReadTIFF("TestTIFFIO_RawOut.tif");
+    ExpectEqual(shifted.rowRange(0, 23), orig.rowRange(1, 24));
+}
+
+TEST(TIFFIO, WriteOptionsRoundTrip)
+{
+    using Compression = io::TIFFCompression;
+    using Predictor = io::TIFFPredictor;
+    auto integer = RandomImage({100, 75}, CV_16UC3);
+    auto floating = RandomImage({100, 75}, CV_32FC1);
+    std::string path{"TestTIFFIO_Options.tif"};
+    for (auto tiled : {false, true}) {
+        for (auto c : {Compression::None, Compression::LZW,
+                       Compression::Deflate, Compression::ZSTD}) {
+            io::TIFFWriteOptions opts;
+            opts.tiled = tiled;
+            opts.tileSize = {32, 48};
+            opts.compression = c;
+            opts.predictor = Predictor::Horizontal;
+            try {
+                io::WriteTIFF(path, integer, opts);
+            } catch (const std::invalid_argument&) {
+                // libtiff may be built without ZSTD
+                ASSERT_EQ(c, Compression::ZSTD);
+                continue;
+            }
+            EXPECT_EQ(io::ReadTIFFHeader(path).tiled, tiled);
+            ExpectEqual(io::ReadTIFF(path), integer);
+
+            opts.predictor = Predictor::FloatingPoint;
+            io::WriteTIFF(path, floating, opts);
+            ExpectEqual(io::ReadTIFF(path), floating);
+        }
+    }
+}
+
+TEST(TIFFIO, BadPredictor)
+{
+    io::TIFFWriteOptions opts;
+    opts.predictor = io::TIFFPredictor::FloatingPoint;
+    EXPECT_THROW(
+        io::WriteTIFF(
+            "TestTIFFIO_BadPredictor.tif", RandomImage({8, 8}, CV_8UC1),
+            opts),
+        std::invalid_argument);
+}
+
+TEST(TIFFIO, TileWriterConcurrent)
+{
+    cv::Size s{256, 200};
+    cv::Size tileSize{32, 32};
+    auto orig = RandomImage(s, CV_8UC3);
+
+    // Each thread writes every nth tile
+    cv::Rect bounds{{0, 0}, s};
+    std::vector<cv::Rect> tiles;
+    for (int y = 0; y < s.height; y += tileSize.height) {
+        for (int x = 0; x < s.width; x += tileSize.width) {
+            tiles.emplace_back(cv::Rect{{x, y}, tileSize} & bounds);
+        }
+    }
+    {
+        io::TIFFTileWriter writer(
+            "TestTIFFIO_Concurrent.tif", s, orig.type(), tileSize,
+            io::TIFFCompression::Deflate, io::TIFFPredictor::Horizontal);
+        constexpr std::size_t threads{4};
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (auto i = t; i < tiles.size(); i += threads) {
+                    writer.writeTile(orig(tiles[i]), tiles[i].tl());
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    ExpectEqual(io::ReadTIFF("TestTIFFIO_Concurrent.tif"), orig);
+}
+
+// Check that each pixel of small is the mean of the corresponding 2x2 block
+// of big, to within rounding
+static void ExpectHalved(const cv::Mat& big, const cv::Mat& small)
+{
+    ASSERT_EQ(small.cols, (big.cols + 1) / 2);
+    ASSERT_EQ(small.rows, (big.rows + 1) / 2);
+    for (int y = 0; y < small.rows; y++) {
+        for (int x = 0; x < small.cols; x++) {
+            double sum{0};
+            int count{0};
+            for (int by = 2 * y; by < std::min(2 * y + 2, big.rows); by++) {
+                for (int bx = 2 * x; bx < std::min(2 * x + 2, big.cols);
+                     bx++) {
+                    sum += big.at<uint8_t>(by, bx);
+                    count++;
+                }
+            }
+            EXPECT_LE(std::abs(small.at<uint8_t>(y, x) - sum / count), 1.0);
+        }
+    }
+}
+
+TEST(TIFFIO, WritePyramid)
+{
+    auto orig = RandomImage({101, 75}, CV_8UC1);
+    std::string path{"TestTIFFIO_Pyramid.tif"};
+    io::TIFFWriteOptions opts;
+    opts.tileSize = {32, 32};
+    opts.pyramidLevels = 2;
+    io::WriteTIFF(path, orig, opts);
+
+    auto header = io::ReadTIFFHeader(path);
+    EXPECT_TRUE(header.tiled);
+    EXPECT_EQ(header.subIFDs, 2U);
+    ExpectEqual(io::ReadTIFF(path), orig);
+
+    auto level1 = io::ReadTIFF(path, 1);
+    EXPECT_EQ(io::ReadTIFFHeader(path, 1).size, cv::Size(51, 38));
+    ExpectHalved(orig, level1);
+
+    auto level2 = io::ReadTIFF(path, 2);
+    EXPECT_EQ(level2.size(), cv::Size(26, 19));
+    ExpectHalved(level1, level2);
+
+    EXPECT_THROW(io::ReadTIFF(path, 3), std::runtime_error);
+}
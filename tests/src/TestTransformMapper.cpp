@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <itkAffineTransform.h>
+#include <itkBSplineTransform.h>
+#include <itkTranslationTransform.h>
+
+#include "rt/TransformMapper.hpp"
+
+using namespace rt;
+
+using BSpline = itk::BSplineTransform<double, 2, 3>;
+using Affine = itk::AffineTransform<double, 2>;
+
+static auto RandomBSpline(const cv::Size& s, unsigned meshFill)
+    -> BSpline::Pointer
+{
+    BSpline::PhysicalDimensionsType dims;
+    dims[0] = s.width - 1;
+    dims[1] = s.height - 1;
+    BSpline::MeshSizeType mesh;
+    mesh.Fill(meshFill);
+    BSpline::OriginType origin;
+    origin.Fill(0);
+
+    auto tfm = BSpline::New();
+    tfm->SetTransformDomainOrigin(origin);
+    tfm->SetTransformDomainPhysicalDimensions(dims);
+    tfm->SetTransformDomainMeshSize(mesh);
+
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> dist(-5.0, 5.0);
+    BSpline::ParametersType params(tfm->GetNumberOfParameters());
+    for (unsigned i = 0; i < params.GetSize(); i++) {
+        params[i] = dist(gen);
+    }
+    tfm->SetParametersByValue(params);
+    return tfm;
+}
+
+static void CompareToITK(const Transform::Pointer& tfm, const cv::Size& s)
+{
+    TransformMapper mapper(tfm, s);
+    ASSERT_TRUE(mapper.isNative());
+
+    std::vector<double> xs(s.width);
+    std::vector<double> ys(s.width);
+    for (int y = 0; y < s.height; y++) {
+        mapper.mapRow(y, 0, s.width, xs.data(), ys.data());
+        for (int x = 0; x < s.width; x++) {
+            Transform::InputPointType p;
+            p[0] = x;
+            p[1] = y;
+            auto expected = tfm->TransformPoint(p);
+            // Allow for differences in floating-point contraction
+            EXPECT_DOUBLE_EQ(xs[x], expected[0]);
+            EXPECT_DOUBLE_EQ(ys[x], expected[1]);
+        }
+    }
+}
+
+TEST(TransformMapper, BSpline)
+{
+    cv::Size s{97, 61};
+    CompareToITK(RandomBSpline(s, 6), s);
+}
+
+TEST(TransformMapper, AffineBSplineComposite)
+{
+    cv::Size s{97, 61};
+
+    auto affine = Affine::New();
+    affine->Rotate2D(0.1);
+    Affine::OutputVectorType offset;
+    offset[0] = 3.5;
+    offset[1] = -2.25;
+    affine->Translate(offset);
+
+    // Applied in reverse order: B-spline, then affine, then B-spline
+    auto composite = CompositeTransform::New();
+    composite->AddTransform(RandomBSpline({120, 80}, 4));
+    composite->AddTransform(affine);
+    composite->AddTransform(RandomBSpline(s, 6));
+    CompareToITK(composite.GetPointer(), s);
+}
+
+TEST(TransformMapper, AffineOnlyFallsBack)
+{
+    // Chains without a B-spline are left to ResampleImageFilter
+    cv::Size s{16, 16};
+    auto affine = Affine::New();
+    affine->Rotate2D(0.1);
+    auto composite = CompositeTransform::New();
+    composite->AddTransform(affine);
+    composite->AddTransform(Affine::New());
+    TransformMapper mapper(composite.GetPointer(), s);
+    EXPECT_FALSE(mapper.isNative());
+}
+
+TEST(TransformMapper, Fallback)
+{
+    cv::Size s{16, 16};
+    auto tfm = itk::TranslationTransform<double, 2>::New();
+    TransformMapper mapper(tfm.GetPointer(), s);
+    EXPECT_FALSE(mapper.isNative());
+
+    std::vector<double> xs(s.width);
+    std::vector<double> ys(s.width);
+    mapper.mapRow(3, 0, s.width, xs.data(), ys.data());
+    for (int x = 0; x < s.width; x++) {
+        EXPECT_EQ(xs[x], x);
+        EXPECT_EQ(ys[x], 3);
+    }
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <tuple>
+
+#include "rt/types/UVMap.hpp"
+
+using namespace rt;
+
+TEST(UVMap, SparseFaces)
+{
+    UVMap uv;
+    uv.addUV({0, 0});
+    uv.addUV({1, 0});
+    uv.addUV({0, 1});
+    uv.addUV({1, 1});
+
+    uv.addFace(5, {1, 2, 3});
+    uv.addFace(2, {0, 1, 2});
+    EXPECT_EQ(uv.size_faces(), 2u);
+    EXPECT_TRUE(uv.hasFace(2));
+    EXPECT_TRUE(uv.hasFace(5));
+    EXPECT_FALSE(uv.hasFace(0));
+    EXPECT_FALSE(uv.hasFace(6));
+    EXPECT_THROW(std::ignore = uv.getFace(3), std::out_of_range);
+
+    // Replacing a face does not change the count
+    uv.addFace(5, {3, 2, 1});
+    EXPECT_EQ(uv.size_faces(), 2u);
+
+    // Automatic indices skip occupied faces
+    EXPECT_EQ(uv.addFace(0, 2, 3), 3u);
+
+    // Dense view covers the largest face number
+    auto faces = uv.faces();
+    ASSERT_EQ(faces.size(), 6u);
+    EXPECT_EQ(faces[5][0], 3u);
+    EXPECT_EQ(faces[3][2], 3u);
+
+    auto map = uv.faces_as_map();
+    EXPECT_EQ(map.size(), 3u);
+    EXPECT_EQ(map.count(2), 1u);
+    EXPECT_EQ(map.count(3), 1u);
+    EXPECT_EQ(map.count(5), 1u);
+}
+
+TEST(UVMap, FaceUVs)
+{
+    UVMap uv(UVMap::Origin::BottomLeft);
+    uv.addUV({0.25, 0.75});
+    uv.addUV({0.5, 0.5});
+    uv.addUV({1.0, 0.0});
+    uv.addFace(0, {2, 0, 1});
+
+    // Stored relative to the top-left
+    EXPECT_EQ(uv.uvs().size(), 3u);
+    EXPECT_EQ(uv.uvs()[0], cv::Vec2d(0.25, 0.25));
+
+    auto uvs = uv.faceUVs(0);
+    auto legacy = uv.getFaceUVs(0);
+    ASSERT_EQ(legacy.size(), uvs.size());
+    for (std::size_t i = 0; i < uvs.size(); i++) {
+        EXPECT_EQ(uvs[i], legacy[i]);
+    }
+    EXPECT_EQ(uvs[0], cv::Vec2d(1.0, 1.0));
+}
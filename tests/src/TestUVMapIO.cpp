@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <random>
 
 #include "rt/io/UVMapIO.hpp"
+#include "rt/types/Exceptions.hpp"
 #include "rt/types/UVMap.hpp"
 
 using namespace rt;
@@ -66,4 +68,103 @@ TEST(UVMapIO, RoundTrip)
         EXPECT_EQ(resFace[1], origFace[1]);
         EXPECT_EQ(resFace[2], origFace[2]);
     }
-}
\ No newline at end of file
+}
+
+// Sparse faces spanning several bitmap words, with a non-default origin
+static auto SparseUVMap() -> UVMap
+{
+    UVMap uv(UVMap::Origin::BottomLeft);
+    uv.ratio(640, 480);
+    for (std::size_t i = 0; i < 10; i++) {
+        auto val = static_cast<double>(i) / 10.0;
+        uv.addUV({val, 1.0 - val});
+    }
+    uv.addFace(0, {0, 1, 2});
+    uv.addFace(3, {3, 4, 5});
+    uv.addFace(130, {7, 8, 9});
+    return uv;
+}
+
+TEST(UVMapIO, SparseRoundTrip)
+{
+    auto orig = SparseUVMap();
+    WriteUVMap("TestUVMapIO_Sparse.uvm", orig);
+    auto result = ReadUVMap("TestUVMapIO_Sparse.uvm");
+
+    EXPECT_EQ(result.origin(), orig.origin());
+    EXPECT_EQ(result.ratio().width, orig.ratio().width);
+    EXPECT_EQ(result.ratio().height, orig.ratio().height);
+    ASSERT_EQ(result.size(), orig.size());
+    for (std::size_t i = 0; i < orig.size(); i++) {
+        EXPECT_EQ(result.getUV(i), orig.getUV(i));
+    }
+
+    ASSERT_EQ(result.size_faces(), orig.size_faces());
+    ASSERT_EQ(result.faces().size(), orig.faces().size());
+    for (std::size_t idx = 0; idx < orig.faces().size(); idx++) {
+        ASSERT_EQ(result.hasFace(idx), orig.hasFace(idx));
+        if (orig.hasFace(idx)) {
+            for (std::size_t v = 0; v < 3; v++) {
+                EXPECT_EQ(result.faces()[idx][v], orig.faces()[idx][v]);
+            }
+        }
+    }
+}
+
+TEST(UVMapIO, View)
+{
+    auto orig = SparseUVMap();
+    WriteUVMap("TestUVMapIO_View.uvm", orig);
+    UVMapView view("TestUVMapIO_View.uvm");
+
+    EXPECT_EQ(view.origin(), orig.origin());
+    EXPECT_EQ(view.size(), orig.size());
+    EXPECT_EQ(view.size_faces(), orig.size_faces());
+    ASSERT_EQ(view.faces().size(), orig.faces().size());
+    for (std::size_t idx = 0; idx < orig.faces().size(); idx++) {
+        ASSERT_EQ(view.hasFace(idx), orig.hasFace(idx));
+        if (orig.hasFace(idx)) {
+            auto expected = orig.faceUVs(idx);
+            auto actual = view.faceUVs(idx);
+            for (std::size_t v = 0; v < 3; v++) {
+                EXPECT_EQ(actual[v], expected[v]);
+            }
+        }
+    }
+
+    auto copy = view.toUVMap();
+    EXPECT_EQ(copy.uvs_as_vector(), orig.uvs_as_vector());
+    EXPECT_EQ(copy.size_faces(), orig.size_faces());
+}
+
+TEST(UVMapIO, ReadVersion1)
+{
+    // Version 1 layout: text header, UVs, then (index, face) records
+    auto orig = RandomUVMap(20, 10);
+    {
+        std::ofstream ofs("TestUVMapIO_V1.uvm", std::ios::binary);
+        ofs << "filetype: uvmap\nversion: 1\ntype: per-face\n";
+        ofs << "size: " << orig.size() << "\nwidth: 1\nheight: 1\n";
+        ofs << "origin: 0\nfaces: " << orig.size_faces() << "\n<>\n";
+        for (const auto& uv : orig.uvs()) {
+            ofs.write(reinterpret_cast<const char*>(uv.val), sizeof(uv.val));
+        }
+        for (const auto& [idx, f] : orig.faces_as_map()) {
+            ofs.write(reinterpret_cast<const char*>(&idx), sizeof(idx));
+            ofs.write(reinterpret_cast<const char*>(f.val), sizeof(f.val));
+        }
+    }
+
+    auto result = ReadUVMap("TestUVMapIO_V1.uvm");
+    EXPECT_EQ(result.uvs_as_vector(), orig.uvs_as_vector());
+    ASSERT_EQ(result.size_faces(), orig.size_faces());
+    for (const auto& [idx, resFace] : result.faces_as_map()) {
+        auto origFace = orig.getFace(idx);
+        EXPECT_EQ(resFace[0], origFace[0]);
+        EXPECT_EQ(resFace[1], origFace[1]);
+        EXPECT_EQ(resFace[2], origFace[2]);
+    }
+
+    // Views require version 2
+    EXPECT_THROW(UVMapView("TestUVMapIO_V1.uvm"), IOException);
+}